@@ -44,6 +44,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <assert.h>
 
 #include <fcntl.h>              /* low-level i/o */
@@ -55,12 +56,33 @@
 #include <sys/time.h>
 #include <sys/mman.h>
 #include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/resource.h>
+#include <pthread.h>
+#include <time.h>
 
 #include <asm/types.h>          /* for videodev2.h */
 
 #include <linux/videodev2.h>
 
-#define IMG_HEIGHT          480
+#if defined(VIDIOC_EXPBUF) && defined(__has_include)
+#if __has_include(<linux/dma-heap.h>) && __has_include(<linux/dma-buf.h>)
+#include <linux/dma-heap.h>
+#include <linux/dma-buf.h>
+#define HAVE_DMABUF     /* DMABUF import from a dma-heap */
+#endif
+#endif
+
+#include "ividdeccopy.h"
+#include "ividencgray.h"
+#include "workpool.h"
+#include "writer.h"
+#include "framefile.h"
+#include "stats.h"
+
+#define IMG_HEIGHT          480     /* default geometry, see -W and -H */
 #define IMG_WIDTH           640
 
 #define CLEAR(x)            memset (&(x), 0, sizeof (x))
@@ -70,57 +92,337 @@
 /* Not a cached system, no buffer alignment constraints */
 #define BUFALIGN            Memory_DEFAULTALIGNMENT
 
+/* cached buffers (-c) must not share a cache line with anything else */
+#define CACHEALIGN          128
 
+/* frames of a batch (-b) lie this far apart in inBuf and outBuf */
+#define FRAMESTRIDE(size)   (((size) + CACHEALIGN - 1) & ~(CACHEALIGN - 1))
 
-#define NSAMPLES    1024  /* must be multiple of 128 for cache/DMA reasons */
-// #define IFRAMESIZE  (NSAMPLES * sizeof(Int8))  /* raw frame (input) */
-// #define EFRAMESIZE  (NSAMPLES * sizeof(Int8))  /* encoded frame */
-// #define OFRAMESIZE  (NSAMPLES * sizeof(Int8))  /* decoded frame (output) */
 
-#define IFRAMESIZE  (NSAMPLES * 600 * sizeof(Int8))  /* raw frame (input) */
-#define EFRAMESIZE  (NSAMPLES * 600 * sizeof(Int8))  /* encoded frame */
-#define OFRAMESIZE  (NSAMPLES * 300 * sizeof(Int8))  /* decoded frame (output) */
+
+/* geometry negotiated with the driver in init_device() */
+static unsigned int img_width  = IMG_WIDTH;
+static unsigned int img_height = IMG_HEIGHT;
+static unsigned int img_pitch  = IMG_WIDTH * 2;   /* bytes per YUYV line */
+static unsigned int out_width;                  /* of the output, */
+static unsigned int out_height;                 /* see output_size() */
+
+static Int inFrameSize;     /* raw frame (input) */
+static Int encFrameSize;    /* encoded frame */
+static Int outFrameSize;    /* decoded frame (output) */
 
 static XDAS_Int8 *inBuf;
 static XDAS_Int8 *encodedBuf;
 static XDAS_Int8 *outBuf;
 
+static Int motionThreshold = -1;    /* -m, no motion detection if < 0 */
+static Int keyInterval = -1;        /* -d, whole gray frames if < 0 */
+static Int deltaThreshold = 0;
+static Int numThreads = 1;          /* -t, band threads of each decoder */
+static Int batch = 1;               /* -b, frames per VIDDEC_process() */
+static Int writerDepth = 0;         /* -w, frames in flight to disk, 0: stdio */
+static Int writerSync = 0;          /* fdatasync every that many frames */
+static Int cropX = 0;               /* -r, region of interest decoded */
+static Int cropY = 0;
+static Int cropWidth = 0;           /* 0: up to the edge */
+static Int cropHeight = 0;
+static Int scaleFactor = 1;         /* -z, box filter 1, 2 or 4 */
+static Int scaleWidth = 0;          /* -z, bilinear to this size if set */
+static Int scaleHeight = 0;
+static Int chromaFormat = XDM_GRAY; /* -o, output planes, see plane_size() */
+static Int rawOutput = 0;           /* -o yuyv, frames written as captured */
+static Int lumaStats = 0;           /* -L, trace each frame's luma stats */
+static Int encode = 0;              /* -e, gray frames losslessly encoded */
+
 static String progName     = "app";
 static String decoderName  = "viddec_copy";
-static String encoderName  = "videnc_copy";
+static String encoderName  = "videnc_gray";
 static String engineName   = "video_copy";
 
 
-static String usage = "%s: dev_name input-file output-file\n";
-
-static Void encode_decode(VIDENC_Handle enc, VIDDEC_Handle dec, FILE *in,
-    FILE *out);
+static String usage =
+    "%s: [-s] [-q block|oldest|newest|latest[,depth]] [-R] [-B] [-c] "
+    "[-C channels] [-i mmap|userptr|dmabuf] [-x] "
+    "[-m threshold] [-d keyframes[,threshold]] [-t threads] [-b frames] "
+    "[-w depth[,sync]] [-f] [-F first[,count]] [-T from[,to]] "
+    "[-r x,y[,w,h]] [-z 2|4|WxH] [-o gray|nv12|i420|yuyv] [-e] [-L] "
+    "[-S file|unix:socket[,seconds]] "
+    "[-n frames] [-W width] [-H height] "
+    "dev_name[,dev_name...] "
+    "input-file output-file\n"
+    "    -s captures on a thread of its own and queues the frames for "
+    "decoding;\n       -q does so too, at most depth (4) of them, and when "
+    "the queue is full\n       waits (block), drops the oldest or the "
+    "new frame, or with latest keeps\n       only the new one queued; "
+    "with zero-copy the depth leaves the driver\n       a buffer "
+    "besides a batch and the next frame\n"
+    "    input-file is only read with -R (replay instead of capture), "
+    "and mapped\n       if the codec is local; one written with -f -o "
+    "yuyv brings its own geometry\n"
+    "    -F replays count frames of input-file from frame first on\n"
+    "    -T replays the frames from from up to to ms after the first one, "
+    "input-file\n       must have been written with -f -o yuyv\n"
+    "    -c allocates cached working buffers\n"
+    "    -C decodes input-file frames on that many decoders at once\n"
+    "    -m compares each frame with the previous one, blocks whose mean "
+    "difference\n       is at least threshold count as moving\n"
+    "    -d writes records of the blocks changed by more than threshold "
+    "(0),\n       a keyframe with all of them every keyframes records\n"
+    "    -t converts each frame in that many bands at once\n"
+    "    -r decodes only the w x h pixels from x,y on (0: up to the edge)\n"
+    "    -z scales them down 2 or 4 times with a box filter, or to WxH "
+    "with a\n       bilinear one\n"
+    "    -o writes the luma only (gray), or with 4:2:0 chroma, NV12 or I420, "
+    "not\n       with -d or -z; or the YUYV frames as captured (yuyv), "
+    "without decoding\n       them, so not with -m, -d, -r, -z, -e or -L; "
+    "with -f that is a recording\n       -R and file: can replay\n"
+    "    -e encodes the gray frames losslessly with videnc_gray before "
+    "they are\n       written, see ividencgray.h; not with -d or -o "
+    "nv12|i420\n"
+    "    -L traces the luma mean, minimum and maximum of each frame, from "
+    "the\n       decoder's histogram\n"
+    "    -b decodes up to that many queued frames per process call, "
+    "with -s or -R\n"
+    "    -w writes output files asynchronously with up to depth frames "
+    "in flight,\n       syncing every sync frames (0: at the end, -1: "
+    "never)\n"
+    "    -f writes output files with a header, frame timestamps and an "
+    "index\n"
+    "    -S keeps latency histograms of each frame stage, written to file "
+    "every\n       seconds (10), or to each client of socket\n"
+    "    dev_name is a V4L2 device, file:path[@fps] for the YUYV frames of a "
+    "file,\n       raw or written with -f -o yuyv, over and over, or "
+    "synth[:ramp|bars|noise][@fps]\n       for generated ones; without fps "
+    "a frame is ready whenever a buffer is\n"
+    "    frames of a second device go to output-file.1 and so on; -s and "
+    "-B take one device\n";
+
+struct device;
+
+static Void encode_decode(VIDDEC_Handle dec, FILE *in, struct device *dev);
+static int read_header(FILE *in, FrameFile_Header *header);
+static long read_index(FILE *in, FrameFile_Header *header,
+    FrameFile_IndexEntry **index);
+static off_t frame_offset(FrameFile_IndexEntry *index, long k);
+static VIDDEC_Handle create_decoder(Engine_Handle ce);
+static VIDENC_Handle create_encoder(Engine_Handle ce);
+static Int configure_decoder(VIDDEC_Handle dec);
+static Void report_decoder(VIDDEC_Handle dec, String name);
+static Int32 decode_frame(VIDDEC_Handle dec, XDAS_Int8 *frame, Int size,
+    XDAS_Int8 *outFrame, XDAS_Int32 id, IVIDDECCOPY_OutArgs *decOutArgs);
+static Int32 decode_frames(VIDDEC_Handle dec, XDAS_Int8 **frames, Int *sizes,
+    XDAS_Int8 **outFrames, Int numFrames, XDAS_Int32 id,
+    IVIDDECCOPY_OutArgs *decOutArgs);
+static Int output_size(Void);
+static Int plane_size(Int plane, Int *offset);
+static Void stream_decode(struct device *dev, Memory_AllocParams *allocParams);
+static int check_zero_copy(Engine_Handle ce, struct device *dev);
+static Void bench_io(Engine_Handle ce, struct device *dev);
+static Void multi_channel(Memory_AllocParams *allocParams);
 
 extern GT_Mask curMask;
 
 
 //摄像机采集模式
 typedef enum {
-    IO_METHOD_READ, IO_METHOD_MMAP, IO_METHOD_USERPTR,
+    IO_METHOD_READ, IO_METHOD_MMAP, IO_METHOD_USERPTR, IO_METHOD_DMABUF,
 } io_method;
 
-static io_method io = IO_METHOD_MMAP;
+static const char *io_names[] = { "read", "mmap", "userptr", "dmabuf" };
+
+static io_method io = IO_METHOD_MMAP;   /* requested with -i */
+static int export_dmabuf = 0;   /* -x: VIDIOC_EXPBUF the mmap buffers */
 
 struct buffer {
     void * start;
     size_t length;
+    int dmafd;                  /* dma-buf fd, -1 if none */
+};
+
+/* USERPTR capture buffers come from the codec's contiguous pool */
+static Memory_AllocParams captureAllocParams = {
+    Memory_CONTIGPOOL, Memory_NONCACHED, 4096, 0
+};
+
+/* dma-heaps to import DMABUF capture buffers from, contiguous first */
+static const char *dma_heaps[] = {
+    "/dev/dma_heap/linux,cma", "/dev/dma_heap/system", NULL
+};
+
+/*
+ *  Where a device's frames come from: a V4L2 driver, a file replayed or
+ *  a generated pattern.  Every source lends its frames out the way V4L2
+ *  does.  dequeue() hands out one of dev->buffers, described by a
+ *  struct v4l2_buffer, or returns 0 if no frame is ready; requeue() gives
+ *  it back; dev->fd is readable while a frame can be dequeued.  So the
+ *  capture loops, and what they measure, are the same for all of them.
+ */
+struct source {
+    const char *name;
+    void (*open)(struct device *dev);
+    void (*init)(struct device *dev);   /* format and buffers */
+    void (*start)(struct device *dev);
+    int (*dequeue)(struct device *dev, struct v4l2_buffer *buf);
+    int (*requeue)(struct device *dev, struct v4l2_buffer *buf);
+    void (*stop)(struct device *dev);
+    void (*uninit)(struct device *dev);
+    void (*close)(struct device *dev);
+    int (*fill)(struct device *dev, struct buffer *b, unsigned int sequence);
+};
+
+static const struct source v4l2_source;
+static const struct source file_source;
+static const struct source synth_source;
+
+/*
+ *  Buffers asked of each source: 4, or with -s enough for the queue, a
+ *  batch, the next frame and one for the driver to capture into.  A file:
+ *  or synth: source has room for the most -s asks for, RING_SLOTS + 1.
+ */
+#define SOFT_BUFFERS        17
+
+static unsigned int numBuffers = 4;
+
+/* where a frame was lost, counted in each device's dropped[] */
+enum {
+    DROP_DRIVER,                    /* never dequeued, a buf.sequence gap */
+    DROP_OLDEST,                    /* pushed out of the queue, -q oldest */
+    DROP_NEWEST,                    /* turned away by the queue, -q newest */
+    DROP_SUPERSEDED,                /* replaced while queued, -q latest */
+    DROP_CAUSES
+};
+
+/*
+ *  One capture device.  Everything the capture code touches lives here,
+ *  so a single loop can serve any number of devices.
+ */
+struct device {
+    String dev_name;
+    const struct source *src;       /* where its frames come from */
+    int fd;
+    io_method io;                   /* in use, may differ from io */
+    struct buffer *buffers;
+    unsigned int n_buffers;
+    int zero_copy;                  /* codec reads the V4L2 buffers, */
+                                    /* or the mapped input-file with -R */
+    int streaming;                  /* between STREAMON and STREAMOFF */
+    int failed;                     /* i/o error or stall, not served */
+    VIDDEC_Handle dec;              /* this device's decoder */
+    VIDENC_Handle enc;              /* the encoder of its frames with -e */
+    FILE *out;                      /* and where its frames go, */
+    Writer *writer;                 /* or their writer with -w */
+    int bufSize;                    /* of the writer's buffers */
+    int write_error;                /* errno of the first failed write */
+    unsigned long long offset;      /* bytes written to the output file */
+    unsigned int align;             /* of its records with -f */
+    Stats *stats;                   /* its stage histograms with -S */
+    Stats_Frame *timing;            /* of the frame in each writer buffer */
+    FrameFile_IndexEntry *index;    /* of the frames written with -f */
+    unsigned int indexed;
+    unsigned int indexSize;         /* entries there is room for */
+    unsigned int frames;            /* frames decoded */
+    unsigned int captured;          /* frames dequeued */
+    unsigned int expected;          /* buf.sequence of the next frame, */
+    int sequenced;                  /* once one was dequeued */
+    unsigned int dropped[DROP_CAUSES];  /* frames lost, by cause */
+    unsigned long long last;        /* now_ns() of the last frame */
+
+    /* file: and synth: sources only */
+    String path;                    /* the file, or the pattern */
+    unsigned int fps;               /* frame rate, 0: whenever a buffer is */
+    FILE *file;                     /* the file replayed */
+    int pattern;                    /* index in synth_patterns */
+    FrameFile_IndexEntry *inIndex;  /* its frames, if written with -f */
+    long numFrames;
+    pthread_mutex_t lock;           /* guards the fields below */
+    unsigned int queue[SOFT_BUFFERS];   /* buffers given back, in order */
+    unsigned int head;
+    unsigned int queued;
+    unsigned int sequence;          /* of the next frame */
+    unsigned long long epoch;       /* when frame 0 was due, fps > 0 */
+    unsigned long long due;         /* frames due and not handed out yet */
 };
 
-static struct buffer *buffers = NULL;
-static unsigned int n_buffers = 0;
+#define MAX_DEVICES         16
+#define STALL_NS            3000000000ULL   /* no frame for 3 s */
 
-static String dev_name = "/dev/video0";
-static int fd = -1;
+static struct device devices[MAX_DEVICES];
+static int n_devices = 0;
 
 FILE *in = NULL;
-FILE *out = NULL;
 
-static unsigned char* grayBuf = NULL;
+static unsigned int frame_count = 100;  /* frames to capture, -n */
+static int streaming = 0;               /* pipelined capture, -s */
+static int replay = 0;                  /* decode input-file, -R */
+static int bench = 0;                   /* compare i/o methods, -B */
+static int cached = 0;                  /* cached working buffers, -c */
+static int channels = 0;                /* decoder instances, -C */
+static int cache_maint = 0;             /* cached and the codec is remote */
+static int record = 0;                  /* indexed output files, -f */
+static long firstFrame = 0;             /* replayed from, -F */
+static long numReplay = -1;             /* frames replayed, all if < 0 */
+static long long fromMs = -1;           /* replayed time range, -T */
+static long long toMs = -1;
+static FrameFile_Header inHeader;       /* of input-file, if it has one */
+static String statsWhere = NULL;        /* where histograms go, -S */
+static int statsInterval = 10;
+
+/* time spent on each frame once it is available, up to its fwrite */
+static unsigned long long work_ns = 0;
+static unsigned int work_frames = 0;
+
+/*
+ *  Streaming mode hands frames from the capture thread to the processing
+ *  thread through a queue of at most depth frames.  They live in frame
+ *  slots, enough for a full queue, a batch being decoded and the frame
+ *  being filled; each slot belongs to the thread that took it, and the
+ *  lock only guards moving slot indices between the queue, the idle
+ *  stack and the two threads.  When the queue is full, -q picks what
+ *  gives: the capture thread waits for room (block), drops the oldest
+ *  queued frame or the new one, or with latest every frame still queued
+ *  when a new one arrives is replaced by it.  Dropped frames go straight
+ *  back to the driver, so it never runs out of buffers because the
+ *  processing thread is behind.
+ */
+#define RING_SLOTS          16
+#define RING_DEPTH          4       /* default depth, frames */
+
+typedef enum {
+    QUEUE_BLOCK, QUEUE_OLDEST, QUEUE_NEWEST, QUEUE_LATEST,
+} queue_policy;
+
+static const char *queue_names[] = { "block", "oldest", "newest", "latest" };
+
+static queue_policy policy = QUEUE_BLOCK;   /* when the queue is full, -q */
+static Int queueDepth = 0;                  /* -q, 0: RING_DEPTH */
+
+struct frame_slot {
+    XDAS_Int8 *buf;                 /* frame handed to the codec */
+    XDAS_Int8 *copy;                /* staging copy, only without zero_copy */
+    Int size;                       /* valid bytes in buf */
+    struct v4l2_buffer vbuf;        /* driver buffer the frame came in */
+    unsigned long long dequeued;    /* now_ns() at VIDIOC_DQBUF */
+};
+
+struct frame_ring {
+    struct device *dev;             /* the device being captured */
+    struct frame_slot slot[RING_SLOTS];
+    unsigned int slots;             /* of slot[] in use */
+    unsigned int depth;             /* frames queued at most */
+    pthread_mutex_t lock;           /* guards the fields below */
+    pthread_cond_t ready;           /* a frame was queued, or done set */
+    pthread_cond_t space;           /* slots were given back */
+    unsigned int queue[RING_SLOTS]; /* slots of the queued frames, */
+    unsigned int head;              /* the oldest at queue[head] */
+    unsigned int queued;
+    unsigned int maxQueued;         /* the most that were ever queued */
+    unsigned int idle[RING_SLOTS];  /* slots nobody holds, a stack */
+    unsigned int numIdle;
+    int done;                       /* capture finished */
+    int stop;                       /* processing failed, stop capturing */
+};
+
+static void stop_capturing(struct device *dev);
 
 // 错误处理函数
 static void errno_exit(const char * s)
@@ -145,44 +447,72 @@ static int xioctl(int fd, int request, void * arg)
     return r;
 }
 
-static int yuv422_to_gray(unsigned char* yuv422, unsigned char *gray, 
-    unsigned int width, unsigned int height)
-{
+// 当前采集方式对应的V4L2内存类型
+static enum v4l2_memory io_memory(struct device *dev) {
+
+    switch (dev->io) {
+    case IO_METHOD_USERPTR:
+        return V4L2_MEMORY_USERPTR;
+#ifdef HAVE_DMABUF
+    case IO_METHOD_DMABUF:
+        return V4L2_MEMORY_DMABUF;
+#endif
+    default:
+        return V4L2_MEMORY_MMAP;
+    }
+}
 
-    unsigned int ynum = width * height;
-    int i;
+// 导入的dma-buf在CPU(或本地编解码器)访问前后需要同步cache
+static void sync_dmabuf(struct device *dev, struct v4l2_buffer *buf,
+    int start) {
 
-    for(i = 0; i < ynum; i++)
-    {
-       //printf("yuv422_to_yuv420  Y start, %d\n", i);
-       gray[i] = yuv422[i * 2];
-    }
+#ifdef HAVE_DMABUF
+    struct dma_buf_sync sync;
+
+    if (dev->io != IO_METHOD_DMABUF)
+        return;
 
-   return 0;
+    CLEAR(sync);
+    sync.flags = DMA_BUF_SYNC_READ |
+        (start ? DMA_BUF_SYNC_START : DMA_BUF_SYNC_END);
+
+    xioctl(dev->buffers[buf->index].dmafd, DMA_BUF_IOCTL_SYNC, &sync);
+#endif
 }
 
+// CPU写完的缓存交给远端编解码器之前写回cache
+static void cache_to_codec(XDAS_Int8 *buf, Int size) {
 
-// 处理函数
-static void process_image(const void * p, int size) {
+    if (cache_maint)
+        Memory_cacheWb(buf, size);
+}
 
-    memset(grayBuf, 0 , OFRAMESIZE);
-    yuv422_to_gray((unsigned char*)p, grayBuf, IMG_WIDTH, IMG_HEIGHT);
-    fwrite(grayBuf, size, 1, in);
+// 远端编解码器写完之后作废CPU cache, 再由CPU读取
+static void cache_from_codec(XDAS_Int8 *buf, Int size) {
 
+    if (cache_maint)
+        Memory_cacheInv(buf, size);
 }
 
-// 读取一帧图像
-static int read_frame(void) {
+// 单调时钟, 纳秒
+static unsigned long long now_ns(void) {
 
-    struct v4l2_buffer buf;
-    unsigned int i;
+    struct timespec ts;
 
-    CLEAR(buf);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
 
-    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// 从V4L2驱动取出一帧
+static int v4l2_dequeue(struct device *dev, struct v4l2_buffer *buf) {
+
+    CLEAR(*buf);
+
+    buf->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf->memory = io_memory(dev);
 
-    if (-1 == xioctl(fd, VIDIOC_DQBUF, &buf)) {
+    if (-1 == xioctl(dev->fd, VIDIOC_DQBUF, buf)) {
         switch (errno) {
         case EAGAIN:
             return 0;
@@ -193,610 +523,3550 @@ static int read_frame(void) {
             /* fall through */
 
         default:
-            errno_exit("VIDIOC_DQBUF");
+            fprintf(stderr, "%s: VIDIOC_DQBUF error %d, %s\n",
+                dev->dev_name, errno, strerror(errno));
+            return -1;
         }
     }
 
-    assert(buf.index < n_buffers);
-
-    process_image(buffers[buf.index].start, buffers[buf.index].length);
-
-    if (-1 == xioctl(fd, VIDIOC_QBUF, &buf))
-        errno_exit("VIDIOC_QBUF");
-
     return 1;
 }
 
+// 把缓存还给V4L2驱动
+static int v4l2_requeue(struct device *dev, struct v4l2_buffer *buf) {
 
-static void mainloop(void) {
-
-    unsigned int count;
+    if (-1 == xioctl(dev->fd, VIDIOC_QBUF, buf)) {
+        fprintf(stderr, "%s: VIDIOC_QBUF error %d, %s\n",
+            dev->dev_name, errno, strerror(errno));
+        return -1;
+    }
 
-    count = 100;
+    return 0;
+}
 
-    while (count-- > 0) {
-        for (;;) {
+// 取出一帧图像并记下驱动丢掉的帧, 没有就绪的帧时返回0, 设备出错时返回-1
+static int dequeue_frame(struct device *dev, struct v4l2_buffer *buf) {
 
-            fd_set fds;
-            struct timeval tv;
-            int r;
+    unsigned int gap;
+    int r;
 
-            FD_ZERO(&fds);
-            FD_SET(fd, &fds);
+    if ((r = dev->src->dequeue(dev, buf)) <= 0)
+        return r;
 
-            /* Timeout. */
-            tv.tv_sec = 3;
-            tv.tv_usec = 0;
+    assert(buf->index < dev->n_buffers);
 
-            r = select(fd + 1, &fds, NULL, NULL, &tv);
+    dev->last = now_ns();
+    dev->captured++;
 
-            if (-1 == r) {
-                if (EINTR == errno)
-                    continue;
+    /* frames the driver had no buffer for; going back is a restart */
+    gap = buf->sequence - dev->expected;
+    if (dev->sequenced && (gap < 0x80000000U))
+        dev->dropped[DROP_DRIVER] += gap;
 
-                errno_exit("select");
-            }
+    dev->expected = buf->sequence + 1;
+    dev->sequenced = 1;
 
-            if (0 == r) {
-                fprintf(stderr, "select timeout/n");
-                exit(EXIT_FAILURE);
-            }
+    return 1;
+}
 
-            if (read_frame())
-                break;
+// 把缓存还给帧源, 出错时返回-1
+static int requeue_frame(struct device *dev, struct v4l2_buffer *buf) {
 
-            /* EAGAIN - continue select loop. */
-        }
-    }
+    return dev->src->requeue(dev, buf);
 }
 
+// 等待并取出下一帧, 设备出错或停顿时返回-1
+static int wait_frame(struct device *dev, struct v4l2_buffer *buf) {
 
-static void start_capturing(void) {
+    for (;;) {
 
-    unsigned int i;
-    enum v4l2_buf_type type;
+        fd_set fds;
+        struct timeval tv;
+        int r;
 
+        /* a frame may be ready without the fd saying so, see soft_dequeue() */
+        if ((r = dequeue_frame(dev, buf)) != 0)
+            return (r < 0 ? -1 : 0);
 
-    for (i = 0; i < n_buffers; ++i) {
+        FD_ZERO(&fds);
+        FD_SET(dev->fd, &fds);
 
-        struct v4l2_buffer buf;
+        /* Timeout. */
+        tv.tv_sec = 3;
+        tv.tv_usec = 0;
 
-        CLEAR(buf);
+        r = select(dev->fd + 1, &fds, NULL, NULL, &tv);
 
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = i;
+        if (-1 == r) {
+            if (EINTR == errno)
+                continue;
 
-        if (-1 == xioctl(fd, VIDIOC_QBUF, &buf)) {//将拍摄的图像数据放入缓存队列
-            errno_exit("VIDIOC_QBUF");
+            errno_exit("select");
         }
 
-    }
-
-    type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-
-    if (-1 == xioctl(fd, VIDIOC_STREAMON, &type)) {
+        if (0 == r) {
+            fprintf(stderr, "%s: select timeout\n", dev->dev_name);
+            return -1;
+        }
 
-        errno_exit("VIDIOC_STREAMON");
+        /* EAGAIN - continue select loop. */
     }
-
-    // printf("start capture finish\n");
 }
 
+// 帧数据的有效长度
+static Int frame_size(struct device *dev, struct v4l2_buffer *buf) {
 
-static void init_mmap(void) {
+    return buf->bytesused ? buf->bytesused : dev->buffers[buf->index].length;
+}
 
-    struct v4l2_requestbuffers req;  //缓冲区结构体
+// 把一条记录写到输出文件: head, data, 再补0到total字节; frame是它的各阶段时间.
+// 第一次失败时报错, 之后的写都丢弃并返回-1
+static int write_record(struct device *dev, const void *head, int headSize,
+    const void *data, int size, int total, const Stats_Frame *frame) {
 
-    CLEAR(req);
+    static const char zeros[WRITER_ALIGN];
+    static const Stats_Frame none;
+    char *buf;
+    int r;
 
-    req.count = 4;  //缓存数量，设置缓存区队列里保持多少张照片
-    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    req.memory = V4L2_MEMORY_MMAP;  //方法为内存映射方法
+    if (dev->write_error != 0) {
+        return -1;
+    }
 
-    if (-1 == xioctl(fd, VIDIOC_REQBUFS, &req)) {
-        if (EINVAL == errno) {
-            fprintf(stderr, "%s does not support "
-                    "memory mapping/n", dev_name);
-            exit(EXIT_FAILURE);
-        } else {
-            errno_exit("VIDIOC_REQBUFS");
+    if (dev->writer != NULL) {
+        /* the frame buffer is reused at once, the writer keeps a copy */
+        buf = (char *)Writer_get(dev->writer);
+        if (dev->timing != NULL) {
+            dev->timing[Writer_index(dev->writer, buf)] =
+                frame != NULL ? *frame : none;
         }
+        if (headSize > 0) {
+            memcpy(buf, head, headSize);
+        }
+        memcpy(buf + headSize, data, size);
+        memset(buf + headSize + size, 0, total - headSize - size);
+        r = Writer_put(dev->writer, buf, total);
     }
-
-    if (req.count < 2) {
-        fprintf(stderr, "Insufficient buffer memory on %s/n", dev_name);
-        exit(EXIT_FAILURE);
+    else {
+        r = (((headSize > 0) && (fwrite(head, headSize, 1, dev->out) != 1)) ||
+            ((size > 0) && (fwrite(data, size, 1, dev->out) != 1)) ||
+            ((total > headSize + size) &&
+            (fwrite(zeros, total - headSize - size, 1, dev->out) != 1))) ?
+            -1 : 0;
+        if ((r == 0) && (frame != NULL)) {
+            Stats_frame(dev->stats, frame, now_ns());
+        }
     }
 
-    buffers = (struct buffer *)calloc(req.count, sizeof(struct buffer));
-
-    if (!buffers) {
-
-        fprintf(stderr, "Out of memory/n");
-        exit(EXIT_FAILURE);
+    if (r != 0) {
+        dev->write_error = errno ? errno : EIO;
+        fprintf(stderr, "%s: can't write output, %s\n", dev->dev_name,
+            strerror(dev->write_error));
+        return -1;
     }
 
-    for (n_buffers = 0; n_buffers < req.count; ++n_buffers) {
+    dev->offset += total;
 
-        struct v4l2_buffer buf;
+    return 0;
+}
 
-        CLEAR(buf);
+// 写一块比写入器缓存大的数据, 分成缓存大小的几段
+static int write_blob(struct device *dev, const void *data, int size) {
 
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = n_buffers;
+    int pos, n;
 
-        if (-1 == xioctl(fd, VIDIOC_QUERYBUF, &buf)) {
-            errno_exit("VIDIOC_QUERYBUF");
+    for (pos = 0; pos < size; pos += n) {
+        n = size - pos;
+        if ((dev->writer != NULL) && (n > dev->bufSize)) {
+            n = dev->bufSize;
         }
+        if (write_record(dev, NULL, 0, (const char *)data + pos, n, n,
+            NULL) != 0) {
+            return -1;
+        }
+    }
 
+    return 0;
+}
 
-        buffers[n_buffers].length = buf.length;
-        buffers[n_buffers].start = mmap(NULL /* start anywhere */, buf.length,
-                PROT_READ | PROT_WRITE /* required */,
-                MAP_SHARED /* recommended */, fd, buf.m.offset);  //缓冲区起始存储位置
+// 写入器写完一个缓存: 记下其中那一帧各阶段的时间
+static void write_done(void *arg, void *buf) {
 
-        if (MAP_FAILED == buffers[n_buffers].start){
-            errno_exit("mmap");
-        }
+    struct device *dev = (struct device *)arg;
 
-    }
+    Stats_frame(dev->stats, &dev->timing[Writer_index(dev->writer, buf)],
+        now_ns());
 }
 
+// 打开设备的输出文件, 有-w时通过异步写入器写, 有-f时先写文件头
+static int open_output(struct device *dev, const char *path) {
 
-static void init_device(void) {
+    Writer_Attrs attrs;
+    FrameFile_Header *header;
+    int size;
+    int r;
 
-    struct v4l2_capability cap;
+    dev->bufSize = encode ? encFrameSize : outFrameSize;
+    if (record) {
+        /* a whole record fits a buffer, and O_DIRECT takes it */
+        dev->bufSize = FRAMEFILE_ALIGN(sizeof(FrameFile_FrameHeader) +
+            dev->bufSize, WRITER_ALIGN);
+    }
 
-    //query device capability
-    if (-1 == xioctl(fd, VIDIOC_QUERYCAP, &cap)) {
-        if (EINVAL == errno) {
-            fprintf(stderr, "%s is no V4L2 device/n", dev_name);
-            exit(EXIT_FAILURE);
-        } else {
-            errno_exit("VIDIOC_QUERYCAP");
+    if ((statsWhere != NULL) &&
+        ((dev->stats = Stats_create(dev->dev_name)) == NULL)) {
+        return -1;
+    }
+
+    if (writerDepth > 0) {
+        attrs.depth = writerDepth;
+        attrs.bufSize = dev->bufSize;
+        attrs.direct = 1;
+        attrs.syncEvery = writerSync;
+        attrs.done = NULL;
+        attrs.arg = dev;
+
+        if (dev->stats != NULL) {
+            dev->timing = (Stats_Frame *)calloc(writerDepth,
+                sizeof(Stats_Frame));
+            if (dev->timing == NULL) {
+                return -1;
+            }
+            attrs.done = write_done;
         }
+
+        dev->writer = Writer_create(path, &attrs);
+    }
+    else {
+        dev->out = fopen(path, "wb");
     }
 
-    if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE)) {
-        fprintf(stderr, "%s is no video capture device/n", dev_name);
-        exit(EXIT_FAILURE);
+    if ((dev->writer == NULL) && (dev->out == NULL)) {
+        printf("App-> ERROR: can't write to file %s\n", path);
+        return -1;
     }
 
+    if (dev->writer != NULL) {
+        GT_3trace(curMask, GT_1CLASS, "App-> %s: %s writer, O_DIRECT %s\n",
+            path, Writer_method(dev->writer),
+            Writer_direct(dev->writer) ? "on" : "off");
+    }
 
-    if (!(cap.capabilities & V4L2_CAP_STREAMING)) { //是否支持流操作，支持数据流控制
-        fprintf(stderr, "%s does not support streaming i/o/n", dev_name);
-        exit(EXIT_FAILURE);
+    if (!record) {
+        return 0;
     }
 
+    /* records stay aligned for O_DIRECT, and for the 64 bit fields */
+    dev->align = ((dev->writer != NULL) && Writer_direct(dev->writer)) ?
+        WRITER_ALIGN : 8;
 
-    /* Select video input, video standard and tune here. */
-    struct v4l2_cropcap cropcap;
-    struct v4l2_crop crop;
+    size = FRAMEFILE_ALIGN(sizeof(FrameFile_Header), dev->align);
+    if ((header = (FrameFile_Header *)calloc(1, size)) == NULL) {
+        return -1;
+    }
 
-    CLEAR(cropcap);
+    header->magic = FRAMEFILE_MAGIC;
+    header->version = FRAMEFILE_VERSION;
+    header->headerSize = sizeof(FrameFile_Header);
+    header->fourcc = rawOutput ? V4L2_PIX_FMT_YUYV :
+        encode ? IVIDENCGRAY_MAGIC :
+        keyInterval >= 0 ? IVIDDECCOPY_DELTAMAGIC :
+        chromaFormat == XDM_YUV_420SP ? V4L2_PIX_FMT_NV12 :
+        chromaFormat == XDM_YUV_420P ? V4L2_PIX_FMT_YUV420 :
+        V4L2_PIX_FMT_GREY;
+    header->width = out_width;
+    header->height = out_height;
+    header->pitch = rawOutput ? img_pitch : out_width;
+    header->align = dev->align;
+
+    r = write_blob(dev, header, size);
+    free(header);
 
-    cropcap.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;  //表示支持图像获取
+    return r;
+}
 
-    if (0 == xioctl (fd, VIDIOC_CROPCAP, &cropcap)) {
-        crop.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        crop.c = cropcap.defrect; /* reset to default */
+// 用dev的编码器把一帧灰度图无损压缩到encodedBuf, 返回压缩后的字节数, 失败返回-1.
+// 各设备的帧都在同一个线程里写, 所以共用一个encodedBuf
+static Int encode_frame(struct device *dev, XDAS_Int8 *frame, Int size) {
+
+    XDM_BufDesc inBufDesc, outBufDesc;
+    XDAS_Int32 inBufSizes[1], outBufSizes[1];
+    VIDENC_InArgs inArgs;
+    VIDENC_OutArgs outArgs;
+    Int32 status;
+
+    inBufDesc.numBufs = outBufDesc.numBufs = 1;
+    inBufDesc.bufs = &frame;
+    inBufDesc.bufSizes = inBufSizes;
+    outBufDesc.bufs = &encodedBuf;
+    outBufDesc.bufSizes = outBufSizes;
+    inBufSizes[0] = size;
+    outBufSizes[0] = encFrameSize;
+
+    inArgs.size = sizeof(inArgs);
+    outArgs.size = sizeof(outArgs);
+
+    status = VIDENC_process(dev->enc, &inBufDesc, &outBufDesc, &inArgs,
+        &outArgs);
+    if (status != VIDENC_EOK) {
+        GT_3trace(curMask, GT_7CLASS, "App-> %s: encoder process FAILED, "
+            "status = 0x%x, extendedError = 0x%x\n", dev->dev_name, status,
+            outArgs.extendedError);
+        return -1;
+    }
 
-        if (-1 == xioctl (fd, VIDIOC_S_CROP, &crop)) {
-                switch (errno) {
-                case EINVAL:
-                        /* Cropping not supported. */
-                        break;
-                default:
-                        /* Errors ignored. */
-                        break;
-                }
+    /* a remote encoder wrote it past the CPU's cache */
+    cache_from_codec(encodedBuf, outArgs.bytesGenerated);
+
+    return outArgs.bytesGenerated;
+}
+
+// 写一帧, info是它的序号, 时间戳和各阶段时间; 有-e时先压缩;
+// 有-f时加上帧头, 并记进索引
+static int write_frame(struct device *dev, XDAS_Int8 *frame, Int size,
+    Stats_Frame *info) {
+
+    FrameFile_FrameHeader header;
+    FrameFile_IndexEntry *entry;
+    unsigned int n;
+
+    if (dev->enc != NULL) {
+        if ((size = encode_frame(dev, frame, size)) < 0) {
+            return -1;
         }
-    } else {
-        /* Errors ignored. */
+        frame = encodedBuf;
     }
 
-    struct v4l2_format fmt;
-    unsigned int min;
+    info->submitted = now_ns();
 
-    CLEAR(fmt);
+    if (!record) {
+        return write_record(dev, NULL, 0, frame, size, size, info);
+    }
 
-    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    fmt.fmt.pix.width = IMG_WIDTH;
-    fmt.fmt.pix.height = IMG_HEIGHT;
-    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
-    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+    if (dev->indexed == dev->indexSize) {
+        n = dev->indexSize ? 2 * dev->indexSize : 1024;
+        entry = (FrameFile_IndexEntry *)realloc(dev->index,
+            n * sizeof(*entry));
+        if (entry == NULL) {
+            return -1;
+        }
+        dev->index = entry;
+        dev->indexSize = n;
+    }
 
-    if (-1 == xioctl(fd, VIDIOC_S_FMT, &fmt))
-    {
-        errno_exit("VIDIOC_S_FMT");
+    entry = &dev->index[dev->indexed];
+    entry->offset = dev->offset;
+    entry->timestamp = info->sensor;
+    entry->sequence = info->sequence;
+    entry->size = size;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = FRAMEFILE_FRAMEMAGIC;
+    header.size = size;
+    header.sequence = info->sequence;
+    header.timestamp = info->sensor;
+
+    if (write_record(dev, &header, sizeof(header), frame, size,
+        FRAMEFILE_ALIGN(sizeof(header) + size, dev->align), info) != 0) {
+        return -1;
     }
 
+    dev->indexed++;
 
-    /* Note VIDIOC_S_FMT may change width and height. */
+    return 0;
+}
 
-    /* Buggy driver paranoia. */
-    min = fmt.fmt.pix.width * 2;
-    if (fmt.fmt.pix.bytesperline < min)
-    {
-        fmt.fmt.pix.bytesperline = min;
+// 有-f时写索引和文件尾
+static int write_index(struct device *dev) {
+
+    FrameFile_Trailer *trailer;
+    char *blob;
+    int size;
+    int r;
+
+    size = FRAMEFILE_ALIGN(dev->indexed * sizeof(FrameFile_IndexEntry) +
+        sizeof(FrameFile_Trailer), dev->align);
+    if ((blob = (char *)calloc(1, size)) == NULL) {
+        return -1;
     }
 
-    min = fmt.fmt.pix.bytesperline * fmt.fmt.pix.height;
-    if (fmt.fmt.pix.sizeimage < min)
-    {
-        fmt.fmt.pix.sizeimage = min;
+    if (dev->indexed > 0) {
+        memcpy(blob, dev->index, dev->indexed * sizeof(FrameFile_IndexEntry));
     }
 
-    init_mmap();
+    trailer = (FrameFile_Trailer *)(blob + size - sizeof(*trailer));
+    trailer->indexOffset = dev->offset;
+    trailer->numFrames = dev->indexed;
+    trailer->magic = FRAMEFILE_INDEXMAGIC;
 
-    // printf("init device finish\n");
+    r = write_blob(dev, blob, size);
+    free(blob);
+
+    return r;
 }
 
+// 写完索引, 等待所有写完成并关闭输出文件
+static void close_output(struct device *dev) {
+
+    unsigned long writes, waits;
+    unsigned long long bytes;
 
+    if (record && ((dev->writer != NULL) || (dev->out != NULL))) {
+        write_index(dev);
+    }
 
-static void open_device(void) {
+    free(dev->index);
+    dev->index = NULL;
 
-    struct stat st;
+    if (dev->writer != NULL) {
+        Writer_stats(dev->writer, &writes, &bytes, &waits);
+        GT_4trace(curMask, GT_1CLASS, "App-> %s: %lu frames, %llu bytes "
+            "written, %lu waits for a free buffer\n", dev->dev_name, writes,
+            bytes, waits);
 
-    if (-1 == stat(dev_name, &st)) {
-        fprintf(stderr, "Cannot identify '%s': %d, %s/n", dev_name, errno,
+        if ((Writer_delete(dev->writer) != 0) && (dev->write_error == 0)) {
+            dev->write_error = errno;
+            fprintf(stderr, "%s: can't write output, %s\n", dev->dev_name,
                 strerror(errno));
-        exit(EXIT_FAILURE);
+        }
+        dev->writer = NULL;
     }
 
-    if (!S_ISCHR(st.st_mode)) {
-        fprintf(stderr, "%s is no device/n", dev_name);
-        exit(EXIT_FAILURE);
+    if (dev->out != NULL) {
+        fclose(dev->out);
+        dev->out = NULL;
     }
 
-    fd = open(dev_name, O_RDWR /* required */| O_NONBLOCK, 0);
+    free(dev->timing);
+    dev->timing = NULL;
+}
 
-    if (-1 == fd) {
-        fprintf(stderr, "Cannot open '%s': %d, %s/n", dev_name, errno,
-                strerror(errno));
-        exit(EXIT_FAILURE);
+// 取出的帧的序号和V4L2时间戳, 以ns计
+static void frame_info(Stats_Frame *info, struct v4l2_buffer *buf,
+    unsigned long long dequeued) {
+
+    memset(info, 0, sizeof(*info));
+    info->sequence = buf->sequence;
+    info->sensor = (unsigned long long)buf->timestamp.tv_sec * 1000000000ULL +
+        buf->timestamp.tv_usec * 1000ULL;
+    info->monotonic = (buf->flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) ==
+        V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+    info->dequeued = dequeued;
+}
+
+// 解码一帧已取出的图像并写入文件, 缓存还给驱动失败时返回-1
+static int read_frame(struct device *dev, struct v4l2_buffer *buf) {
+
+    IVIDDECCOPY_OutArgs decOutArgs;
+    XDAS_Int8 *frame;
+    Int size;
+    Int32 status;
+    int r;
+    unsigned long long t0;
+    Stats_Frame info;
+
+    t0 = now_ns();
+    frame = (XDAS_Int8 *)dev->buffers[buf->index].start;
+    size = frame_size(dev, buf);
+    frame_info(&info, buf, dev->last);
+
+    sync_dmabuf(dev, buf, 1);
+
+    if (dev->zero_copy) {
+        /* the codec reads the driver's buffer; requeue it afterwards */
+        info.started = now_ns();
+        status = decode_frame(dev->dec, frame, size, outBuf,
+            buf->sequence + 1, &decOutArgs);
+        info.ended = now_ns();
+        sync_dmabuf(dev, buf, 0);
+        r = requeue_frame(dev, buf);
+    }
+    else {
+        size = size < inFrameSize ? size : inFrameSize;
+        memcpy(inBuf, frame, size);
+        sync_dmabuf(dev, buf, 0);
+        r = requeue_frame(dev, buf);
+        cache_to_codec(inBuf, size);
+        info.started = now_ns();
+        status = decode_frame(dev->dec, inBuf, size, outBuf,
+            buf->sequence + 1, &decOutArgs);
+        info.ended = now_ns();
     }
 
-    // printf("open device finish\n");
+    dev->frames++;
 
-}
+    if (status != VIDDEC_EOK) {
+        GT_4trace(curMask, GT_7CLASS,
+            "App-> %s frame %d processing FAILED, status = 0x%x, "
+            "extendedError = 0x%x\n", dev->dev_name, buf->sequence, status,
+            decOutArgs.viddecOutArgs.extendedError);
+        return r;
+    }
 
-static void stop_capturing(void) {
+    /* write to file */
+    if (write_frame(dev, outBuf, decOutArgs.outputBytes, &info) != 0) {
+        return -1;
+    }
 
-    enum v4l2_buf_type type;
+    work_ns += now_ns() - t0;
+    work_frames++;
 
-    type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    return r;
+}
 
-    if (-1 == xioctl(fd, VIDIOC_STREAMOFF, &type))
-        errno_exit("VIDIOC_STREAMOFF");
 
+// 设备出错或停顿: 停止采集, 其它设备继续
+static void retire_device(int epfd, struct device *dev, const char *why) {
+
+    if (why != NULL) {
+        fprintf(stderr, "%s: %s after %u frames, dropped\n", dev->dev_name,
+            why, dev->frames);
+        dev->failed = 1;
+    }
+
+    epoll_ctl(epfd, EPOLL_CTL_DEL, dev->fd, NULL);
+    stop_capturing(dev);
 }
 
 
-static void uninit_device(void) {
+// 用一个epoll服务所有设备, 每次唤醒取完设备上所有就绪的帧
+static void mainloop(void) {
 
-    unsigned int i;
+    struct epoll_event events[MAX_DEVICES];
+    struct epoll_event ev;
+    struct v4l2_buffer buf;
+    struct device *dev;
+    unsigned long long now;
+    int active = 0;
+    int epfd;
+    int got;
+    int i, n, r;
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (-1 == epfd)
+        errno_exit("epoll_create1");
+
+    for (i = 0; i < n_devices; i++) {
+        CLEAR(ev);
+        ev.events = EPOLLIN;
+        ev.data.ptr = &devices[i];
+
+        if (-1 == epoll_ctl(epfd, EPOLL_CTL_ADD, devices[i].fd, &ev))
+            errno_exit("EPOLL_CTL_ADD");
+
+        devices[i].last = now_ns();
+        active++;
+    }
 
-    for (i = 0; i < n_buffers; ++i)
-        if (-1 == munmap(buffers[i].start, buffers[i].length))
-            errno_exit("munmap");
+    while (active > 0) {
 
+        n = epoll_wait(epfd, events, MAX_DEVICES, 1000);
 
-    free(buffers);
-}
+        if (-1 == n) {
+            if (EINTR == errno)
+                continue;
 
-static void close_device(void) {
+            errno_exit("epoll_wait");
+        }
 
-    if (-1 == close(fd))
-        errno_exit("close");
+        for (i = 0; i < n; i++) {
 
-    fd = -1;
-}
+            dev = (struct device *)events[i].data.ptr;
 
+            /* everything the driver has filled, not just one buffer */
+            for (got = 0, r = 0; dev->frames < frame_count; got++) {
+                if ((r = dequeue_frame(dev, &buf)) <= 0)
+                    break;
+                if ((r = read_frame(dev, &buf)) < 0)
+                    break;
+            }
 
-/*
- *  ======== createInFileIfMissing ========
- */
-static void createInFileIfMissing( char *inFileName )
-{
+            if ((r < 0) ||
+                ((got == 0) && (events[i].events & (EPOLLERR | EPOLLHUP)))) {
+                retire_device(epfd, dev, "i/o error");
+                active--;
+            }
+            else if (dev->frames >= frame_count) {
+                retire_device(epfd, dev, NULL);
+                active--;
+            }
+        }
 
-    int i;
-    FILE *f = fopen(inFileName, "rb");
-    if (f == NULL) {
-        printf( "Input file '%s' not found, generating one.\n", inFileName );
-        f = fopen( inFileName, "wb" );
-        for (i = 0; i < 1024; i++) {
-            fwrite(&i, sizeof(i), 1, f);
+        now = now_ns();
+
+        for (i = 0; i < n_devices; i++) {
+            dev = &devices[i];
+            if (dev->streaming && (now - dev->last > STALL_NS)) {
+                retire_device(epfd, dev, "stalled");
+                active--;
+            }
         }
     }
 
-    fclose( f );
+    close(epfd);
 }
 
-/*
- *  ======== smain ========
- */
-Int smain(Int argc, String argv[])
-{
 
-    Engine_Handle ce = NULL;
-    VIDDEC_Handle dec = NULL;
-    VIDENC_Handle enc = NULL;
+static void v4l2_start(struct device *dev) {
 
+    unsigned int i;
+    enum v4l2_buf_type type;
 
-    String inFile, outFile;
 
-    Memory_AllocParams allocParams;
+    for (i = 0; i < dev->n_buffers; ++i) {
+
+        struct v4l2_buffer buf;
+
+        CLEAR(buf);
+
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = io_memory(dev);
+        buf.index = i;
+
+        if (dev->io == IO_METHOD_USERPTR) {
+            buf.m.userptr = (unsigned long)dev->buffers[i].start;
+            buf.length = dev->buffers[i].length;
+        }
+#ifdef HAVE_DMABUF
+        else if (dev->io == IO_METHOD_DMABUF) {
+            buf.m.fd = dev->buffers[i].dmafd;
+            buf.length = dev->buffers[i].length;
+        }
+#endif
+
+        if (-1 == xioctl(dev->fd, VIDIOC_QBUF, &buf)) {//将拍摄的图像数据放入缓存队列
+            errno_exit("VIDIOC_QBUF");
+        }
 
-    if (argc <= 1) {
-        inFile = "./in.dat";
-        outFile = "./out.dat";
-        createInFileIfMissing(inFile);
-    }
-    else if (argc == 4) {
-        progName = argv[0];
-        dev_name = argv[1];
-        inFile = argv[2];
-        outFile = argv[3];
     }
-    else {
-        fprintf(stderr, usage, argv[0]);
-        exit(1);
+
+    type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+    if (-1 == xioctl(dev->fd, VIDIOC_STREAMON, &type)) {
+
+        errno_exit("VIDIOC_STREAMON");
     }
 
+    dev->streaming = 1;
+    dev->last = now_ns();
 
+    // printf("start capture finish\n");
+}
 
-    GT_0trace(curMask, GT_1CLASS, "App-> Application started.\n");
 
-    /* allocate input, encoded, and output buffers */
-    allocParams.type = Memory_CONTIGPOOL;
-    allocParams.flags = Memory_NONCACHED;
-    allocParams.align = BUFALIGN;
-    allocParams.seg = 0;
+// 向驱动申请缓存, 返回实际得到的数量; 驱动不支持该内存类型时返回-1
+static int request_buffers(struct device *dev, enum v4l2_memory memory,
+    unsigned int count) {
 
-    inBuf = (XDAS_Int8 *)Memory_alloc(IFRAMESIZE, &allocParams);
-    encodedBuf = (XDAS_Int8 *)Memory_alloc(EFRAMESIZE, &allocParams);
-    outBuf = (XDAS_Int8 *)Memory_alloc(OFRAMESIZE, &allocParams);
+    struct v4l2_requestbuffers req;  //缓冲区结构体
 
-    grayBuf =  (unsigned char*)Memory_alloc(OFRAMESIZE, &allocParams);
+    CLEAR(req);
 
-    if ((inBuf == NULL) || (encodedBuf == NULL) || 
-        (outBuf == NULL) || (grayBuf == NULL)) {
-        goto end;
+    req.count = count;  //缓存数量，设置缓存区队列里保持多少张照片
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = memory;
+
+    if (-1 == xioctl(dev->fd, VIDIOC_REQBUFS, &req)) {
+        if ((EINVAL == errno) || (count == 0)) {
+            return -1;
+        } else {
+            errno_exit("VIDIOC_REQBUFS");
+        }
     }
 
-    /* open file streams for input and output */
-    if ((in = fopen(inFile, "rb")) == NULL) {
-        printf("App-> ERROR: can't read file %s\n", inFile);
-        goto end;
+    if (count == 0) {
+        return 0;
     }
 
-    if ((out = fopen(outFile, "wb")) == NULL) {
-        printf("App-> ERROR: can't write to file %s\n", outFile);
-        goto end;
+    if (req.count < 2) {
+        fprintf(stderr, "Insufficient buffer memory on %s/n", dev->dev_name);
+        exit(EXIT_FAILURE);
     }
 
-    GT_0trace(curMask, GT_1CLASS, "Video -> Video capture started.\n");
+    dev->buffers = (struct buffer *)calloc(req.count, sizeof(struct buffer));
+
+    if (!dev->buffers) {
+
+        fprintf(stderr, "Out of memory/n");
+        exit(EXIT_FAILURE);
+    }
 
-    open_device();
-    init_device();
-    start_capturing();
-    mainloop();
+    for (dev->n_buffers = 0; dev->n_buffers < req.count; ++dev->n_buffers) {
+        dev->buffers[dev->n_buffers].dmafd = -1;
+    }
 
-    stop_capturing();
-    uninit_device();
-    close_device();
+    return req.count;
+}
 
-    GT_0trace(curMask, GT_1CLASS, "Video -> Video capture done.\n");
 
+static int init_mmap(struct device *dev) {
 
-    /* reset, load, and start DSP Engine */
-    if ((ce = Engine_open(engineName, NULL, NULL)) == NULL) {
-        fprintf(stderr, "%s: error: can't open engine %s\n",
-            progName, engineName);
-        goto end;
-    }
+    struct buffer *b;
+    int count;
 
-    /* allocate and initialize video decoder on the engine */
-    dec = VIDDEC_create(ce, decoderName, NULL);
-    if (dec == NULL) {
-        printf( "App-> ERROR: can't open codec %s\n", decoderName);
-        goto end;
+    count = request_buffers(dev, V4L2_MEMORY_MMAP, numBuffers);  //方法为内存映射方法
+    if (-1 == count) {
+        return -1;
     }
 
-    /* allocate and initialize video encoder on the engine */
-    enc = VIDENC_create(ce, encoderName, NULL);
-    if (enc == NULL) {
-        fprintf(stderr, "%s: error: can't open codec %s\n",
-            progName, encoderName);
-        goto end;
+    for (dev->n_buffers = 0; dev->n_buffers < count; ++dev->n_buffers) {
+
+        struct v4l2_buffer buf;
+
+        CLEAR(buf);
+
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = dev->n_buffers;
+
+        if (-1 == xioctl(dev->fd, VIDIOC_QUERYBUF, &buf)) {
+            errno_exit("VIDIOC_QUERYBUF");
+        }
+
+
+        b = &dev->buffers[dev->n_buffers];
+        b->length = buf.length;
+        b->start = mmap(NULL /* start anywhere */, buf.length,
+                PROT_READ | PROT_WRITE /* required */,
+                MAP_SHARED /* recommended */, dev->fd, buf.m.offset);  //缓冲区起始存储位置
+
+        if (MAP_FAILED == b->start){
+            errno_exit("mmap");
+        }
+
+#ifdef VIDIOC_EXPBUF
+        /* export as dma-buf so other devices can share the frames */
+        if (export_dmabuf) {
+            struct v4l2_exportbuffer expbuf;
+
+            CLEAR(expbuf);
+            expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            expbuf.index = dev->n_buffers;
+            expbuf.flags = O_RDWR | O_CLOEXEC;
+
+            if (-1 == xioctl(dev->fd, VIDIOC_EXPBUF, &expbuf)) {
+                fprintf(stderr, "%s: VIDIOC_EXPBUF failed, %s\n",
+                    dev->dev_name, strerror(errno));
+                export_dmabuf = 0;
+            }
+            else {
+                b->dmafd = expbuf.fd;
+            }
+        }
+#endif
     }
 
-    /* use engine to encode, then decode the data */
-    encode_decode(enc, dec, in, out);
+    return 0;
+}
+
 
-    goto end;
+// 用户指针方式: 驱动直接DMA到连续内存池中分配的缓存
+static int init_userptr(struct device *dev, unsigned int buffer_size) {
 
-end:
-    /* teardown the codecs */
-    if (enc) {
-        VIDENC_delete(enc);
+    int count;
+
+    count = request_buffers(dev, V4L2_MEMORY_USERPTR, numBuffers);
+    if (-1 == count) {
+        return -1;
     }
 
-    if (dec) {
-        VIDDEC_delete(dec);
+    /* whole pages, as required for get_user_pages() in the driver */
+    buffer_size = (buffer_size + 4095) & ~4095;
+
+    for (dev->n_buffers = 0; dev->n_buffers < count; ++dev->n_buffers) {
+
+        dev->buffers[dev->n_buffers].length = buffer_size;
+        dev->buffers[dev->n_buffers].start = Memory_alloc(buffer_size,
+            &captureAllocParams);
+
+        if (!dev->buffers[dev->n_buffers].start) {
+            fprintf(stderr, "Out of contiguous memory/n");
+            exit(EXIT_FAILURE);
+        }
     }
 
-    /* close the engine */
-    if (ce) {
-        Engine_close(ce);
+    return 0;
+}
+
+
+// DMABUF方式: 从dma-heap分配缓存, 把fd交给驱动
+static int init_dmabuf(struct device *dev, unsigned int buffer_size) {
+
+#ifdef HAVE_DMABUF
+    int heap = -1;
+    int count;
+    int i;
+
+    for (i = 0; dma_heaps[i] != NULL && heap == -1; i++) {
+        heap = open(dma_heaps[i], O_RDWR | O_CLOEXEC);
     }
 
-    /* close the files */
-    if (in) {
-        fclose(in);
+    if (-1 == heap) {
+        return -1;
     }
 
-    if (out) {
-        fclose(out);
+    count = request_buffers(dev, V4L2_MEMORY_DMABUF, numBuffers);
+    if (-1 == count) {
+        close(heap);
+        return -1;
     }
 
-    /* free buffers */
-    if (inBuf) {
-        Memory_free(inBuf, IFRAMESIZE, &allocParams);
+    buffer_size = (buffer_size + 4095) & ~4095;
+
+    for (dev->n_buffers = 0; dev->n_buffers < count; ++dev->n_buffers) {
+
+        struct dma_heap_allocation_data alloc;
+
+        CLEAR(alloc);
+        alloc.len = buffer_size;
+        alloc.fd_flags = O_RDWR | O_CLOEXEC;
+
+        if (-1 == xioctl(heap, DMA_HEAP_IOCTL_ALLOC, &alloc)) {
+            errno_exit("DMA_HEAP_IOCTL_ALLOC");
+        }
+
+        dev->buffers[dev->n_buffers].dmafd = alloc.fd;
+        dev->buffers[dev->n_buffers].length = buffer_size;
+        dev->buffers[dev->n_buffers].start = mmap(NULL, buffer_size,
+            PROT_READ | PROT_WRITE, MAP_SHARED, alloc.fd, 0);
+
+        if (MAP_FAILED == dev->buffers[dev->n_buffers].start) {
+            errno_exit("mmap");
+        }
     }
 
-    if (encodedBuf) {
-        Memory_free(encodedBuf, EFRAMESIZE, &allocParams);
+    close(heap);
+
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+
+// 按io选择采集方式, 驱动拒绝时依次退回 dmabuf -> userptr -> mmap
+static void init_io(struct device *dev, unsigned int buffer_size) {
+
+    int r = -1;
+
+    switch (dev->io) {
+    case IO_METHOD_DMABUF:
+        if (0 == (r = init_dmabuf(dev, buffer_size)))
+            break;
+
+        fprintf(stderr, "%s: dmabuf i/o not available, trying userptr\n",
+            dev->dev_name);
+        dev->io = IO_METHOD_USERPTR;
+
+        /* fall through */
+
+    case IO_METHOD_USERPTR:
+        if (0 == (r = init_userptr(dev, buffer_size)))
+            break;
+
+        fprintf(stderr, "%s: userptr i/o not supported, trying mmap\n",
+            dev->dev_name);
+
+        /* fall through */
+
+    default:
+        dev->io = IO_METHOD_MMAP;
+        r = init_mmap(dev);
+        break;
     }
 
-    if (outBuf) {
-        Memory_free(outBuf, OFRAMESIZE, &allocParams);
+    if (-1 == r) {
+        fprintf(stderr, "%s does not support "
+                "memory mapping/n", dev->dev_name);
+        exit(EXIT_FAILURE);
     }
+}
+
 
-    if (grayBuf) {
-        Memory_free(grayBuf, OFRAMESIZE, &allocParams);
+// 设备的图像格式决定所有缓存的大小; 其它设备必须和第一个设备格式相同
+static void set_format(struct device *dev, unsigned int width,
+    unsigned int height, unsigned int pitch, unsigned int size) {
+
+    if (dev != &devices[0]) {
+        /* every device feeds the same buffers and decoder setup */
+        if ((width != img_width) || (height != img_height) ||
+            (pitch != img_pitch) || (size != (unsigned int)inFrameSize)) {
+            fprintf(stderr, "%s: format %ux%u differs from %s\n",
+                dev->dev_name, width, height, devices[0].dev_name);
+            exit(EXIT_FAILURE);
+        }
     }
 
-    GT_0trace(curMask, GT_1CLASS, "app done.\n");
-    return (0);
+    img_width = width;
+    img_height = height;
+    img_pitch = pitch;
+
+    inFrameSize = size;
+    if ((outFrameSize = output_size()) < 0) {
+        fprintf(stderr, "%s: region %d,%d,%d,%d of -r is outside its %ux%u "
+            "frames\n", dev->dev_name, cropX, cropY, cropWidth, cropHeight,
+            width, height);
+        exit(EXIT_FAILURE);
+    }
+    encFrameSize = IVIDENCGRAY_MAXSIZE(out_width, out_height);
 }
 
-/*
- *  ======== encode_decode ========
- */
-static Void encode_decode(VIDENC_Handle enc, VIDDEC_Handle dec, FILE *in,
-    FILE *out)
-{
 
-    Int                         n;
-    Int32                       status;
+static void v4l2_init(struct device *dev) {
 
-    VIDDEC_InArgs               decInArgs;
-    VIDDEC_OutArgs              decOutArgs;
-    VIDDEC_DynamicParams        decDynParams;
-    VIDDEC_Status               decStatus;
+    struct v4l2_capability cap;
 
-    VIDENC_InArgs               encInArgs;
-    VIDENC_OutArgs              encOutArgs;
-    VIDENC_DynamicParams        encDynParams;
-    VIDENC_Status               encStatus;
+    //query device capability
+    if (-1 == xioctl(dev->fd, VIDIOC_QUERYCAP, &cap)) {
+        if (EINVAL == errno) {
+            fprintf(stderr, "%s is no V4L2 device/n", dev->dev_name);
+            exit(EXIT_FAILURE);
+        } else {
+            errno_exit("VIDIOC_QUERYCAP");
+        }
+    }
 
-    XDM_BufDesc                 inBufDesc;
-    XDAS_Int8                  *src[XDM_MAX_IO_BUFFERS];
-    XDAS_Int32                  inBufSizes[XDM_MAX_IO_BUFFERS];
+    if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE)) {
+        fprintf(stderr, "%s is no video capture device/n", dev->dev_name);
+        exit(EXIT_FAILURE);
+    }
 
-    XDM_BufDesc                 encodedBufDesc;
-    XDAS_Int8                  *encoded[XDM_MAX_IO_BUFFERS];
-    XDAS_Int32                  encBufSizes[XDM_MAX_IO_BUFFERS];
 
-    XDM_BufDesc                 outBufDesc;
-    XDAS_Int8                  *dst[XDM_MAX_IO_BUFFERS];
-    XDAS_Int32                  outBufSizes[XDM_MAX_IO_BUFFERS];
+    if (!(cap.capabilities & V4L2_CAP_STREAMING)) { //是否支持流操作，支持数据流控制
+        fprintf(stderr, "%s does not support streaming i/o/n", dev->dev_name);
+        exit(EXIT_FAILURE);
+    }
+
+
+    /* Select video input, video standard and tune here. */
+    struct v4l2_cropcap cropcap;
+    struct v4l2_crop crop;
 
-    /* clear and initialize the buffer descriptors */
-    memset(src,     0, sizeof(src[0])     * XDM_MAX_IO_BUFFERS);
-    memset(encoded, 0, sizeof(encoded[0]) * XDM_MAX_IO_BUFFERS);
-    memset(dst,     0, sizeof(dst[0])     * XDM_MAX_IO_BUFFERS);
+    CLEAR(cropcap);
 
-    src[0]     = inBuf;
-    encoded[0] = encodedBuf;
-    dst[0]     = outBuf;
+    cropcap.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;  //表示支持图像获取
 
-    inBufDesc.numBufs = encodedBufDesc.numBufs = outBufDesc.numBufs = 1;
+    if (0 == xioctl (dev->fd, VIDIOC_CROPCAP, &cropcap)) {
+        crop.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        crop.c = cropcap.defrect; /* reset to default */
 
-    inBufDesc.bufSizes      = inBufSizes;
-    encodedBufDesc.bufSizes = encBufSizes;
-    outBufDesc.bufSizes     = outBufSizes;
+        if (-1 == xioctl (dev->fd, VIDIOC_S_CROP, &crop)) {
+                switch (errno) {
+                case EINVAL:
+                        /* Cropping not supported. */
+                        break;
+                default:
+                        /* Errors ignored. */
+                        break;
+                }
+        }
+    } else {
+        /* Errors ignored. */
+    }
 
-    inBufSizes[0] = encBufSizes[0] = outBufSizes[0] = NSAMPLES;
+    struct v4l2_format fmt;
+    unsigned int min;
 
-    inBufDesc.bufs      = src;
-    encodedBufDesc.bufs = encoded;
-    outBufDesc.bufs     = dst;
+    CLEAR(fmt);
 
-    /* initialize all "sized" fields */
-    encInArgs.size    = sizeof(encInArgs);
-    decInArgs.size    = sizeof(decInArgs);
-    encOutArgs.size   = sizeof(encOutArgs);
-    decOutArgs.size   = sizeof(decOutArgs);
-    encDynParams.size = sizeof(encDynParams);
-    decDynParams.size = sizeof(decDynParams);
-    encStatus.size    = sizeof(encStatus);
-    decStatus.size    = sizeof(decStatus);
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    fmt.fmt.pix.width = img_width;
+    fmt.fmt.pix.height = img_height;
+    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
 
-    /*
-     * Query the encoder and decoder.
-     * This app expects the encoder to provide 1 buf in and get 1 buf out,
-     * and the buf sizes of the in and out buffer must be able to handle
-     * NSAMPLES bytes of data.
-     */
-    status = VIDENC_control(enc, XDM_GETSTATUS, &encDynParams, &encStatus);
-    if (status != VIDENC_EOK) {
-        /* failure, report error and exit */
-        GT_1trace(curMask, GT_7CLASS, "encode control status = 0x%x\n", status);
-        return;
+    if (-1 == xioctl(dev->fd, VIDIOC_S_FMT, &fmt))
+    {
+        errno_exit("VIDIOC_S_FMT");
     }
 
-    /* Validate this encoder codec will meet our buffer requirements */
-    if ((inBufDesc.numBufs < encStatus.bufInfo.minNumInBufs) ||
-        (IFRAMESIZE < encStatus.bufInfo.minInBufSize[0]) ||
-        (encodedBufDesc.numBufs < encStatus.bufInfo.minNumOutBufs) ||
-        (EFRAMESIZE < encStatus.bufInfo.minOutBufSize[0])) {
 
-        /* failure, report error and exit */
-        GT_0trace(curMask, GT_7CLASS,
-            "Error:  encoder codec feature conflict\n");
-        return;
+    /* Note VIDIOC_S_FMT may change width and height. */
+
+    /* Buggy driver paranoia. */
+    min = fmt.fmt.pix.width * 2;
+    if (fmt.fmt.pix.bytesperline < min)
+    {
+        fmt.fmt.pix.bytesperline = min;
     }
 
-    status = VIDDEC_control(dec, XDM_GETSTATUS, &decDynParams, &decStatus);
-    if (status != VIDDEC_EOK) {
-        /* failure, report error and exit */
-        GT_1trace(curMask, GT_7CLASS, "decode control status = 0x%x\n", status);
-        return;
+    min = fmt.fmt.pix.bytesperline * fmt.fmt.pix.height;
+    if (fmt.fmt.pix.sizeimage < min)
+    {
+        fmt.fmt.pix.sizeimage = min;
     }
 
-    /* Validate this decoder codec will meet our buffer requirements */
-    if ((inBufDesc.numBufs < decStatus.bufInfo.minNumInBufs) ||
-        (EFRAMESIZE < decStatus.bufInfo.minInBufSize[0]) ||
-        (outBufDesc.numBufs < decStatus.bufInfo.minNumOutBufs) ||
-        (OFRAMESIZE < decStatus.bufInfo.minOutBufSize[0])) {
+    set_format(dev, fmt.fmt.pix.width, fmt.fmt.pix.height,
+        fmt.fmt.pix.bytesperline, fmt.fmt.pix.sizeimage);
 
-        /* failure, report error and exit */
-        GT_0trace(curMask, GT_7CLASS,
-            "App-> ERROR: decoder does not meet buffer requirements.\n");
-        return;
-    }
+    dev->io = io;
+    init_io(dev, fmt.fmt.pix.sizeimage);
 
-    /*
-     * Read complete frames from in, encode, decode, and write to out.
-     */
-    for (n = 0; fread(inBuf, IFRAMESIZE, 1, in) == 1; n++) {
+    // printf("init device finish\n");
+}
 
-        /* decode the frame */
-        status = VIDDEC_process(dec, &inBufDesc, &outBufDesc, &decInArgs,
-           &decOutArgs);
 
-        // GT_2trace(curMask, GT_2CLASS,
-        //     "App-> Decoder frame %d process returned - 0x%x)\n",
-        //     n, status);
 
-        if (status != VIDDEC_EOK) {
-            GT_3trace(curMask, GT_7CLASS,
-                "App-> Decoder frame %d processing FAILED, status = 0x%x, "
-                "extendedError = 0x%x\n", n, status, decOutArgs.extendedError);
-            break;
-        }
+static void v4l2_open(struct device *dev) {
 
+    struct stat st;
+
+    if (-1 == stat(dev->dev_name, &st)) {
+        fprintf(stderr, "Cannot identify '%s': %d, %s/n", dev->dev_name, errno,
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    if (!S_ISCHR(st.st_mode)) {
+        fprintf(stderr, "%s is no device/n", dev->dev_name);
+        exit(EXIT_FAILURE);
+    }
+
+    dev->fd = open(dev->dev_name, O_RDWR /* required */| O_NONBLOCK, 0);
+
+    if (-1 == dev->fd) {
+        fprintf(stderr, "Cannot open '%s': %d, %s/n", dev->dev_name, errno,
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    // printf("open device finish\n");
+
+}
+
+static void v4l2_stop(struct device *dev) {
+
+    enum v4l2_buf_type type;
+
+    if (!dev->streaming)
+        return;
+
+    type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+    /* a device that failed may refuse this, it is done either way */
+    if (-1 == xioctl(dev->fd, VIDIOC_STREAMOFF, &type))
+        fprintf(stderr, "%s: VIDIOC_STREAMOFF error %d, %s\n",
+            dev->dev_name, errno, strerror(errno));
+
+    dev->streaming = 0;
+}
+
+
+static void v4l2_uninit(struct device *dev) {
+
+    unsigned int i;
+
+    for (i = 0; i < dev->n_buffers; ++i) {
+        if (dev->io == IO_METHOD_USERPTR) {
+            Memory_free(dev->buffers[i].start, dev->buffers[i].length,
+                &captureAllocParams);
+        }
+        else if (-1 == munmap(dev->buffers[i].start,
+            dev->buffers[i].length)) {
+            errno_exit("munmap");
+        }
+
+        if (dev->buffers[i].dmafd != -1) {
+            close(dev->buffers[i].dmafd);
+        }
+    }
+
+    /* release the driver's side before the memory type may change */
+    request_buffers(dev, io_memory(dev), 0);
+
+    free(dev->buffers);
+    dev->buffers = NULL;
+    dev->n_buffers = 0;
+}
+
+static void v4l2_close(struct device *dev) {
+
+    if (-1 == close(dev->fd))
+        errno_exit("close");
+
+    dev->fd = -1;
+}
+
+
+// 软件帧源(file:和synth:)的公共部分: 像驱动一样维护一个空闲缓存队列.
+// 不限帧率时fd是个eventfd, 计数就是队列里的缓存数; 限定帧率时是个timerfd,
+// 每帧到期一次
+static void soft_open(struct device *dev) {
+
+    if (dev->fps > 0)
+        dev->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    else
+        dev->fd = eventfd(0, EFD_NONBLOCK | EFD_SEMAPHORE | EFD_CLOEXEC);
+
+    if (-1 == dev->fd)
+        errno_exit(dev->fps > 0 ? "timerfd_create" : "eventfd");
+
+    pthread_mutex_init(&dev->lock, NULL);
+}
+
+// 回放的文件
+static void file_open(struct device *dev) {
+
+    dev->file = fopen(dev->path, "rb");
+
+    if (NULL == dev->file) {
+        fprintf(stderr, "Cannot open '%s': %d, %s\n", dev->path, errno,
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    soft_open(dev);
+}
+
+static const char *synth_patterns[] = { "ramp", "bars", "noise", NULL };
+
+// 合成图像的种类
+static void synth_open(struct device *dev) {
+
+    for (dev->pattern = 0; synth_patterns[dev->pattern] != NULL;
+        dev->pattern++) {
+        if (strcmp(dev->path, synth_patterns[dev->pattern]) == 0)
+            break;
+    }
+
+    if (NULL == synth_patterns[dev->pattern]) {
+        fprintf(stderr, "%s: no pattern '%s'\n", dev->dev_name, dev->path);
+        exit(EXIT_FAILURE);
+    }
+
+    soft_open(dev);
+}
+
+// 和userptr方式一样从连续内存池分配缓存, 远端编解码器也能直接读
+static void soft_buffers(struct device *dev) {
+
+    struct buffer *b;
+    unsigned int size = (inFrameSize + 4095) & ~4095;
+
+    dev->buffers = (struct buffer *)calloc(numBuffers, sizeof(struct buffer));
+
+    if (!dev->buffers) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (dev->n_buffers = 0; dev->n_buffers < numBuffers; ++dev->n_buffers) {
+
+        b = &dev->buffers[dev->n_buffers];
+        b->dmafd = -1;
+        b->length = size;
+        b->start = Memory_alloc(size, &captureAllocParams);
+
+        if (!b->start) {
+            fprintf(stderr, "Out of contiguous memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    dev->io = IO_METHOD_USERPTR;
+}
+
+// 用-f -o yuyv录的文件自带格式, 其它文件是-W x -H的YUYV帧
+static void file_init(struct device *dev) {
+
+    FrameFile_Header header;
+    struct stat st;
+    unsigned int pitch;
+
+    rewind(dev->file);
+
+    if (0 == read_header(dev->file, &header)) {
+        if (header.fourcc != V4L2_PIX_FMT_YUYV) {
+            fprintf(stderr, "%s doesn't hold YUYV frames, see -o yuyv\n",
+                dev->path);
+            exit(EXIT_FAILURE);
+        }
+
+        pitch = header.pitch ? header.pitch : header.width * 2;
+        set_format(dev, header.width, header.height, pitch,
+            pitch * header.height);
+
+        dev->numFrames = read_index(dev->file, &header, &dev->inIndex);
+    }
+    else {
+        set_format(dev, img_width, img_height, img_width * 2,
+            img_width * 2 * img_height);
+
+        if (-1 == fstat(fileno(dev->file), &st))
+            errno_exit("fstat");
+
+        dev->numFrames = st.st_size / inFrameSize;
+    }
+
+    if (dev->numFrames <= 0) {
+        fprintf(stderr, "%s has no frames\n", dev->path);
+        exit(EXIT_FAILURE);
+    }
+
+    soft_buffers(dev);
+}
+
+// 合成图像是-W x -H的YUYV帧
+static void synth_init(struct device *dev) {
+
+    set_format(dev, img_width, img_height, img_width * 2,
+        img_width * 2 * img_height);
+
+    soft_buffers(dev);
+}
+
+// 所有缓存放入队列, 开始计时
+static void soft_start(struct device *dev) {
+
+    struct itimerspec its;
+    unsigned long long period;
+    eventfd_t n;
+    unsigned int i;
+
+    pthread_mutex_lock(&dev->lock);
+
+    for (i = 0; i < dev->n_buffers; i++)
+        dev->queue[i] = i;
+
+    dev->head = 0;
+    dev->queued = dev->n_buffers;
+    dev->sequence = 0;
+    dev->due = 0;
+
+    if (dev->fps > 0) {
+        /* frame k is due at epoch + k periods */
+        period = 1000000000ULL / dev->fps;
+        dev->epoch = now_ns() + period;
+
+        CLEAR(its);
+        its.it_value.tv_sec = dev->epoch / 1000000000ULL;
+        its.it_value.tv_nsec = dev->epoch % 1000000000ULL;
+        its.it_interval.tv_sec = period / 1000000000ULL;
+        its.it_interval.tv_nsec = period % 1000000000ULL;
+
+        if (-1 == timerfd_settime(dev->fd, TFD_TIMER_ABSTIME, &its, NULL))
+            errno_exit("timerfd_settime");
+    }
+    else {
+        /* left over from an earlier run */
+        while (0 == eventfd_read(dev->fd, &n))
+            ;
+
+        if (-1 == eventfd_write(dev->fd, dev->n_buffers))
+            errno_exit("eventfd_write");
+    }
+
+    pthread_mutex_unlock(&dev->lock);
+
+    dev->streaming = 1;
+    dev->last = now_ns();
+}
+
+// 取出一帧. 限定帧率时只有到期的帧可取; 和驱动一样, 没有空闲缓存接收的帧
+// 被丢掉, 序号照样增加
+static int soft_dequeue(struct device *dev, struct v4l2_buffer *buf) {
+
+    struct buffer *b;
+    unsigned long long ns;
+    unsigned int sequence;
+    unsigned int index;
+    uint64_t n;
+    int size;
+
+    pthread_mutex_lock(&dev->lock);
+
+    if (dev->fps > 0) {
+        if (read(dev->fd, &n, sizeof(n)) == sizeof(n))
+            dev->due += n;
+
+        /* the free buffers get the latest of the frames due */
+        if (dev->due > dev->queued) {
+            dev->sequence += dev->due - dev->queued;
+            dev->due = dev->queued;
+        }
+
+        if (0 == dev->due) {
+            pthread_mutex_unlock(&dev->lock);
+            return 0;
+        }
+
+        dev->due--;
+    }
+    else if (0 == dev->queued) {
+        pthread_mutex_unlock(&dev->lock);
+        return 0;
+    }
+    else {
+        eventfd_read(dev->fd, &n);  /* one buffer less */
+    }
+
+    index = dev->queue[dev->head];
+    dev->head = (dev->head + 1) % SOFT_BUFFERS;
+    dev->queued--;
+    sequence = dev->sequence++;
+
+    pthread_mutex_unlock(&dev->lock);
+
+    ns = dev->fps > 0 ? dev->epoch + sequence * (1000000000ULL / dev->fps) :
+        now_ns();
+
+    b = &dev->buffers[index];
+    if ((size = dev->src->fill(dev, b, sequence)) < 0)
+        return -1;
+
+    CLEAR(*buf);
+
+    buf->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf->memory = V4L2_MEMORY_USERPTR;
+    buf->index = index;
+    buf->m.userptr = (unsigned long)b->start;
+    buf->length = b->length;
+    buf->bytesused = size;
+    buf->sequence = sequence;
+    buf->flags = V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+    buf->timestamp.tv_sec = ns / 1000000000ULL;
+    buf->timestamp.tv_usec = ns % 1000000000ULL / 1000;
+
+    return 1;
+}
+
+// 缓存放回队列
+static int soft_requeue(struct device *dev, struct v4l2_buffer *buf) {
+
+    int r = 0;
+
+    pthread_mutex_lock(&dev->lock);
+
+    dev->queue[(dev->head + dev->queued) % SOFT_BUFFERS] = buf->index;
+    dev->queued++;
+
+    /* under the lock, so the count never runs ahead of the queue */
+    if ((0 == dev->fps) && (-1 == eventfd_write(dev->fd, 1))) {
+        fprintf(stderr, "%s: eventfd_write error %d, %s\n",
+            dev->dev_name, errno, strerror(errno));
+        r = -1;
+    }
+
+    pthread_mutex_unlock(&dev->lock);
+
+    return r;
+}
+
+static void soft_stop(struct device *dev) {
+
+    struct itimerspec its;
+
+    if (!dev->streaming)
+        return;
+
+    if (dev->fps > 0) {
+        CLEAR(its);
+        timerfd_settime(dev->fd, 0, &its, NULL);
+    }
+
+    dev->streaming = 0;
+}
+
+static void soft_uninit(struct device *dev) {
+
+    unsigned int i;
+
+    for (i = 0; i < dev->n_buffers; ++i) {
+        Memory_free(dev->buffers[i].start, dev->buffers[i].length,
+            &captureAllocParams);
+    }
+
+    free(dev->buffers);
+    dev->buffers = NULL;
+    dev->n_buffers = 0;
+
+    free(dev->inIndex);
+    dev->inIndex = NULL;
+}
+
+static void soft_close(struct device *dev) {
+
+    if (-1 == close(dev->fd))
+        errno_exit("close");
+
+    dev->fd = -1;
+
+    if (dev->file != NULL) {
+        fclose(dev->file);
+        dev->file = NULL;
+    }
+
+    pthread_mutex_destroy(&dev->lock);
+}
+
+// 读出文件的第sequence帧, 到了文件末尾从头再来
+static int file_fill(struct device *dev, struct buffer *b,
+    unsigned int sequence) {
+
+    long k = sequence % dev->numFrames;
+    size_t size = inFrameSize;
+
+    if ((dev->inIndex != NULL) && (dev->inIndex[k].size < size))
+        size = dev->inIndex[k].size;
+
+    if (pread(fileno(dev->file), b->start, size,
+        frame_offset(dev->inIndex, k)) != (ssize_t)size) {
+        fprintf(stderr, "%s: can't read frame %ld\n", dev->dev_name, k);
+        return -1;
+    }
+
+    return size;
+}
+
+// 生成第sequence帧: 每帧移动一个像素的亮度斜坡, 75%彩条, 或随机噪声
+static int synth_fill(struct device *dev, struct buffer *b,
+    unsigned int sequence) {
+
+    /* Y, U, V of white, yellow, cyan, green, magenta, red, blue, black */
+    static const unsigned char bars[8][3] = {
+        { 180, 128, 128 }, { 162,  44, 142 }, { 131, 156,  44 },
+        { 112,  72,  58 }, {  84, 184, 198 }, {  65, 100, 212 },
+        {  35, 212, 114 }, {  16, 128, 128 }
+    };
+    unsigned char *line;
+    unsigned int x, y, i;
+    uint32_t r = sequence * 2654435761u | 1;
+
+    for (y = 0; y < img_height; y++) {
+
+        line = (unsigned char *)b->start + y * img_pitch;
+
+        switch (dev->pattern) {
+        case 0:
+            for (x = 0; x < img_width; x++) {
+                line[2 * x] = (unsigned char)(x + y + sequence);
+                line[2 * x + 1] = 128;
+            }
+            break;
+
+        case 1:
+            /* U on even pixels, V on odd ones */
+            for (x = 0; x < img_width; x++) {
+                i = x * 8 / img_width;
+                line[2 * x] = bars[i][0];
+                line[2 * x + 1] = bars[i][1 + (x & 1)];
+            }
+            break;
+
+        default:
+            for (x = 0; x < 2 * img_width; x += 4) {
+                r ^= r << 13;
+                r ^= r >> 17;
+                r ^= r << 5;
+                memcpy(&line[x], &r, 2 * img_width - x < 4 ?
+                    2 * img_width - x : 4);
+            }
+            break;
+        }
+    }
+
+    return inFrameSize;
+}
+
+static const struct source v4l2_source = {
+    "v4l2", v4l2_open, v4l2_init, v4l2_start, v4l2_dequeue, v4l2_requeue,
+    v4l2_stop, v4l2_uninit, v4l2_close, NULL
+};
+
+static const struct source file_source = {
+    "file", file_open, file_init, soft_start, soft_dequeue, soft_requeue,
+    soft_stop, soft_uninit, soft_close, file_fill
+};
+
+static const struct source synth_source = {
+    "synth", synth_open, synth_init, soft_start, soft_dequeue, soft_requeue,
+    soft_stop, soft_uninit, soft_close, synth_fill
+};
+
+// 由设备名选择帧源: file:path[@fps], synth[:pattern][@fps], 其它是V4L2设备
+static void pick_source(struct device *dev, char *name) {
+
+    char *at;
+
+    dev->dev_name = name;
+    dev->src = &v4l2_source;
+
+    if (strncmp(name, "file:", 5) == 0) {
+        dev->src = &file_source;
+    }
+    else if ((strncmp(name, "synth", 5) == 0) &&
+        ((name[5] == '\0') || (name[5] == ':') || (name[5] == '@'))) {
+        dev->src = &synth_source;
+    }
+    else {
+        return;
+    }
+
+    if ((at = strrchr(name, '@')) != NULL) {
+        *at = '\0';
+        dev->fps = atoi(at + 1);
+    }
+
+    if (dev->src == &file_source)
+        dev->path = name + 5;
+    else
+        dev->path = name[5] == ':' ? name + 6 : "ramp";
+}
+
+// 以下按设备的帧源分派
+static void open_device(struct device *dev) {
+
+    dev->src->open(dev);
+}
+
+static void init_device(struct device *dev) {
+
+    dev->src->init(dev);
+}
+
+static void start_capturing(struct device *dev) {
+
+    dev->sequenced = 0;     /* the driver counts from 0 again */
+    dev->src->start(dev);
+}
+
+static void stop_capturing(struct device *dev) {
+
+    dev->src->stop(dev);
+}
+
+static void uninit_device(struct device *dev) {
+
+    dev->src->uninit(dev);
+}
+
+static void close_device(struct device *dev) {
+
+    dev->src->close(dev);
+}
+
+
+/*
+ *  ======== createInFileIfMissing ========
+ *  Replay input for a run without arguments: SYNTHFRAMES YUYV frames of
+ *  the -W x -H geometry, a luma ramp moving a pixel per frame over flat
+ *  chroma.
+ */
+#define SYNTHFRAMES 30
+
+static void createInFileIfMissing( char *inFileName )
+{
+
+    unsigned char *line;
+    unsigned int x, y;
+    int i;
+    FILE *f = fopen(inFileName, "rb");
+    if (f == NULL) {
+        printf( "Input file '%s' not found, generating one.\n", inFileName );
+        f = fopen( inFileName, "wb" );
+        if (f == NULL) {
+            return;
+        }
+        line = (unsigned char *)malloc(img_width * 2);
+        for (i = 0; (line != NULL) && (i < SYNTHFRAMES); i++) {
+            for (y = 0; y < img_height; y++) {
+                for (x = 0; x < img_width; x++) {
+                    line[2 * x] = (unsigned char)(x + y + i);
+                    line[2 * x + 1] = 128;
+                }
+                fwrite(line, img_width * 2, 1, f);
+            }
+        }
+        free(line);
+    }
+
+    fclose( f );
+}
+
+/*
+ *  ======== smain ========
+ */
+Int smain(Int argc, String argv[])
+{
+
+    Engine_Handle ce = NULL;
+    VIDDEC_Handle dec = NULL;
+    VIDENC_Handle enc = NULL;
+
+
+    String inFile, outFile;
+
+    Memory_AllocParams allocParams;
+
+    struct device *dev;
+    char devOut[FILENAME_MAX];
+    char *name;
+
+    Int opt;
+    Int i;
+
+    while ((opt = getopt(argc, argv, "sq:RBcC:i:xm:d:t:b:w:fF:T:S:r:z:o:eLn:W:H:")) != -1) {
+        switch (opt) {
+            case 'B':
+                bench = 1;
+                break;
+
+            case 'c':
+                cached = 1;
+                break;
+
+            case 'C':
+                channels = atoi(optarg);
+                break;
+
+            case 'i':
+                for (io = IO_METHOD_MMAP; io <= IO_METHOD_DMABUF; io++) {
+                    if (strcmp(optarg, io_names[io]) == 0) {
+                        break;
+                    }
+                }
+                if (io > IO_METHOD_DMABUF) {
+                    fprintf(stderr, usage, argv[0]);
+                    exit(1);
+                }
+                break;
+
+            case 'x':
+                export_dmabuf = 1;
+                break;
+
+            case 'm':
+                motionThreshold = atoi(optarg);
+                break;
+
+            case 'b':
+                batch = atoi(optarg);
+                break;
+
+            case 'w':
+                if ((sscanf(optarg, "%d,%d", &writerDepth, &writerSync) < 1) ||
+                    (writerDepth < 0)) {
+                    fprintf(stderr, usage, argv[0]);
+                    exit(1);
+                }
+                break;
+
+            case 't':
+                numThreads = atoi(optarg);
+                break;
+
+            case 'd':
+                if (sscanf(optarg, "%d,%d", &keyInterval,
+                    &deltaThreshold) < 1) {
+                    fprintf(stderr, usage, argv[0]);
+                    exit(1);
+                }
+                break;
+
+            case 'f':
+                record = 1;
+                break;
+
+            case 'F':
+                if ((sscanf(optarg, "%ld,%ld", &firstFrame, &numReplay) < 1) ||
+                    (firstFrame < 0)) {
+                    fprintf(stderr, usage, argv[0]);
+                    exit(1);
+                }
+                break;
+
+            case 'T':
+                if ((sscanf(optarg, "%lld,%lld", &fromMs, &toMs) < 1) ||
+                    (fromMs < 0)) {
+                    fprintf(stderr, usage, argv[0]);
+                    exit(1);
+                }
+                break;
+
+            case 'r':
+                if ((sscanf(optarg, "%d,%d,%d,%d", &cropX, &cropY, &cropWidth,
+                    &cropHeight) < 2) || (cropX < 0) || (cropY < 0) ||
+                    (cropWidth < 0) || (cropHeight < 0)) {
+                    fprintf(stderr, usage, argv[0]);
+                    exit(1);
+                }
+                break;
+
+            case 'z':
+                if (strchr(optarg, 'x') != NULL) {
+                    if ((sscanf(optarg, "%dx%d", &scaleWidth,
+                        &scaleHeight) != 2) || (scaleWidth <= 0) ||
+                        (scaleHeight <= 0)) {
+                        fprintf(stderr, usage, argv[0]);
+                        exit(1);
+                    }
+                }
+                else if (((scaleFactor = atoi(optarg)) != 2) &&
+                    (scaleFactor != 4)) {
+                    fprintf(stderr, usage, argv[0]);
+                    exit(1);
+                }
+                break;
+
+            case 'o':
+                if (strcmp(optarg, "nv12") == 0) {
+                    chromaFormat = XDM_YUV_420SP;
+                }
+                else if (strcmp(optarg, "i420") == 0) {
+                    chromaFormat = XDM_YUV_420P;
+                }
+                else if (strcmp(optarg, "yuyv") == 0) {
+                    rawOutput = 1;
+                }
+                else if (strcmp(optarg, "gray") != 0) {
+                    fprintf(stderr, usage, argv[0]);
+                    exit(1);
+                }
+                break;
+
+            case 'e':
+                encode = 1;
+                break;
+
+            case 'L':
+                lumaStats = 1;
+                break;
+
+            case 'S':
+                statsWhere = strtok(optarg, ",");
+                if ((name = strtok(NULL, ",")) != NULL) {
+                    statsInterval = atoi(name);
+                }
+                break;
+
+            case 's':
+                streaming = 1;
+                break;
+
+            case 'q':
+                name = strtok(optarg, ",");
+                for (policy = QUEUE_BLOCK; (name != NULL) &&
+                    (policy <= QUEUE_LATEST); policy++) {
+                    if (strcmp(name, queue_names[policy]) == 0) {
+                        break;
+                    }
+                }
+                if ((name == NULL) || (policy > QUEUE_LATEST) ||
+                    (((name = strtok(NULL, ",")) != NULL) &&
+                    ((queueDepth = atoi(name)) < 1))) {
+                    fprintf(stderr, usage, argv[0]);
+                    exit(1);
+                }
+                streaming = 1;
+                break;
+
+            case 'R':
+                replay = 1;
+                break;
+
+            case 'n':
+                frame_count = atoi(optarg);
+                break;
+
+            case 'W':
+                img_width = atoi(optarg);
+                break;
+
+            case 'H':
+                img_height = atoi(optarg);
+                break;
+
+            default:
+                fprintf(stderr, usage, argv[0]);
+                exit(1);
+        }
+    }
+
+    if (argc - optind == 0) {
+        inFile = "./in.dat";
+        outFile = "./out.dat";
+        createInFileIfMissing(inFile);
+        pick_source(&devices[n_devices++], "/dev/video0");
+    }
+    else if (argc - optind == 3) {
+        progName = argv[0];
+        inFile = argv[optind + 1];
+        outFile = argv[optind + 2];
+
+        /* dev_name is a comma separated list of capture devices */
+        for (name = strtok(argv[optind], ","); name != NULL;
+            name = strtok(NULL, ",")) {
+            if (n_devices == MAX_DEVICES) {
+                fprintf(stderr, "%s: at most %d devices\n", argv[0],
+                    MAX_DEVICES);
+                exit(1);
+            }
+            pick_source(&devices[n_devices++], name);
+        }
+    }
+    else {
+        fprintf(stderr, usage, argv[0]);
+        exit(1);
+    }
+
+    if ((n_devices != 1) && (streaming || bench)) {
+        fprintf(stderr, usage, argv[0]);
+        exit(1);
+    }
+
+    /* a batch takes a buffer per plane of each frame */
+    if ((batch < 1) ||
+        (batch * IVIDDECCOPY_PLANES(chromaFormat) > XDM_MAX_IO_BUFFERS)) {
+        fprintf(stderr, usage, argv[0]);
+        exit(1);
+    }
+
+    /* with -s it is taken from the queue, whose slots hold one more */
+    if (streaming && !replay && (channels == 0) &&
+        ((batch + 2 > RING_SLOTS) || (queueDepth + batch + 1 > RING_SLOTS))) {
+        fprintf(stderr, usage, argv[0]);
+        exit(1);
+    }
+    if (streaming && !replay && (channels == 0)) {
+        numBuffers = (queueDepth > 0 ? queueDepth : RING_DEPTH) + batch + 2;
+        if (numBuffers > RING_SLOTS + 1) {
+            numBuffers = RING_SLOTS + 1;
+        }
+    }
+
+    /* the decoder has no chroma in delta records or scaled output */
+    if ((chromaFormat != XDM_GRAY) && ((keyInterval >= 0) ||
+        (scaleFactor != 1) || (scaleWidth != 0))) {
+        fprintf(stderr, usage, argv[0]);
+        exit(1);
+    }
+
+    /* the encoder takes whole gray frames */
+    if (encode && ((chromaFormat != XDM_GRAY) || (keyInterval >= 0))) {
+        fprintf(stderr, usage, argv[0]);
+        exit(1);
+    }
+
+    /* nothing the decoder does applies to frames written as captured */
+    if (rawOutput && ((motionThreshold >= 0) || (keyInterval >= 0) ||
+        (cropX != 0) || (cropY != 0) || (cropWidth != 0) ||
+        (cropHeight != 0) || (scaleFactor != 1) || (scaleWidth != 0) ||
+        encode || lumaStats)) {
+        fprintf(stderr, usage, argv[0]);
+        exit(1);
+    }
+
+    for (i = 0; i < n_devices; i++) {
+        devices[i].fd = -1;
+    }
+
+
+
+    GT_0trace(curMask, GT_1CLASS, "App-> Application started.\n");
+
+    /* stage histograms, written out while the app runs */
+    if ((statsWhere != NULL) && (Stats_start(statsWhere, statsInterval) != 0)) {
+        printf("App-> ERROR: can't write stats to %s, %s\n", statsWhere,
+            strerror(errno));
+        goto end;
+    }
+
+    if (replay || (channels > 0)) {
+        if (replay && (in = fopen(inFile, "rb")) == NULL) {
+            printf("App-> ERROR: can't read file %s\n", inFile);
+            goto end;
+        }
+
+        /* a file written with -f says what its frames are */
+        if (replay && (read_header(in, &inHeader) == 0)) {
+            if (inHeader.fourcc != V4L2_PIX_FMT_YUYV) {
+                printf("App-> ERROR: %s doesn't hold YUYV frames, see -o "
+                    "yuyv\n", inFile);
+                goto end;
+            }
+            img_width = inHeader.width;
+            img_height = inHeader.height;
+        }
+
+        /* YUYV frames of the -W x -H geometry, or input-file's */
+        img_pitch = inHeader.pitch ? inHeader.pitch : img_width * 2;
+        inFrameSize = img_pitch * img_height;
+        if ((outFrameSize = output_size()) < 0) {
+            printf("App-> ERROR: region %d,%d,%d,%d of -r is outside the "
+                "%ux%u frames\n", cropX, cropY, cropWidth, cropHeight,
+                img_width, img_height);
+            goto end;
+        }
+        encFrameSize = IVIDENCGRAY_MAXSIZE(out_width, out_height);
+    }
+    else {
+        /* the negotiated format sizes the buffers below */
+        for (i = 0; i < n_devices; i++) {
+            open_device(&devices[i]);
+            init_device(&devices[i]);
+        }
+    }
+
+    GT_3trace(curMask, GT_1CLASS, "App-> frames are %dx%d, %d bytes per line\n",
+        img_width, img_height, img_pitch);
+    GT_2trace(curMask, GT_1CLASS, "App-> output is %ux%u\n", out_width,
+        out_height);
+
+    /*
+     * allocate input, encoded, and output buffers; cached ones are only
+     * written back/invalidated where they are handed to or taken from a
+     * codec on the DSP, see cache_to_codec() and cache_from_codec()
+     */
+    allocParams.type = Memory_CONTIGPOOL;
+    allocParams.flags = cached ? Memory_CACHED : Memory_NONCACHED;
+    allocParams.align = cached ? CACHEALIGN : BUFALIGN;
+    allocParams.seg = 0;
+
+    inBuf = (XDAS_Int8 *)Memory_alloc(batch * FRAMESTRIDE(inFrameSize),
+        &allocParams);
+    if (encode) {
+        encodedBuf = (XDAS_Int8 *)Memory_alloc(encFrameSize, &allocParams);
+    }
+    outBuf = (XDAS_Int8 *)Memory_alloc(batch * FRAMESTRIDE(outFrameSize),
+        &allocParams);
+
+    if ((inBuf == NULL) || (encode && (encodedBuf == NULL)) ||
+        (outBuf == NULL)) {
+        goto end;
+    }
+
+    /* open file streams for input and output */
+    if (channels > 0) {
+        /* frames from input-file if it has any, nothing is written */
+        in = fopen(inFile, "rb");
+        multi_channel(&allocParams);
+        goto end;
+    }
+
+    if (open_output(&devices[0], outFile) != 0) {
+        goto end;
+    }
+
+    /* reset, load, and start DSP Engine */
+    if ((ce = Engine_open(engineName, NULL, NULL)) == NULL) {
+        fprintf(stderr, "%s: error: can't open engine %s\n",
+            progName, engineName);
+        goto end;
+    }
+
+    /* a local codec shares the CPU's caches, a remote one does not */
+    cache_maint = cached && (Engine_getServer(ce) != NULL);
+    GT_2trace(curMask, GT_1CLASS, "App-> %s working buffers%s\n",
+        cached ? "cached" : "noncached",
+        cache_maint ? ", explicit cache maintenance" : "");
+
+    /* allocate and initialize video decoder on the engine */
+    dec = create_decoder(ce);
+    if (dec == NULL) {
+        printf( "App-> ERROR: can't open codec %s\n", decoderName);
+        goto end;
+    }
+
+    /* with -e, one encoder on the engine for the frames of all devices */
+    if (encode) {
+        enc = create_encoder(ce);
+        if (enc == NULL) {
+            fprintf(stderr, "%s: error: can't open codec %s\n",
+                progName, encoderName);
+            goto end;
+        }
+        for (i = 0; i < n_devices; i++) {
+            devices[i].enc = enc;
+        }
+    }
+
+    if (replay) {
+        /* only a local codec can read input-file from the page cache */
+        devices[0].zero_copy = (Engine_getServer(ce) == NULL);
+
+        /* use engine to decode, and encode, the data */
+        encode_decode(dec, in, &devices[0]);
+        goto end;
+    }
+
+    if (configure_decoder(dec) != 0) {
+        goto end;
+    }
+
+    devices[0].dec = dec;
+
+    if (bench) {
+        bench_io(ce, &devices[0]);
+        goto end;
+    }
+
+    /* every other device gets its own decoder and output file */
+    for (i = 1; i < n_devices; i++) {
+        dev = &devices[i];
+
+        dev->dec = create_decoder(ce);
+        if ((dev->dec == NULL) || (configure_decoder(dev->dec) != 0)) {
+            printf("App-> ERROR: can't open codec %s for %s\n",
+                decoderName, dev->dev_name);
+            goto end;
+        }
+
+        snprintf(devOut, sizeof(devOut), "%s.%d", outFile, i);
+        if (open_output(dev, devOut) != 0) {
+            goto end;
+        }
+    }
+
+    for (i = 0; i < n_devices; i++) {
+        dev = &devices[i];
+        dev->zero_copy = check_zero_copy(ce, dev);
+        GT_4trace(curMask, GT_1CLASS, "App-> %s: %s %s capture, zero-copy "
+            "%s\n", dev->dev_name, dev->src->name, io_names[dev->io],
+            dev->zero_copy ? "on" : "off (codec needs contiguous buffers)");
+    }
+
+    GT_0trace(curMask, GT_1CLASS, "Video -> Video capture started.\n");
+
+    for (i = 0; i < n_devices; i++) {
+        start_capturing(&devices[i]);
+    }
+
+    if (streaming) {
+        /* decode each frame on another thread as it is captured */
+        stream_decode(&devices[0], &allocParams);
+    }
+    else {
+        mainloop();
+    }
+
+    for (i = 0; i < n_devices; i++) {
+        dev = &devices[i];
+        stop_capturing(dev);
+        GT_3trace(curMask, GT_1CLASS, "App-> %s: %u frames%s\n",
+            dev->dev_name, dev->frames, dev->failed ? ", FAILED" : "");
+        GT_6trace(curMask, GT_1CLASS, "App-> %s: %u captured, dropped %u "
+            "by the driver, %u oldest, %u newest, %u superseded\n",
+            dev->dev_name, dev->captured, dev->dropped[DROP_DRIVER],
+            dev->dropped[DROP_OLDEST], dev->dropped[DROP_NEWEST],
+            dev->dropped[DROP_SUPERSEDED]);
+    }
+
+    GT_0trace(curMask, GT_1CLASS, "Video -> Video capture done.\n");
+
+    goto end;
+
+end:
+    if (work_frames > 0) {
+        printf("App-> %u frames, %.3f ms per frame with %s buffers\n",
+            work_frames, work_ns / 1e6 / work_frames,
+            cached ? "cached" : "noncached");
+    }
+
+    /* teardown the codecs */
+    if (enc) {
+        VIDENC_delete(enc);
+    }
+
+    if (dec) {
+        report_decoder(dec, devices[0].dev_name);
+        VIDDEC_delete(dec);
+    }
+
+    for (i = 1; i < n_devices; i++) {
+        if (devices[i].dec) {
+            report_decoder(devices[i].dec, devices[i].dev_name);
+            VIDDEC_delete(devices[i].dec);
+        }
+    }
+
+    /* close the engine */
+    if (ce) {
+        Engine_close(ce);
+    }
+
+    /* close the files */
+    if (in) {
+        fclose(in);
+    }
+
+    for (i = 0; i < n_devices; i++) {
+        close_output(&devices[i]);
+    }
+
+    /* a last dump, with every frame on disk */
+    Stats_stop();
+
+    for (i = 0; i < n_devices; i++) {
+        dev = &devices[i];
+        if (dev->stats != NULL) {
+            GT_5trace(curMask, GT_1CLASS, "App-> %s: process p50 %llu us, "
+                "p99 %llu us; to disk p50 %llu us, p99 %llu us\n",
+                dev->dev_name,
+                Stats_quantile(dev->stats, STATS_PROCESS, 0.5) / 1000,
+                Stats_quantile(dev->stats, STATS_PROCESS, 0.99) / 1000,
+                Stats_quantile(dev->stats, STATS_TOTAL, 0.5) / 1000,
+                Stats_quantile(dev->stats, STATS_TOTAL, 0.99) / 1000);
+            Stats_delete(dev->stats);
+            dev->stats = NULL;
+        }
+    }
+
+    /* release the capture devices */
+    for (i = 0; i < n_devices; i++) {
+        if (devices[i].fd != -1) {
+            uninit_device(&devices[i]);
+            close_device(&devices[i]);
+        }
+    }
+
+    /* free buffers */
+    if (inBuf) {
+        Memory_free(inBuf, batch * FRAMESTRIDE(inFrameSize), &allocParams);
+    }
+
+    if (encodedBuf) {
+        Memory_free(encodedBuf, encFrameSize, &allocParams);
+    }
+
+    if (outBuf) {
+        Memory_free(outBuf, batch * FRAMESTRIDE(outFrameSize),
+            &allocParams);
+    }
+
+    GT_0trace(curMask, GT_1CLASS, "app done.\n");
+    return (0);
+}
+
+/*
+ *  ======== read_header ========
+ *  Read the header of an input-file written with -f; returns -1, with in
+ *  back at its start, if it is a plain stream of frames.
+ */
+static int read_header(FILE *in, FrameFile_Header *header)
+{
+    struct stat st;
+
+    /* a pipe can't be read again from the start */
+    if ((fstat(fileno(in), &st) != 0) || !S_ISREG(st.st_mode)) {
+        return (-1);
+    }
+
+    if ((fread(header, sizeof(*header), 1, in) == 1) &&
+        (header->magic == FRAMEFILE_MAGIC) &&
+        (header->version == FRAMEFILE_VERSION) && (header->align > 0)) {
+        return (0);
+    }
+
+    memset(header, 0, sizeof(*header));
+    rewind(in);
+
+    return (-1);
+}
+
+/*
+ *  ======== read_index ========
+ *  Load the index of an input-file written with -f, or build it by
+ *  walking the records if the file was cut short before its index.
+ *  Returns the number of frames, *index is to be freed.
+ */
+static long read_index(FILE *in, FrameFile_Header *header,
+    FrameFile_IndexEntry **index)
+{
+    FrameFile_Trailer trailer;
+    FrameFile_FrameHeader frame;
+    FrameFile_IndexEntry *entries = NULL;
+    FrameFile_IndexEntry *more;
+    struct stat st;
+    off_t offset;
+    size_t end;
+    long size = 0;
+    long n = 0;
+
+    if (fstat(fileno(in), &st) == -1) {
+        st.st_size = 0;
+    }
+
+    /* the trailer is only trusted when the index fits in front of it */
+    end = (st.st_size >= (off_t)sizeof(trailer)) ?
+        (size_t)st.st_size - sizeof(trailer) : 0;
+
+    if ((end > 0) &&
+        (fseeko(in, -(off_t)sizeof(trailer), SEEK_END) == 0) &&
+        (fread(&trailer, sizeof(trailer), 1, in) == 1) &&
+        (trailer.magic == FRAMEFILE_INDEXMAGIC) &&
+        (trailer.indexOffset <= end) &&
+        ((size_t)trailer.numFrames <=
+        (end - (size_t)trailer.indexOffset) / sizeof(*entries)) &&
+        ((entries = (FrameFile_IndexEntry *)malloc(
+        ((size_t)trailer.numFrames + 1) * sizeof(*entries))) != NULL) &&
+        (fseeko(in, trailer.indexOffset, SEEK_SET) == 0) &&
+        (fread(entries, sizeof(*entries), trailer.numFrames, in) ==
+        trailer.numFrames)) {
+        *index = entries;
+        return (trailer.numFrames);
+    }
+
+    free(entries);
+    entries = NULL;
+
+    GT_0trace(curMask, GT_2CLASS, "App-> input-file has no index, "
+        "walking its frames\n");
+
+    offset = FRAMEFILE_ALIGN(header->headerSize, header->align);
+
+    while ((fseeko(in, offset, SEEK_SET) == 0) &&
+        (fread(&frame, sizeof(frame), 1, in) == 1) &&
+        (frame.magic == FRAMEFILE_FRAMEMAGIC) &&
+        (offset + (off_t)sizeof(frame) + frame.size <= st.st_size)) {
+
+        if (n == size) {
+            size = size ? 2 * size : 1024;
+            more = (FrameFile_IndexEntry *)realloc(entries,
+                size * sizeof(*entries));
+            if (more == NULL) {
+                break;
+            }
+            entries = more;
+        }
+
+        entries[n].offset = offset;
+        entries[n].timestamp = frame.timestamp;
+        entries[n].sequence = frame.sequence;
+        entries[n].size = frame.size;
+        n++;
+
+        offset += FRAMEFILE_ALIGN(sizeof(frame) + frame.size, header->align);
+    }
+
+    *index = entries;
+
+    return (n);
+}
+
+/*
+ *  ======== find_frame ========
+ *  The first of n indexed frames taken at time or later; timestamps only
+ *  grow, so this is a bisection.
+ */
+static long find_frame(FrameFile_IndexEntry *index, long n,
+    unsigned long long time)
+{
+    long lo = 0;
+    long mid;
+
+    while (lo < n) {
+        mid = lo + (n - lo) / 2;
+        if (index[mid].timestamp < time) {
+            lo = mid + 1;
+        }
+        else {
+            n = mid;
+        }
+    }
+
+    return (lo);
+}
+
+/*
+ *  ======== frame_offset ========
+ *  Where frame k of input-file starts.
+ */
+static off_t frame_offset(FrameFile_IndexEntry *index, long k)
+{
+    return (index != NULL ? (off_t)(index[k].offset +
+        sizeof(FrameFile_FrameHeader)) : (off_t)k * inFrameSize);
+}
+
+/*
+ *  ======== map_input ========
+ *  Map the regular file in, so frames are decoded straight from the
+ *  page cache; NULL if it can't be mapped, it is read with fread() then.
+ */
+static XDAS_Int8 *map_input(FILE *in, size_t *size)
+{
+    struct stat st;
+    void *map;
+
+    if ((fstat(fileno(in), &st) != 0) || !S_ISREG(st.st_mode) ||
+        (st.st_size < inFrameSize)) {
+        return (NULL);
+    }
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fileno(in), 0);
+    if (map == MAP_FAILED) {
+        return (NULL);
+    }
+
+    /* each frame is read once, front to back */
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    *size = st.st_size;
+
+    return ((XDAS_Int8 *)map);
+}
+
+/*
+ *  ======== encode_decode ========
+ *  With dev->zero_copy the decoder reads the frames where input-file is
+ *  mapped, otherwise they are read into the contiguous inBuf.  Only the
+ *  frames picked with -F or -T are read, an input-file written with -f
+ *  is found in by its index.  write_frame() encodes what is decoded
+ *  if -e asks for it.
+ */
+static Void encode_decode(VIDDEC_Handle dec, FILE *in, struct device *dev)
+{
+
+    Int                         n;
+    Int                         i;
+    Int                         count;
+    Int32                       status;
+    unsigned long long          t0;
+    XDAS_Int8                  *map = NULL;
+    size_t                      mapSize = 0;
+    size_t                      next;
+    size_t                      len;
+    size_t                      page = sysconf(_SC_PAGESIZE);
+    FrameFile_IndexEntry       *index = NULL;
+    long                        first;
+    long                        last;
+    long                        k;
+
+    XDAS_Int8                  *frames[XDM_MAX_IO_BUFFERS];
+    XDAS_Int8                  *outFrames[XDM_MAX_IO_BUFFERS];
+    Int                         sizes[XDM_MAX_IO_BUFFERS];
+    Stats_Frame                 info[XDM_MAX_IO_BUFFERS];
+    IVIDDECCOPY_OutArgs         decOutArgs;
+
+    if (configure_decoder(dec) != 0) {
+        return;
+    }
+
+    if (dev->zero_copy) {
+        map = map_input(in, &mapSize);
+    }
+    GT_1trace(curMask, GT_1CLASS, "App-> input-file is %s\n",
+        map != NULL ? "mapped" : "read");
+
+    /* the frames to replay, first up to last */
+    first = firstFrame;
+    last = LONG_MAX;
+
+    if (inHeader.magic == FRAMEFILE_MAGIC) {
+        last = read_index(in, &inHeader, &index);
+        if ((fromMs >= 0) && (last > 0)) {
+            first = find_frame(index, last,
+                index[0].timestamp + fromMs * 1000000ULL);
+            if (toMs >= 0) {
+                last = find_frame(index, last,
+                    index[0].timestamp + toMs * 1000000ULL + 1);
+            }
+        }
+    }
+    else if (fromMs >= 0) {
+        printf("App-> ERROR: input-file has no timestamps for -T\n");
+        return;
+    }
+    else if (map != NULL) {
+        last = mapSize / inFrameSize;
+    }
+    else if ((first > 0) &&
+        (fseeko(in, (off_t)first * inFrameSize, SEEK_SET) != 0)) {
+        printf("App-> ERROR: can't seek to frame %ld\n", first);
+        return;
+    }
+
+    if ((numReplay >= 0) && (numReplay < last - first)) {
+        last = first + numReplay;
+    }
+
+    /*
+     * Read complete frames from in, up to batch at a time, encode,
+     * decode, and write to out.
+     */
+    for (n = 0; ; n += count) {
+        t0 = now_ns();
+
+        for (count = 0; (count < batch) && (first + n + count < last);
+            count++) {
+            k = first + n + count;
+            outFrames[count] = outBuf + count * FRAMESTRIDE(outFrameSize);
+            sizes[count] = inFrameSize;
+
+            /* a frame is dequeued once it is read */
+            memset(&info[count], 0, sizeof(info[count]));
+            info[count].sequence = k;
+            info[count].sensor = t0;
+            info[count].dequeued = t0;
+
+            if (index != NULL) {
+                sizes[count] = index[k].size < (uint32_t)inFrameSize ?
+                    (Int)index[k].size : inFrameSize;
+                info[count].sequence = index[k].sequence;
+                info[count].sensor = index[k].timestamp;
+            }
+
+            if (map != NULL) {
+                next = frame_offset(index, k);
+                if (next + sizes[count] > mapSize) {
+                    break;
+                }
+                frames[count] = map + next;
+                continue;
+            }
+
+            frames[count] = inBuf + count * FRAMESTRIDE(inFrameSize);
+            if (((index != NULL) &&
+                (fseeko(in, frame_offset(index, k), SEEK_SET) != 0)) ||
+                (fread(frames[count], sizes[count], 1, in) != 1)) {
+                break;
+            }
+
+            /* the codec reads what fread() left in the CPU cache */
+            cache_to_codec(frames[count], sizes[count]);
+        }
+
+        if (count == 0) {
+            break;
+        }
+
+        /* have the next batch read in while this one is decoded */
+        k = first + n + count;
+        if ((map != NULL) && (k < last) &&
+            ((next = frame_offset(index, k)) < mapSize)) {
+            len = (size_t)batch * (inFrameSize + sizeof(FrameFile_FrameHeader));
+            len = len < mapSize - next ? len : mapSize - next;
+            madvise(map + (next & ~(page - 1)), len + (next & (page - 1)),
+                MADV_WILLNEED);
+        }
+
+        /* decode the frames */
+        info[0].started = now_ns();
+        status = decode_frames(dec, frames, sizes, outFrames, count,
+            first + n + 1, &decOutArgs);
+        info[0].ended = now_ns();
+
+        // GT_2trace(curMask, GT_2CLASS,
+        //     "App-> Decoder frame %d process returned - 0x%x)\n",
+        //     n, status);
+
+        for (i = 0; i < count; i++) {
+            if (decOutArgs.frameError[i] != 0) {
+                GT_3trace(curMask, GT_7CLASS,
+                    "App-> Decoder frame %d processing FAILED, status = 0x%x, "
+                    "extendedError = 0x%x\n", n + i, status,
+                    decOutArgs.frameError[i]);
+                continue;
+            }
+
+            /* write to file */
+            info[i].started = info[0].started;
+            info[i].ended = info[0].ended;
+            if (write_frame(dev, outFrames[i], decOutArgs.frameBytes[i],
+                &info[i]) != 0) {
+                break;
+            }
+            work_frames++;
+        }
+
+        work_ns += now_ns() - t0;
+
+        /* the frames that failed are skipped, a failed call or write ends it */
+        if ((i < count) ||
+            ((status != VIDDEC_EOK) && (decOutArgs.numFrames == 0))) {
+            n += count;
+            break;
+        }
+    }
+
+    if (map != NULL) {
+        munmap(map, mapSize);
+    }
+
+    free(index);
+
+    GT_2trace(curMask, GT_1CLASS, "%d frames decoded%s\n", n,
+        dev->enc != NULL ? " and encoded" : "");
+}
+/*
+ *  ======== create_decoder ========
+ *  Create a decoder on ce sized for the capture geometry, so that it
+ *  reserves the previous frame it compares with when motion detection
+ *  is turned on, with the -t band threads.
+ */
+static VIDDEC_Handle create_decoder(Engine_Handle ce)
+{
+    IVIDDECCOPY_Params          decParams;
+
+    decParams.viddecParams.size = sizeof(decParams);
+    decParams.viddecParams.maxHeight = img_height;
+    decParams.viddecParams.maxWidth = img_width;
+    decParams.viddecParams.maxFrameRate = 0;
+    decParams.viddecParams.maxBitRate = 0;
+    decParams.viddecParams.dataEndianness = XDM_BYTE;
+    decParams.viddecParams.forceChromaFormat = XDM_YUV_422ILE;
+    decParams.numThreads = numThreads;
+
+    return (VIDDEC_create(ce, decoderName,
+        (VIDDEC_Params *)&decParams));
+}
+
+/*
+ *  ======== create_encoder ========
+ *  Create the -e encoder on ce and set it up for gray frames of the
+ *  output geometry, out_width pixels a line and tightly packed, encoded
+ *  into one encFrameSize buffer.  Returns NULL on failure.
+ */
+static VIDENC_Handle create_encoder(Engine_Handle ce)
+{
+    VIDENC_Handle               enc;
+    VIDENC_Params               encParams;
+    VIDENC_DynamicParams        encDynParams;
+    VIDENC_Status               encStatus;
+
+    CLEAR(encParams);
+    encParams.size = sizeof(encParams);
+    encParams.maxHeight = out_height;
+    encParams.maxWidth = out_width;
+    encParams.dataEndianness = XDM_BYTE;
+    encParams.inputChromaFormat = XDM_GRAY;
+    encParams.inputContentType = IVIDEO_PROGRESSIVE;
+
+    if ((enc = VIDENC_create(ce, encoderName, &encParams)) == NULL) {
+        return (NULL);
+    }
+
+    CLEAR(encDynParams);
+    encDynParams.size = sizeof(encDynParams);
+    encDynParams.inputWidth = out_width;
+    encDynParams.inputHeight = out_height;
+    encDynParams.captureWidth = out_width;
+    encStatus.size = sizeof(encStatus);
+
+    if (VIDENC_control(enc, XDM_SETPARAMS, &encDynParams, &encStatus) !=
+        VIDENC_EOK) {
+        GT_1trace(curMask, GT_7CLASS, "App-> encoder can't take the output "
+            "geometry, extendedError = 0x%x\n", encStatus.extendedError);
+        VIDENC_delete(enc);
+        return (NULL);
+    }
+
+    /* one decoded frame in, one encoded frame out */
+    if ((VIDENC_control(enc, XDM_GETBUFINFO, &encDynParams, &encStatus) !=
+        VIDENC_EOK) ||
+        (encStatus.bufInfo.minNumInBufs > 1) ||
+        (encStatus.bufInfo.minNumOutBufs > 1) ||
+        (encStatus.bufInfo.minInBufSize[0] > outFrameSize) ||
+        (encStatus.bufInfo.minOutBufSize[0] > encFrameSize)) {
+        GT_0trace(curMask, GT_7CLASS,
+            "Error:  encoder codec feature conflict\n");
+        VIDENC_delete(enc);
+        return (NULL);
+    }
+
+    return (enc);
+}
+
+/*
+ *  ======== configure_decoder ========
+ *  Pass the negotiated capture geometry to the decoder and check that it
+ *  can work with one inFrameSize input and one outFrameSize output buffer.
+ *  Returns 0 on success.
+ */
+static Int configure_decoder(VIDDEC_Handle dec)
+{
+    Int32                       status;
+    IVIDDECCOPY_DynamicParams   decDynParams;
+    IVIDDECCOPY_Status          decStatus;
+    Int                         planes;
+    Int                         i;
+
+    decDynParams.viddecDynamicParams.size = sizeof(decDynParams);
+    decStatus.viddecStatus.size = sizeof(decStatus);
+
+    /* tell the decoder the capture geometry, including line padding */
+    decDynParams.viddecDynamicParams.decodeHeader = XDM_DECODE_AU;
+    decDynParams.viddecDynamicParams.displayWidth = 0;
+    decDynParams.viddecDynamicParams.frameSkipMode = IVIDEO_NO_SKIP;
+    decDynParams.width    = img_width;
+    decDynParams.height   = img_height;
+    decDynParams.inPitch  = img_pitch;
+    decDynParams.outPitch = out_width;
+    decDynParams.motionDetect = motionThreshold >= 0 ? XDAS_TRUE : XDAS_FALSE;
+    decDynParams.motionThreshold = motionThreshold >= 0 ? motionThreshold : 0;
+    decDynParams.outputMode = keyInterval >= 0 ?
+        IVIDDECCOPY_DELTA : IVIDDECCOPY_FULL;
+    decDynParams.keyInterval = keyInterval >= 0 ? keyInterval : 0;
+    decDynParams.deltaThreshold = deltaThreshold;
+    decDynParams.cropX = cropX;
+    decDynParams.cropY = cropY;
+    decDynParams.cropWidth = cropWidth;
+    decDynParams.cropHeight = cropHeight;
+    decDynParams.scaleFactor = scaleWidth ? 0 : scaleFactor;
+    decDynParams.scaleWidth = scaleWidth;
+    decDynParams.scaleHeight = scaleHeight;
+    decDynParams.chromaFormat = chromaFormat;
+    decDynParams.lumaStats = lumaStats ? XDAS_TRUE : XDAS_FALSE;
+
+    status = VIDDEC_control(dec, XDM_SETPARAMS,
+        (VIDDEC_DynamicParams *)&decDynParams, (VIDDEC_Status *)&decStatus);
+    if (status != VIDDEC_EOK) {
+        /* failure, report error and exit */
+        GT_2trace(curMask, GT_7CLASS, "decode setparams status = 0x%x, "
+            "extendedError = 0x%x\n", status,
+            decStatus.viddecStatus.extendedError);
+        return (-1);
+    }
+
+    status = VIDDEC_control(dec, XDM_GETSTATUS,
+        (VIDDEC_DynamicParams *)&decDynParams, (VIDDEC_Status *)&decStatus);
+    if (status != VIDDEC_EOK) {
+        /* failure, report error and exit */
+        GT_1trace(curMask, GT_7CLASS, "decode control status = 0x%x\n", status);
+        return (-1);
+    }
+
+    /* Validate this decoder codec will meet our buffer requirements */
+    planes = IVIDDECCOPY_PLANES(chromaFormat);
+    for (i = 0; i < planes; i++) {
+        if (plane_size(i, NULL) <
+            decStatus.viddecStatus.bufInfo.minOutBufSize[i]) {
+            break;
+        }
+    }
+
+    if ((1 < decStatus.viddecStatus.bufInfo.minNumInBufs) ||
+        (inFrameSize < decStatus.viddecStatus.bufInfo.minInBufSize[0]) ||
+        (planes < decStatus.viddecStatus.bufInfo.minNumOutBufs) ||
+        (i < planes)) {
+
+        /* failure, report error and exit */
+        GT_0trace(curMask, GT_7CLASS,
+            "App-> ERROR: decoder does not meet buffer requirements.\n");
+        return (-1);
+    }
+
+    GT_4trace(curMask, GT_1CLASS, "App-> decoder %dx%d, pitch in %d out %d\n",
+        decStatus.viddecStatus.outputWidth, decStatus.viddecStatus.outputHeight,
+        decStatus.inPitch, decStatus.outPitch);
+
+    return (0);
+}
+
+/*
+ *  ======== report_decoder ========
+ *  Trace the decoder's own counters.  They are kept inside the codec,
+ *  so with a remote server the difference to our own process times is
+ *  the cost of the IPC.
+ */
+static Void report_decoder(VIDDEC_Handle dec, String name)
+{
+    Int32                       status;
+    IVIDDECCOPY_DynamicParams   decDynParams;
+    IVIDDECCOPY_Status          decStatus;
+    unsigned long long          total;
+
+    decDynParams.viddecDynamicParams.size = sizeof(decDynParams);
+    decStatus.viddecStatus.size = sizeof(decStatus);
+
+    status = VIDDEC_control(dec, XDM_GETSTATUS,
+        (VIDDEC_DynamicParams *)&decDynParams, (VIDDEC_Status *)&decStatus);
+    if (status != VIDDEC_EOK) {
+        GT_1trace(curMask, GT_7CLASS, "decode control status = 0x%x\n", status);
+        return;
+    }
+
+    total = ((unsigned long long)decStatus.totalTimeHi << 32) |
+        decStatus.totalTimeLo;
+
+    GT_6trace(curMask, GT_1CLASS, "App-> %s: codec %u frames (%u failed) in "
+        "%u calls, %llu KB in, %llu KB out\n", name, decStatus.frames,
+        decStatus.failedFrames, decStatus.calls,
+        (((unsigned long long)decStatus.bytesInHi << 32) |
+         decStatus.bytesInLo) >> 10,
+        (((unsigned long long)decStatus.bytesOutHi << 32) |
+         decStatus.bytesOutLo) >> 10);
+    GT_6trace(curMask, GT_1CLASS, "App-> %s: codec mean %llu, max %u %s per "
+        "call; kernels %s/%s\n", name,
+        decStatus.calls > 0 ? total / decStatus.calls : 0,
+        decStatus.maxTime,
+        decStatus.timeUnit == IVIDDECCOPY_CYCLES ? "cycles" : "ns",
+        decStatus.grayKernel, decStatus.sadKernel);
+    if (decStatus.numThreads > 1) {
+        GT_2trace(curMask, GT_1CLASS, "App-> %s: codec uses %d threads\n",
+            name, decStatus.numThreads);
+    }
+    if (decStatus.viddecStatus.outputChromaFormat != XDM_GRAY) {
+        GT_2trace(curMask, GT_1CLASS, "App-> %s: chroma kernel %s\n", name,
+            decStatus.chromaKernel);
+    }
+}
+
+/*
+ *  ======== copy_frames ========
+ *  What decode_frames() does with -o yuyv: hand each frame on as it was
+ *  captured, so it is written, and recorded with -f, like a decoded one.
+ */
+static Int32 copy_frames(XDAS_Int8 **frames, Int *sizes,
+    XDAS_Int8 **outFrames, Int numFrames, XDAS_Int32 id,
+    IVIDDECCOPY_OutArgs *decOutArgs)
+{
+    Int i;
+
+    memset(decOutArgs, 0, sizeof(*decOutArgs));
+    decOutArgs->viddecOutArgs.size = sizeof(*decOutArgs);
+
+    for (i = 0; i < numFrames; i++) {
+        decOutArgs->frameBytes[i] = sizes[i] < outFrameSize ? sizes[i] :
+            outFrameSize;
+        memcpy(outFrames[i], frames[i], decOutArgs->frameBytes[i]);
+    }
+
+    decOutArgs->viddecOutArgs.outputID = id + numFrames - 1;
+    decOutArgs->outputBytes = decOutArgs->frameBytes[numFrames - 1];
+    decOutArgs->numFrames = numFrames;
+
+    return (VIDDEC_EOK);
+}
+
+/*
+ *  ======== decode_frames ========
+ *  Decode numFrames YUYV frames, frames[i] of sizes[i] bytes into
+ *  outFrames[i], in one VIDDEC_process call; frame i gets the id id + i.
+ *  Each output frame is handed to the codec as one buffer per plane.
+ *  decOutArgs->frameError[i] and frameBytes[i] are set for each frame
+ *  whatever status is returned.
+ */
+static Int32 decode_frames(VIDDEC_Handle dec, XDAS_Int8 **frames, Int *sizes,
+    XDAS_Int8 **outFrames, Int numFrames, XDAS_Int32 id,
+    IVIDDECCOPY_OutArgs *decOutArgs)
+{
+    VIDDEC_InArgs               decInArgs;
+
+    XDM_BufDesc                 inBufDesc;
+    XDAS_Int32                  inBufSizes[XDM_MAX_IO_BUFFERS];
+
+    XDM_BufDesc                 outBufDesc;
+    XDAS_Int8                  *outPlanes[XDM_MAX_IO_BUFFERS];
+    XDAS_Int32                  outBufSizes[XDM_MAX_IO_BUFFERS];
+
+    Int32                       status;
+    Int                         planes = IVIDDECCOPY_PLANES(chromaFormat);
+    Int                         offset;
+    Int                         i;
+    Int                         p;
+
+    if (rawOutput) {
+        return (copy_frames(frames, sizes, outFrames, numFrames, id,
+            decOutArgs));
+    }
+
+    inBufDesc.numBufs = numFrames;
+    outBufDesc.numBufs = numFrames * planes;
+    inBufDesc.bufSizes = inBufSizes;
+    outBufDesc.bufSizes = outBufSizes;
+    inBufDesc.bufs = frames;
+    outBufDesc.bufs = outPlanes;
+
+    decInArgs.size = sizeof(decInArgs);
+    decInArgs.numBytes = 0;
+    decInArgs.inputID = id;
+
+    for (i = 0; i < numFrames; i++) {
+        inBufSizes[i] = sizes[i];
+        decInArgs.numBytes += sizes[i];
+
+        /* one output buffer per plane, all in the frame's slot of outBuf */
+        for (p = 0; p < planes; p++) {
+            outBufSizes[i * planes + p] = plane_size(p, &offset);
+            outPlanes[i * planes + p] = outFrames[i] + offset;
+        }
+    }
+
+    /* the extended fields are only asked for, and copied back, when used;
+       replay goes on after a frame that fails on its own */
+    decOutArgs->viddecOutArgs.size = (motionThreshold >= 0) ||
+        (keyInterval >= 0) || lumaStats || (numFrames > 1) || replay ?
+        sizeof(*decOutArgs) : sizeof(decOutArgs->viddecOutArgs);
+    decOutArgs->motionValid = XDAS_FALSE;
+    decOutArgs->statsValid = XDAS_FALSE;
+    decOutArgs->outputBytes = outFrameSize;
+    decOutArgs->numFrames = 0;
+
+    status = VIDDEC_process(dec, &inBufDesc, &outBufDesc, &decInArgs,
+        (VIDDEC_OutArgs *)decOutArgs);
+
+    /* without frame status from the codec, the call's is each frame's */
+    if (decOutArgs->numFrames == 0) {
+        for (i = 0; i < numFrames; i++) {
+            decOutArgs->frameError[i] = 0;
+            decOutArgs->frameBytes[i] = decOutArgs->outputBytes;
+            if (status != VIDDEC_EOK) {
+                decOutArgs->frameError[i] =
+                    decOutArgs->viddecOutArgs.extendedError;
+                XDM_SETFATALERROR(decOutArgs->frameError[i]);
+            }
+        }
+    }
+
+    for (i = 0; i < numFrames; i++) {
+        /* drop lines the CPU may hold of the output before it reads it */
+        cache_from_codec(outFrames[i], outFrameSize);
+    }
+
+    if (decOutArgs->motionValid) {
+        GT_4trace(curMask, GT_2CLASS, "App-> frame %d motion %d/1000 of "
+            "%d blocks, SAD %u\n", decOutArgs->viddecOutArgs.outputID,
+            decOutArgs->motionScore,
+            decOutArgs->blocksX * decOutArgs->blocksY, decOutArgs->totalSad);
+    }
+
+    if (decOutArgs->statsValid) {
+        GT_4trace(curMask, GT_2CLASS, "App-> frame %d luma mean %d, min %d, "
+            "max %d\n", decOutArgs->viddecOutArgs.outputID,
+            decOutArgs->lumaMean, decOutArgs->lumaMin, decOutArgs->lumaMax);
+    }
+
+    return (status);
+}
+
+/*
+ *  ======== decode_frame ========
+ *  Decode one YUYV frame of size bytes at frame into outFrame.
+ */
+static Int32 decode_frame(VIDDEC_Handle dec, XDAS_Int8 *frame, Int size,
+    XDAS_Int8 *outFrame, XDAS_Int32 id, IVIDDECCOPY_OutArgs *decOutArgs)
+{
+    return (decode_frames(dec, &frame, &size, &outFrame, 1, id, decOutArgs));
+}
+
+/*
+ *  ======== output_size ========
+ *  Work out the output geometry from the capture geometry, -r and -z,
+ *  the way the decoder does, and return the output buffer size: a gray
+ *  or 4:2:0 frame, the largest delta record with -d, or the captured
+ *  frame with -o yuyv.  Returns -1 if the region of -r doesn't lie
+ *  within the frames, or scales to nothing.
+ */
+static Int output_size(Void)
+{
+    Int width = cropWidth ? cropWidth : (Int)img_width - cropX;
+    Int height = cropHeight ? cropHeight : (Int)img_height - cropY;
+
+    if (rawOutput) {
+        out_width = img_width;
+        out_height = img_height;
+        return (inFrameSize);
+    }
+
+    if ((cropX >= (Int)img_width) || (cropY >= (Int)img_height) ||
+        (width > (Int)img_width - cropX) ||
+        (height > (Int)img_height - cropY) ||
+        (width < scaleFactor) || (height < scaleFactor)) {
+        return (-1);
+    }
+
+    out_width = scaleWidth ? scaleWidth : width / scaleFactor;
+    out_height = scaleHeight ? scaleHeight : height / scaleFactor;
+
+    return (keyInterval >= 0 ? IVIDDECCOPY_DELTASIZE(out_width, out_height) :
+        (Int)(out_width * out_height) + (chromaFormat == XDM_GRAY ? 0 :
+        2 * (Int)((out_width / 2) * (out_height / 2))));
+}
+
+/*
+ *  ======== plane_size ========
+ *  Bytes of the output plane plane of a frame, and, if offset isn't
+ *  NULL, where it starts in the frame's output buffer.  The planes of
+ *  NV12 and I420 follow each other without gaps, the layout of the
+ *  files they are written to.
+ */
+static Int plane_size(Int plane, Int *offset)
+{
+    Int luma = (Int)(out_width * out_height);
+    Int chroma = (Int)((out_width / 2) * (out_height / 2));
+    Int size;
+
+    if (chromaFormat == XDM_GRAY) {
+        size = outFrameSize;
+        plane = 0;
+    }
+    else if (plane == 0) {
+        size = luma;
+    }
+    else {
+        size = chromaFormat == XDM_YUV_420SP ? 2 * chroma : chroma;
+    }
+
+    if (offset != NULL) {
+        *offset = plane == 0 ? 0 : luma + (plane - 1) * chroma;
+    }
+
+    return (size);
+}
+
+/*
+ *  ======== check_zero_copy ========
+ *  A local codec can read the V4L2 mmap buffers in place.  A codec on
+ *  the DSP server can only be given physically contiguous buffers, so
+ *  zero-copy then depends on how the driver allocated dev's buffers.
+ */
+static int check_zero_copy(Engine_Handle ce, struct device *dev)
+{
+    unsigned int i;
+    Bool isContiguous;
+
+    if (Engine_getServer(ce) == NULL) {
+        return (1);
+    }
+
+    for (i = 0; i < dev->n_buffers; i++) {
+        Memory_getBufferPhysicalAddress(dev->buffers[i].start,
+            dev->buffers[i].length, &isContiguous);
+        if (!isContiguous) {
+            return (0);
+        }
+    }
+
+    return (1);
+}
+
+/*
+ *  ======== drop_queued ========
+ *  Drop the oldest queued frame for the given cause and make its slot
+ *  idle.  Called by the capture thread with the ring locked; returns -1
+ *  if its driver buffer can't be requeued.
+ */
+static int drop_queued(struct frame_ring *ring, int cause)
+{
+    struct device *dev = ring->dev;
+    unsigned int index;
+    int r = 0;
+
+    index = ring->queue[ring->head];
+    ring->head = (ring->head + 1) % RING_SLOTS;
+    ring->queued--;
+
+    if (dev->zero_copy) {
+        sync_dmabuf(dev, &ring->slot[index].vbuf, 0);
+        r = requeue_frame(dev, &ring->slot[index].vbuf);
+    }
+
+    ring->idle[ring->numIdle++] = index;
+    dev->dropped[cause]++;
+
+    return (r);
+}
+
+/*
+ *  ======== capture_thread ========
+ *  Dequeue frame_count frames and queue each one in an idle slot, making
+ *  room first as -q says.  With zero_copy the slot refers to the V4L2
+ *  buffer itself, which the decode thread requeues; otherwise the frame
+ *  is copied into the slot while it is still hot and the buffer goes
+ *  straight back to the driver.
+ */
+static void *capture_thread(void *arg)
+{
+    struct frame_ring *ring = (struct frame_ring *)arg;
+    struct device *dev = ring->dev;
+    struct frame_slot *slot;
+    struct v4l2_buffer buf;
+    unsigned int count;
+    unsigned int index;
+    int r = 0;
+
+    for (count = 0; count < frame_count; count++) {
+
+        /* a stalled or failed device ends the run early */
+        if (wait_frame(dev, &buf) != 0) {
+            dev->failed = 1;
+            break;
+        }
+
+        pthread_mutex_lock(&ring->lock);
+
+        if (ring->stop) {
+            pthread_mutex_unlock(&ring->lock);
+            requeue_frame(dev, &buf);
+            break;
+        }
+
+        if (policy == QUEUE_LATEST) {
+            while ((ring->queued > 0) && (r == 0)) {
+                r = drop_queued(ring, DROP_SUPERSEDED);
+            }
+        }
+        else if ((ring->queued == ring->depth) && (policy == QUEUE_OLDEST)) {
+            r = drop_queued(ring, DROP_OLDEST);
+        }
+        else if ((ring->queued == ring->depth) && (policy == QUEUE_NEWEST)) {
+            pthread_mutex_unlock(&ring->lock);
+
+            dev->dropped[DROP_NEWEST]++;
+            if (requeue_frame(dev, &buf) != 0) {
+                dev->failed = 1;
+                break;
+            }
+            continue;
+        }
+
+        if (r != 0) {
+            pthread_mutex_unlock(&ring->lock);
+            dev->failed = 1;
+            break;
+        }
+
+        /* block: wait for the processing thread to take some */
+        while (((ring->queued == ring->depth) || (ring->numIdle == 0)) &&
+            !ring->stop) {
+            pthread_cond_wait(&ring->space, &ring->lock);
+        }
+
+        if (ring->stop) {
+            pthread_mutex_unlock(&ring->lock);
+            requeue_frame(dev, &buf);
+            break;
+        }
+
+        index = ring->idle[--ring->numIdle];
+
+        pthread_mutex_unlock(&ring->lock);
+
+        slot = &ring->slot[index];
+        slot->dequeued = now_ns();
+        slot->vbuf = buf;
+        slot->size = frame_size(dev, &buf);
+
+        sync_dmabuf(dev, &buf, 1);
+
+        if (dev->zero_copy) {
+            slot->buf = (XDAS_Int8 *)dev->buffers[buf.index].start;
+        }
+        else {
+            slot->size = slot->size < inFrameSize ? slot->size : inFrameSize;
+            memcpy(slot->copy, dev->buffers[buf.index].start, slot->size);
+            cache_to_codec(slot->copy, slot->size);
+            slot->buf = slot->copy;
+
+            sync_dmabuf(dev, &buf, 0);
+            if (requeue_frame(dev, &buf) != 0) {
+                dev->failed = 1;
+                count = frame_count;    /* queue this one, then stop */
+            }
+        }
+
+        pthread_mutex_lock(&ring->lock);
+
+        ring->queue[(ring->head + ring->queued) % RING_SLOTS] = index;
+        ring->queued++;
+        if (ring->queued > ring->maxQueued) {
+            ring->maxQueued = ring->queued;
+        }
+        pthread_cond_signal(&ring->ready);
+
+        pthread_mutex_unlock(&ring->lock);
+    }
+
+    pthread_mutex_lock(&ring->lock);
+    ring->done = 1;
+    pthread_cond_signal(&ring->ready);
+    pthread_mutex_unlock(&ring->lock);
+
+    return (NULL);
+}
+
+/*
+ *  ======== stream_decode ========
+ *  Run capture and decode concurrently: the capture thread queues the
+ *  frames, this thread decodes each one as soon as it is queued, in one
+ *  call with the ones queued behind it up to -b of them, and writes the
+ *  results.  Reports sustained frame rate, the latency from VIDIOC_DQBUF
+ *  to the end of VIDDEC_process and how deep the queue got.
+ */
+static Void stream_decode(struct device *dev, Memory_AllocParams *allocParams)
+{
+    static struct frame_ring    ring;
+
+    pthread_t                   capture;
+    struct frame_slot          *slot;
+    unsigned int                taken[RING_SLOTS];
+    Int                         i;
+    Int                         n;
+    Int                         count;
+    Int32                       status;
+    unsigned long long          start = 0;
+    unsigned long long          end = 0;
+    unsigned long long          t0;
+    unsigned long long          latency;
+    unsigned long long          minLatency = ~0ULL;
+    unsigned long long          maxLatency = 0;
+    unsigned long long          sumLatency = 0;
+
+    XDAS_Int8                  *frames[XDM_MAX_IO_BUFFERS];
+    XDAS_Int8                  *outFrames[XDM_MAX_IO_BUFFERS];
+    Int                         sizes[XDM_MAX_IO_BUFFERS];
+    Stats_Frame                 info[XDM_MAX_IO_BUFFERS];
+    IVIDDECCOPY_OutArgs         decOutArgs;
+
+    memset(&ring, 0, sizeof(ring));
+    ring.dev = dev;
+
+    /*
+     *  With zero_copy the queued frames hold driver buffers, so the queue
+     *  has to leave the driver one to capture into while a batch is
+     *  decoded and the next frame waits for a slot; deeper, the driver
+     *  drops frames before the queue is ever full and -q has no say.
+     *  numBuffers asked for that many, a driver may have given fewer.
+     */
+    ring.depth = queueDepth > 0 ? queueDepth : RING_DEPTH;
+    if (ring.depth + batch + 1 > RING_SLOTS) {
+        ring.depth = RING_SLOTS - batch - 1;
+    }
+    if (dev->zero_copy && (ring.depth + batch + 2 > dev->n_buffers)) {
+        ring.depth = dev->n_buffers > (unsigned int)batch + 2 ?
+            dev->n_buffers - batch - 2 : 1;
+        printf("App-> queue depth cut to %u, %s gave %u buffers for it "
+            "and a batch of %d\n", ring.depth, dev->dev_name, dev->n_buffers,
+            batch);
+    }
+    ring.slots = ring.depth + batch + 1;
+
+    for (i = 0; i < (Int)ring.slots; i++) {
+        ring.idle[ring.numIdle++] = i;
+        if (dev->zero_copy) {
+            continue;
+        }
+        ring.slot[i].copy = (XDAS_Int8 *)Memory_alloc(inFrameSize,
+            allocParams);
+        if (ring.slot[i].copy == NULL) {
+            printf("App-> ERROR: can't allocate frame slot %d\n", i);
+            goto free;
+        }
+    }
+
+    pthread_mutex_init(&ring.lock, NULL);
+    pthread_cond_init(&ring.ready, NULL);
+    pthread_cond_init(&ring.space, NULL);
+
+    if (pthread_create(&capture, NULL, capture_thread, &ring) != 0) {
+        printf("App-> ERROR: can't start capture thread\n");
+        goto destroy;
+    }
+
+    for (n = 0; ; n += count) {
+
+        pthread_mutex_lock(&ring.lock);
+
+        while ((ring.queued == 0) && !ring.done) {
+            pthread_cond_wait(&ring.ready, &ring.lock);
+        }
+
+        /* take whatever is queued already, up to a batch */
+        count = (Int)ring.queued < batch ? (Int)ring.queued : batch;
+        for (i = 0; i < count; i++) {
+            taken[i] = ring.queue[(ring.head + i) % RING_SLOTS];
+        }
+        ring.head = (ring.head + count) % RING_SLOTS;
+        ring.queued -= count;
+
+        pthread_mutex_unlock(&ring.lock);
+
+        if (count == 0) {
+            break;      /* capture finished and the queue is empty */
+        }
+
+        for (i = 0; i < count; i++) {
+            slot = &ring.slot[taken[i]];
+            frames[i] = slot->buf;
+            sizes[i] = slot->size;
+            outFrames[i] = outBuf + i * FRAMESTRIDE(outFrameSize);
+
+            /* the slot is refilled before the frame is written */
+            frame_info(&info[i], &slot->vbuf, slot->dequeued);
+        }
+
+        slot = &ring.slot[taken[0]];
+        t0 = now_ns();
+
+        status = decode_frames(dev->dec, frames, sizes, outFrames, count,
+            slot->vbuf.sequence + 1, &decOutArgs);
+        dev->frames += count;
+
+        end = now_ns();
+        if (n == 0) {
+            start = slot->dequeued;
+        }
+
+        for (i = 0; i < count; i++) {
+            slot = &ring.slot[taken[i]];
+
+            if (dev->zero_copy) {
+                sync_dmabuf(dev, &slot->vbuf, 0);
+                if (requeue_frame(dev, &slot->vbuf) != 0) {
+                    dev->failed = 1;
+                }
+            }
+
+            latency = end - slot->dequeued;
+            sumLatency += latency;
+            minLatency = latency < minLatency ? latency : minLatency;
+            maxLatency = latency > maxLatency ? latency : maxLatency;
+        }
+
+        pthread_mutex_lock(&ring.lock);
+        for (i = 0; i < count; i++) {
+            ring.idle[ring.numIdle++] = taken[i];
+        }
+        pthread_cond_signal(&ring.space);
+        pthread_mutex_unlock(&ring.lock);
+
+        for (i = 0; i < count; i++) {
+            if (decOutArgs.frameError[i] != 0) {
+                GT_3trace(curMask, GT_7CLASS,
+                    "App-> Decoder frame %d processing FAILED, status = 0x%x, "
+                    "extendedError = 0x%x\n", n + i, status,
+                    decOutArgs.frameError[i]);
+                continue;
+            }
+
+            /* write to file */
+            info[i].started = t0;
+            info[i].ended = end;
+            if (write_frame(dev, outFrames[i], decOutArgs.frameBytes[i],
+                &info[i]) != 0) {
+                dev->failed = 1;
+                break;
+            }
+            work_frames++;
+        }
+
+        work_ns += now_ns() - t0;
+
+        /* a write failed, the frames after it would be lost too */
+        if (i < count) {
+            pthread_mutex_lock(&ring.lock);
+            ring.stop = 1;
+            pthread_cond_signal(&ring.space);
+            pthread_mutex_unlock(&ring.lock);
+            n += count;
+            break;
+        }
+    }
+
+    pthread_join(capture, NULL);
+
+    if (n > 0) {
+        printf("App-> %d frames in %.3f s: %.2f fps, latency min/avg/max "
+            "%.3f/%.3f/%.3f ms\n", n, (end - start) / 1e9,
+            n * 1e9 / (end - start),
+            minLatency / 1e6, sumLatency / 1e6 / n, maxLatency / 1e6);
+    }
+
+    printf("App-> queue %s, %u of %u frames deep at most\n",
+        queue_names[policy], ring.maxQueued, ring.depth);
+
+destroy:
+    pthread_cond_destroy(&ring.space);
+    pthread_cond_destroy(&ring.ready);
+    pthread_mutex_destroy(&ring.lock);
+
+free:
+    for (i = 0; i < RING_SLOTS; i++) {
+        if (ring.slot[i].copy) {
+            Memory_free(ring.slot[i].copy, inFrameSize, allocParams);
+        }
+    }
+}
+/*
+ *  ======== bench_io ========
+ *  Capture frame_count frames with each i/o method in turn and decode
+ *  them in place.  Reports the frame rate, the rate at which the codec
+ *  read its input (bytes consumed over time spent in VIDDEC_process) and
+ *  the CPU time per frame, which is where staging copies and uncached
+ *  buffers show up.  Output is discarded.
+ */
+static Void bench_io(Engine_Handle ce, struct device *dev)
+{
+    static const io_method methods[] = {
+        IO_METHOD_MMAP, IO_METHOD_USERPTR, IO_METHOD_DMABUF
+    };
+
+    struct v4l2_buffer          buf;
+    struct rusage               ru0, ru1;
+    IVIDDECCOPY_OutArgs         decOutArgs;
+    XDAS_Int8                  *frame;
+    unsigned long long          t0, t1, p0;
+    unsigned long long          codec;
+    unsigned long long          cpu;
+    unsigned long long          bytes;
+    unsigned int                i, n;
+    Int                         size;
+
+    for (i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+
+        if (dev->fd != -1) {
+            uninit_device(dev);
+            close_device(dev);
+        }
+
+        io = methods[i];
+        open_device(dev);
+        init_device(dev);
+
+        if ((dev->src == &v4l2_source) && (dev->io != methods[i])) {
+            printf("App-> %-8s not supported by %s\n", io_names[methods[i]],
+                dev->dev_name);
+            continue;
+        }
+
+        dev->zero_copy = check_zero_copy(ce, dev);
+        codec = bytes = 0;
+
+        start_capturing(dev);
+
+        getrusage(RUSAGE_SELF, &ru0);
+        t0 = now_ns();
+
+        for (n = 0; n < frame_count; n++) {
+
+            if (wait_frame(dev, &buf) != 0) {
+                break;
+            }
+
+            frame = (XDAS_Int8 *)dev->buffers[buf.index].start;
+            size = frame_size(dev, &buf);
+
+            sync_dmabuf(dev, &buf, 1);
+
+            if (!dev->zero_copy) {
+                size = size < inFrameSize ? size : inFrameSize;
+                memcpy(inBuf, frame, size);
+                cache_to_codec(inBuf, size);
+                frame = inBuf;
+            }
+
+            p0 = now_ns();
+            if (decode_frame(dev->dec, frame, size, outBuf,
+                buf.sequence + 1, &decOutArgs) == VIDDEC_EOK) {
+                bytes += decOutArgs.viddecOutArgs.bytesConsumed;
+            }
+            codec += now_ns() - p0;
+
+            sync_dmabuf(dev, &buf, 0);
+            if (requeue_frame(dev, &buf) != 0) {
+                n++;
+                break;
+            }
+        }
+
+        t1 = now_ns();
+        getrusage(RUSAGE_SELF, &ru1);
+
+        stop_capturing(dev);
+
+        cpu = (ru1.ru_utime.tv_sec - ru0.ru_utime.tv_sec +
+               ru1.ru_stime.tv_sec - ru0.ru_stime.tv_sec) * 1000000ULL +
+              (ru1.ru_utime.tv_usec - ru0.ru_utime.tv_usec) +
+              (ru1.ru_stime.tv_usec - ru0.ru_stime.tv_usec);
+
+        printf("App-> %-8s %u frames, %.2f fps, codec input %.1f MB/s, "
+            "%.3f ms cpu/frame, zero-copy %s\n", io_names[dev->io], n,
+            n * 1e9 / (t1 - t0), codec ? bytes * 1e3 / codec : 0.0,
+            n ? cpu / 1e3 / n : 0.0, dev->zero_copy ? "on" : "off");
+
+        /* a file: or synth: source has the one kind of buffers */
+        if (dev->src != &v4l2_source) {
+            break;
+        }
+    }
+}
+/*
+ *  Multi-channel mode (-C) runs one decoder instance per channel.  A
+ *  channel is a chain of pool tasks: each task decodes one frame and
+ *  queues the next one, so a decoder never runs on two workers at once.
+ */
+#define MC_FRAMES           8       /* distinct input frames, reused */
+
+struct channel {
+    Int                 id;
+    Engine_Handle       ce;         /* own handle, engines are per thread */
+    VIDDEC_Handle       dec;
+    XDAS_Int8          *out;        /* decoded frame, discarded */
+    unsigned int        done;       /* frames decoded so far */
+    unsigned int        failed;
+    unsigned long long  bytes;      /* bytesConsumed */
+};
+
+struct mc_run {
+    XDAS_Int8          *frames;     /* numFrames preloaded input frames */
+    Int                 numFrames;
+};
+
+/*
+ *  ======== channel_task ========
+ *  Decode the next frame of one channel and queue the one after it.
+ */
+static void channel_task(WorkPool *pool, int worker, void *task, void *arg)
+{
+    struct channel *ch = (struct channel *)task;
+    struct mc_run *run = (struct mc_run *)arg;
+    IVIDDECCOPY_OutArgs decOutArgs;
+    XDAS_Int8 *frame;
+
+    frame = run->frames + (ch->done % run->numFrames) * inFrameSize;
+
+    if (decode_frame(ch->dec, frame, inFrameSize, ch->out, ch->done + 1,
+        &decOutArgs) == VIDDEC_EOK) {
+        ch->bytes += decOutArgs.viddecOutArgs.bytesConsumed;
+    }
+    else {
+        ch->failed++;
+    }
+
+    if (++ch->done < frame_count) {
+        WorkPool_push(pool, worker, ch);
+    }
+}
+
+/*
+ *  ======== multi_channel ========
+ *  Decode frame_count frames on each of channels decoder instances on a
+ *  work-stealing pool with one worker per core.  The input frames are
+ *  loaded up front from the input file, or synthesized if it is too
+ *  short, so the run measures decoding only.  Reports the aggregate
+ *  throughput.
+ */
+static Void multi_channel(Memory_AllocParams *allocParams)
+{
+    struct channel     *chan;
+    struct mc_run       run;
+    WorkPool           *pool = NULL;
+    Int                 numWorkers;
+    Int                 i;
+    Int                 j;
+    unsigned long long  t0;
+    unsigned long long  t1;
+    unsigned long long  bytes = 0;
+    unsigned long       executed;
+    unsigned long       stolen;
+    unsigned long       steals = 0;
+    unsigned int        failed = 0;
+
+    chan = (struct channel *)calloc(channels, sizeof(struct channel));
+    run.frames = (XDAS_Int8 *)Memory_alloc(MC_FRAMES * inFrameSize,
+        allocParams);
+
+    if ((chan == NULL) || (run.frames == NULL)) {
+        printf("App-> ERROR: can't allocate %d channels\n", channels);
+        goto free;
+    }
+
+    for (run.numFrames = 0; run.numFrames < MC_FRAMES; run.numFrames++) {
+        if ((in == NULL) || (fread(run.frames + run.numFrames * inFrameSize,
+            inFrameSize, 1, in) != 1)) {
+            break;
+        }
+    }
+
+    if (run.numFrames == 0) {
+        /* no whole frame in the input file, use a moving ramp */
+        for (run.numFrames = 0; run.numFrames < MC_FRAMES; run.numFrames++) {
+            for (j = 0; j < inFrameSize; j++) {
+                run.frames[run.numFrames * inFrameSize + j] =
+                    (XDAS_Int8)(j + run.numFrames * 8);
+            }
+        }
+    }
+
+    for (i = 0; i < channels; i++) {
+        chan[i].id = i;
+
+        if ((chan[i].ce = Engine_open(engineName, NULL, NULL)) == NULL) {
+            fprintf(stderr, "%s: error: can't open engine %s\n",
+                progName, engineName);
+            goto free;
+        }
+
+        if ((chan[i].dec = create_decoder(chan[i].ce)) == NULL) {
+            printf("App-> ERROR: can't open codec %s for channel %d\n",
+                decoderName, i);
+            goto free;
+        }
+
+        if (configure_decoder(chan[i].dec) != 0) {
+            goto free;
+        }
+
+        chan[i].out = (XDAS_Int8 *)Memory_alloc(outFrameSize, allocParams);
+        if (chan[i].out == NULL) {
+            printf("App-> ERROR: can't allocate output of channel %d\n", i);
+            goto free;
+        }
+    }
+
+    /* every channel reaches the same engine, local or remote */
+    cache_maint = cached && (Engine_getServer(chan[0].ce) != NULL);
+    cache_to_codec(run.frames, run.numFrames * inFrameSize);
+
+    numWorkers = sysconf(_SC_NPROCESSORS_ONLN);
+    numWorkers = numWorkers < 1 ? 1 : numWorkers;
+    numWorkers = numWorkers > channels ? channels : numWorkers;
+
+    /* a channel is queued at most once at any time */
+    if ((pool = WorkPool_create(numWorkers, channels)) == NULL) {
+        printf("App-> ERROR: can't create %d workers\n", numWorkers);
+        goto free;
+    }
+
+    for (i = 0; i < channels; i++) {
+        WorkPool_push(pool, i % numWorkers, &chan[i]);
+    }
+
+    t0 = now_ns();
+    numWorkers = WorkPool_run(pool, channel_task, &run);
+    t1 = now_ns();
+
+    for (i = 0; i < WorkPool_numWorkers(pool); i++) {
+        WorkPool_stats(pool, i, &executed, &stolen);
+        GT_3trace(curMask, GT_1CLASS, "App-> worker %d: %lu frames, "
+            "%lu stolen\n", i, executed, stolen);
+        steals += stolen;
+    }
+
+    for (i = 0; i < channels; i++) {
+        bytes += chan[i].bytes;
+        failed += chan[i].failed;
+    }
+
+    printf("App-> %d channels x %u frames on %d workers in %.3f s: "
+        "%.2f fps aggregate, %.2f fps per channel, %.1f MB/s in, "
+        "%lu steals, %u failed\n", channels, frame_count, numWorkers,
+        (t1 - t0) / 1e9, channels * frame_count * 1e9 / (t1 - t0),
+        frame_count * 1e9 / (t1 - t0), bytes * 1e3 / (t1 - t0), steals,
+        failed);
+
+free:
+    if (pool) {
+        WorkPool_delete(pool);
+    }
+
+    for (i = 0; (chan != NULL) && (i < channels); i++) {
+        if (chan[i].out) {
+            Memory_free(chan[i].out, outFrameSize, allocParams);
+        }
+        if (chan[i].dec) {
+            VIDDEC_delete(chan[i].dec);
+        }
+        if (chan[i].ce) {
+            Engine_close(chan[i].ce);
+        }
+    }
 
-        /* write to file */
-        fwrite(dst[0], OFRAMESIZE, 1, out);
+    if (run.frames) {
+        Memory_free(run.frames, MC_FRAMES * inFrameSize, allocParams);
     }
 
-    GT_1trace(curMask, GT_1CLASS, "%d frames encoded/decoded\n", n);
+    free(chan);
 }
 /*
  *  @(#) ti.sdo.ce.examples.apps.video_copy; 1, 0, 0,77; 12-2-2010 21:21:28; /db/atree/library/trees/ce/ce-r11x/src/ xlibrary
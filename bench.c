@@ -0,0 +1,688 @@
+/*
+ * Copyright (c) 2010, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+/*
+ *  ======== bench.c ========
+ *  Microbenchmark of the VIDDECCOPY pixel kernels and the VIDENCGRAY
+ *  encoder and decoder, apart from the codecs and any camera.  It needs
+ *  nothing but the kernels:
+ *
+ *      cc -O2 -I<xdctools> -I<xdais> bench.c viddec_copy_kernels.c \
+ *          videnc_gray_kernels.c
+ *
+ *  Every variant of each kernel the CPU can run is timed on synthetic
+ *  frames of each resolution, hot (the frame is in cache from the run
+ *  before) and cold (the caches are flushed by streaming through a
+ *  buffer larger than the last level cache before each run).  Each
+ *  variant's output is compared with the C reference first, and the
+ *  exit status is 1 if any variant differs, so a script can run this to
+ *  catch regressions in correctness as well as speed.  The encoder's
+ *  check is that the decoder gives back the frame it was given.
+ */
+#include <xdc/std.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "viddec_copy_kernels.h"
+#include "videnc_gray_kernels.h"
+
+#define MAXSIZES        16
+#define FLUSHSIZE       (64 * 1024 * 1024)  /* more than any LLC here */
+#define BLOCKSIZE       16                  /* lines and columns of a SAD */
+
+typedef enum { TEXT, CSV, JSON } Format;
+
+typedef struct Result {
+    String      kernel;     /* "gray", "sad", "nv12", "i420", "genc", "gdec" */
+    String      variant;
+    Int         width;
+    Int         height;
+    String      cache;      /* "hot" or "cold" */
+    Int         runs;
+    double      p50;        /* ns per frame */
+    double      p99;
+    double      mean;
+    double      bytes;      /* read and written per frame */
+    Int         exact;      /* output matches the C reference */
+} Result;
+
+static String usage =
+    "%s: [-r WxH[,WxH...]] [-n runs] [-k gray|sad|chroma|codec] "
+    "[-f text|csv|json]\n"
+    "    -r resolutions, 320x240,640x480,1280x720,1366x768,1920x1080 "
+    "by default\n"
+    "    -n timed runs of each variant, hot and cold (200)\n"
+    "    -k only that kernel, chroma is both nv12 and i420, codec the "
+    "VIDENCGRAY\n       encoder (genc) and decoder (gdec)\n"
+    "    -f output format; csv and json are one record per variant, "
+    "resolution\n       and cache state\n";
+
+static Int widths[MAXSIZES] = { 320, 640, 1280, 1366, 1920 };
+static Int heights[MAXSIZES] = { 240, 480, 720, 768, 1080 };
+static Int numSizes = 5;
+static Int runs = 200;
+static String only = NULL;
+static Format format = TEXT;
+
+static XDAS_UInt8 *flushBuf;
+static Int numResults = 0;
+
+
+/*
+ *  ======== now_ns ========
+ */
+static unsigned long long now_ns(Void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+/*
+ *  ======== flush ========
+ *  Evict the frames from every cache level by writing and reading a
+ *  buffer larger than the last level cache.
+ */
+static Void flush(Void)
+{
+    static volatile XDAS_UInt32 sink;
+    XDAS_UInt32 sum = 0;
+    Int i;
+
+    memset(flushBuf, (Int)sink, FLUSHSIZE);
+    for (i = 0; i < FLUSHSIZE; i += 64) {
+        sum += flushBuf[i];
+    }
+    sink = sum;
+}
+
+/*
+ *  ======== synth ========
+ *  A YUYV frame that looks enough like video: a luma ramp moving with
+ *  seed, and noise on it and on the chroma to keep SIMD and C paths
+ *  busy, and to catch a rounding that differs between two lines.
+ */
+static Void synth(XDAS_UInt8 *pYUV, Int width, Int height, Int seed)
+{
+    XDAS_UInt32 rnd = 2463534242U + seed;
+    Int x;
+    Int y;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            rnd ^= rnd << 13;
+            rnd ^= rnd >> 17;
+            rnd ^= rnd << 5;
+            pYUV[2 * x] = (XDAS_UInt8)(x + y + seed * 3 + (rnd & 7));
+            pYUV[2 * x + 1] = (XDAS_UInt8)(((x & 1) ? 104 : 136) +
+                ((rnd >> 8) & 15));
+        }
+        pYUV += 2 * width;
+    }
+}
+
+/*
+ *  ======== cmpDouble ========
+ */
+static int cmpDouble(const void *a, const void *b)
+{
+    double d = *(const double *)a - *(const double *)b;
+
+    return ((d > 0) - (d < 0));
+}
+
+/*
+ *  ======== report ========
+ */
+static Void report(Result *r)
+{
+    double pixels = (double)r->width * r->height;
+
+    switch (format) {
+        case CSV:
+            if (numResults == 0) {
+                printf("kernel,variant,width,height,cache,runs,p50_ns,"
+                    "p99_ns,mean_ns,ns_per_pixel,gb_per_s,exact\n");
+            }
+            printf("%s,%s,%d,%d,%s,%d,%.0f,%.0f,%.0f,%.4f,%.3f,%d\n",
+                r->kernel, r->variant, r->width, r->height, r->cache,
+                r->runs, r->p50, r->p99, r->mean, r->p50 / pixels,
+                r->bytes / r->p50, r->exact);
+            break;
+
+        case JSON:
+            printf("%s\n  {\"kernel\": \"%s\", \"variant\": \"%s\", "
+                "\"width\": %d, \"height\": %d, \"cache\": \"%s\", "
+                "\"runs\": %d, \"p50_ns\": %.0f, \"p99_ns\": %.0f, "
+                "\"mean_ns\": %.0f, \"ns_per_pixel\": %.4f, "
+                "\"gb_per_s\": %.3f, \"exact\": %s}",
+                numResults == 0 ? "[" : ",", r->kernel, r->variant,
+                r->width, r->height, r->cache, r->runs, r->p50, r->p99,
+                r->mean, r->p50 / pixels, r->bytes / r->p50,
+                r->exact ? "true" : "false");
+            break;
+
+        default:
+            if (numResults == 0) {
+                printf("%-5s %-6s %9s %-5s %10s %10s %8s %7s %s\n",
+                    "kernel", "var", "size", "cache", "p50 us", "p99 us",
+                    "ns/px", "GB/s", "exact");
+            }
+            printf("%-5s %-6s %4dx%-4d %-5s %10.1f %10.1f %8.4f %7.2f %s\n",
+                r->kernel, r->variant, r->width, r->height, r->cache,
+                r->p50 / 1e3, r->p99 / 1e3, r->p50 / pixels,
+                r->bytes / r->p50, r->exact ? "yes" : "NO");
+            break;
+    }
+
+    numResults++;
+}
+
+/*
+ *  ======== timeRuns ========
+ *  Sort the run times of r and fill in its statistics.
+ */
+static Void timeRuns(Result *r, double *times)
+{
+    double sum = 0;
+    Int i;
+
+    for (i = 0; i < r->runs; i++) {
+        sum += times[i];
+    }
+
+    qsort(times, r->runs, sizeof(times[0]), cmpDouble);
+
+    r->p50 = times[r->runs / 2];
+    r->p99 = times[(r->runs * 99) / 100];
+    r->mean = sum / r->runs;
+}
+
+/*
+ *  ======== benchGray ========
+ */
+static Int benchGray(Int width, Int height, double *times)
+{
+    XDAS_UInt32 isa = VIDENCCOPY_TI_cpuIsa();
+    Int pixels = width * height;
+    XDAS_UInt8 *pYUV = malloc(2 * pixels);
+    XDAS_UInt8 *pRef = malloc(pixels);
+    XDAS_UInt8 *pGray = malloc(pixels);
+    const VIDENCCOPY_TI_GrayKernel *k;
+    unsigned long long t0;
+    Result r;
+    Int cold;
+    Int fail = 0;
+    Int i;
+    Int v;
+
+    synth(pYUV, width, height, 0);
+    VIDENCCOPY_TI_YUV422_C_GRAY(pRef, pYUV, height, width);
+
+    for (v = 0; v < VIDENCCOPY_TI_numGrayKernels; v++) {
+        k = &VIDENCCOPY_TI_grayKernels[v];
+        if ((k->isa & isa) != k->isa) {
+            continue;
+        }
+
+        memset(pGray, 0, pixels);
+        k->fxn(pGray, pYUV, height, width);
+
+        r.kernel = "gray";
+        r.variant = k->name;
+        r.width = width;
+        r.height = height;
+        r.runs = runs;
+        r.bytes = 3.0 * pixels;
+        r.exact = (memcmp(pGray, pRef, pixels) == 0);
+        fail |= !r.exact;
+
+        for (cold = 0; cold < 2; cold++) {
+            r.cache = cold ? "cold" : "hot";
+
+            for (i = 0; i < runs; i++) {
+                if (cold) {
+                    flush();
+                }
+                t0 = now_ns();
+                k->fxn(pGray, pYUV, height, width);
+                times[i] = (double)(now_ns() - t0);
+            }
+
+            timeRuns(&r, times);
+            report(&r);
+        }
+    }
+
+    free(pGray);
+    free(pRef);
+    free(pYUV);
+
+    return (fail);
+}
+
+/*
+ *  ======== sadFrame ========
+ *  Run fxn over a whole frame in strips of BLOCKSIZE lines, the way the
+ *  codec does, one row of blockSad per strip.
+ */
+static Void sadFrame(VIDENCCOPY_TI_SadFxn fxn, XDAS_UInt32 *blockSad,
+    XDAS_UInt8 *pPrev, XDAS_UInt8 *pCur, Int width, Int height)
+{
+    Int blocksX = (width + BLOCKSIZE - 1) / BLOCKSIZE;
+    Int y;
+
+    for (y = 0; y < height; y += BLOCKSIZE) {
+        fxn(blockSad, pPrev + y * width, width, pCur + y * width, width,
+            height - y < BLOCKSIZE ? height - y : BLOCKSIZE, width);
+        blockSad += blocksX;
+    }
+}
+
+/*
+ *  ======== benchSad ========
+ *  The previous frame is restored before every run, since the kernel
+ *  copies the current frame over it.
+ */
+static Int benchSad(Int width, Int height, double *times)
+{
+    XDAS_UInt32 isa = VIDENCCOPY_TI_cpuIsa();
+    Int pixels = width * height;
+    Int sads = ((width + BLOCKSIZE - 1) / BLOCKSIZE) *
+        ((height + BLOCKSIZE - 1) / BLOCKSIZE);
+    XDAS_UInt8 *pYUV = malloc(2 * pixels);
+    XDAS_UInt8 *pOrig = malloc(pixels);
+    XDAS_UInt8 *pPrev = malloc(pixels);
+    XDAS_UInt8 *pCur = malloc(pixels);
+    XDAS_UInt32 *pRef = malloc(sads * sizeof(XDAS_UInt32));
+    XDAS_UInt32 *pSad = malloc(sads * sizeof(XDAS_UInt32));
+    const VIDENCCOPY_TI_SadKernel *k;
+    unsigned long long t0;
+    Result r;
+    Int cold;
+    Int fail = 0;
+    Int i;
+    Int v;
+
+    synth(pYUV, width, height, 0);
+    VIDENCCOPY_TI_YUV422_C_GRAY(pOrig, pYUV, height, width);
+    synth(pYUV, width, height, 1);
+    VIDENCCOPY_TI_YUV422_C_GRAY(pCur, pYUV, height, width);
+
+    memcpy(pPrev, pOrig, pixels);
+    sadFrame(VIDENCCOPY_TI_C_BLOCK_SAD, pRef, pPrev, pCur, width, height);
+
+    for (v = 0; v < VIDENCCOPY_TI_numSadKernels; v++) {
+        k = &VIDENCCOPY_TI_sadKernels[v];
+        if ((k->isa & isa) != k->isa) {
+            continue;
+        }
+
+        memcpy(pPrev, pOrig, pixels);
+        memset(pSad, 0, sads * sizeof(XDAS_UInt32));
+        sadFrame(k->fxn, pSad, pPrev, pCur, width, height);
+
+        r.kernel = "sad";
+        r.variant = k->name;
+        r.width = width;
+        r.height = height;
+        r.runs = runs;
+        r.bytes = 3.0 * pixels;
+        r.exact = (memcmp(pSad, pRef, sads * sizeof(XDAS_UInt32)) == 0) &&
+            (memcmp(pPrev, pCur, pixels) == 0);
+        fail |= !r.exact;
+
+        for (cold = 0; cold < 2; cold++) {
+            r.cache = cold ? "cold" : "hot";
+
+            for (i = 0; i < runs; i++) {
+                memcpy(pPrev, pOrig, pixels);
+                if (cold) {
+                    flush();
+                }
+                t0 = now_ns();
+                sadFrame(k->fxn, pSad, pPrev, pCur, width, height);
+                times[i] = (double)(now_ns() - t0);
+            }
+
+            timeRuns(&r, times);
+            report(&r);
+        }
+    }
+
+    free(pSad);
+    free(pRef);
+    free(pCur);
+    free(pPrev);
+    free(pOrig);
+    free(pYUV);
+
+    return (fail);
+}
+
+/*
+ *  ======== chromaFrame ========
+ *  The 4:2:0 chroma of a whole frame, a line pair at a time the way the
+ *  codec does: NV12 into pU if pV is NULL, I420 otherwise.
+ */
+static Void chromaFrame(const VIDENCCOPY_TI_ChromaKernel *k, XDAS_UInt8 *pU,
+    XDAS_UInt8 *pV, XDAS_UInt8 *pYUV, Int width, Int height)
+{
+    Int y;
+
+    for (y = 0; y + 1 < height; y += 2) {
+        if (pV == NULL) {
+            k->nv12(pU + (y / 2) * width, pYUV + y * 2 * width,
+                pYUV + (y + 1) * 2 * width, width);
+        }
+        else {
+            k->i420(pU + (y / 2) * (width / 2), pV + (y / 2) * (width / 2),
+                pYUV + y * 2 * width, pYUV + (y + 1) * 2 * width, width);
+        }
+    }
+}
+
+/*
+ *  ======== benchChroma ========
+ *  Both chroma kernels, NV12 and I420, of each variant; the I420 planes
+ *  share one buffer, V after U.  Frames of an odd width are skipped,
+ *  the codec has no chroma for them either.
+ */
+static Int benchChroma(Int width, Int height, double *times)
+{
+    XDAS_UInt32 isa = VIDENCCOPY_TI_cpuIsa();
+    Int pixels = width * height;
+    Int size = (width / 2) * (height / 2) * 2;
+    XDAS_UInt8 *pYUV = malloc(2 * pixels);
+    XDAS_UInt8 *pRef = malloc(size);
+    XDAS_UInt8 *pOut = malloc(size);
+    const VIDENCCOPY_TI_ChromaKernel *k;
+    unsigned long long t0;
+    Result r;
+    Int planar;
+    Int cold;
+    Int fail = 0;
+    Int i;
+    Int v;
+
+    if ((width & 1) != 0) {
+        free(pOut);
+        free(pRef);
+        free(pYUV);
+        return (0);
+    }
+
+    synth(pYUV, width, height, 0);
+
+    for (planar = 0; planar < 2; planar++) {
+        chromaFrame(&VIDENCCOPY_TI_chromaKernels[0], pRef,
+            planar ? pRef + size / 2 : NULL, pYUV, width, height);
+
+        for (v = 0; v < VIDENCCOPY_TI_numChromaKernels; v++) {
+            k = &VIDENCCOPY_TI_chromaKernels[v];
+            if ((k->isa & isa) != k->isa) {
+                continue;
+            }
+
+            memset(pOut, 0, size);
+            chromaFrame(k, pOut, planar ? pOut + size / 2 : NULL, pYUV,
+                width, height);
+
+            r.kernel = planar ? "i420" : "nv12";
+            r.variant = k->name;
+            r.width = width;
+            r.height = height;
+            r.runs = runs;
+            r.bytes = 2.0 * pixels + size;
+            r.exact = (memcmp(pOut, pRef, size) == 0);
+            fail |= !r.exact;
+
+            for (cold = 0; cold < 2; cold++) {
+                r.cache = cold ? "cold" : "hot";
+
+                for (i = 0; i < runs; i++) {
+                    if (cold) {
+                        flush();
+                    }
+                    t0 = now_ns();
+                    chromaFrame(k, pOut, planar ? pOut + size / 2 : NULL,
+                        pYUV, width, height);
+                    times[i] = (double)(now_ns() - t0);
+                }
+
+                timeRuns(&r, times);
+                report(&r);
+            }
+        }
+    }
+
+    free(pOut);
+    free(pRef);
+    free(pYUV);
+
+    return (fail);
+}
+
+/*
+ *  ======== benchCodec ========
+ *  The VIDENCGRAY encoder and decoder on the luma of a synthetic frame.
+ *  Both are exact if the frame survives the round trip, and that of a
+ *  frame of noise, which codes every pixel with 8 bits, and the decoder
+ *  refuses the frame truncated or with a header too big for its buffer.
+ */
+static Int benchCodec(Int width, Int height, double *times)
+{
+    Int pixels = width * height;
+    Int maxSize = IVIDENCGRAY_MAXSIZE(width, height);
+    XDAS_UInt8 *pYUV = malloc(2 * pixels);
+    XDAS_UInt8 *pGray = malloc(pixels);
+    XDAS_UInt8 *pNoise = malloc(pixels);
+    XDAS_UInt8 *pOut = malloc(pixels);
+    XDAS_UInt8 *pCode = malloc(maxSize);
+    XDAS_UInt8 *pScratch = malloc(VIDENCGRAY_TI_SCRATCHSIZE(width));
+    IVIDENCGRAY_FrameHeader *hdr = (IVIDENCGRAY_FrameHeader *)pCode;
+    XDAS_UInt32 rnd = 2463534242U;
+    unsigned long long t0;
+    Result r;
+    Int size;
+    Int decode;
+    Int cold;
+    Int exact;
+    Int i;
+
+    for (i = 0; i < pixels; i++) {
+        rnd ^= rnd << 13;
+        rnd ^= rnd >> 17;
+        rnd ^= rnd << 5;
+        pNoise[i] = (XDAS_UInt8)rnd;
+    }
+    size = VIDENCGRAY_TI_encode(pCode, pNoise, width, width, height,
+        pScratch);
+    exact = (VIDENCGRAY_TI_decode(pOut, width, pixels, pCode, size) == 0) &&
+        (memcmp(pOut, pNoise, pixels) == 0);
+
+    synth(pYUV, width, height, 0);
+    VIDENCCOPY_TI_YUV422_C_GRAY(pGray, pYUV, height, width);
+    size = VIDENCGRAY_TI_encode(pCode, pGray, width, width, height,
+        pScratch);
+    memset(pOut, 0, pixels);
+    exact = exact &&
+        (VIDENCGRAY_TI_decode(pOut, width, pixels, pCode, size) == 0) &&
+        (memcmp(pOut, pGray, pixels) == 0);
+
+    exact = exact &&
+        (VIDENCGRAY_TI_decode(pOut, width, pixels, pCode, size - 1) != 0);
+    hdr->width++;
+    exact = exact &&
+        (VIDENCGRAY_TI_decode(pOut, width, pixels, pCode, size) != 0);
+    hdr->width--;
+    hdr->height++;
+    exact = exact &&
+        (VIDENCGRAY_TI_decode(pOut, width, pixels, pCode, size) != 0);
+    hdr->height--;
+
+    for (decode = 0; decode < 2; decode++) {
+        r.kernel = decode ? "gdec" : "genc";
+        r.variant = decode ? "c" : VIDENCGRAY_TI_kernelName;
+        r.width = width;
+        r.height = height;
+        r.runs = runs;
+        r.bytes = (double)pixels + size;
+        r.exact = exact;
+
+        for (cold = 0; cold < 2; cold++) {
+            r.cache = cold ? "cold" : "hot";
+
+            for (i = 0; i < runs; i++) {
+                if (cold) {
+                    flush();
+                }
+                t0 = now_ns();
+                if (decode) {
+                    VIDENCGRAY_TI_decode(pOut, width, pixels, pCode, size);
+                }
+                else {
+                    VIDENCGRAY_TI_encode(pCode, pGray, width, width, height,
+                        pScratch);
+                }
+                times[i] = (double)(now_ns() - t0);
+            }
+
+            timeRuns(&r, times);
+            report(&r);
+        }
+    }
+
+    if (format == TEXT) {
+        printf("%-5s %-6s %4dx%-4d %d bytes, %.2f:1\n", "codec", "",
+            width, height, size, (double)pixels / size);
+    }
+
+    free(pScratch);
+    free(pCode);
+    free(pOut);
+    free(pNoise);
+    free(pGray);
+    free(pYUV);
+
+    return (!exact);
+}
+
+/*
+ *  ======== main ========
+ */
+int main(int argc, char *argv[])
+{
+    double *times;
+    char *size;
+    Int fail = 0;
+    Int opt;
+    Int i;
+
+    while ((opt = getopt(argc, argv, "r:n:k:f:")) != -1) {
+        switch (opt) {
+            case 'r':
+                for (numSizes = 0, size = strtok(optarg, ","); size != NULL;
+                    size = strtok(NULL, ",")) {
+                    if ((numSizes == MAXSIZES) ||
+                        (sscanf(size, "%dx%d", &widths[numSizes],
+                        &heights[numSizes]) != 2) ||
+                        (widths[numSizes] < 1) || (heights[numSizes] < 1)) {
+                        fprintf(stderr, usage, argv[0]);
+                        return (2);
+                    }
+                    numSizes++;
+                }
+                break;
+
+            case 'n':
+                runs = atoi(optarg);
+                break;
+
+            case 'k':
+                only = optarg;
+                break;
+
+            case 'f':
+                format = strcmp(optarg, "csv") == 0 ? CSV :
+                    strcmp(optarg, "json") == 0 ? JSON : TEXT;
+                break;
+
+            default:
+                fprintf(stderr, usage, argv[0]);
+                return (2);
+        }
+    }
+
+    if ((runs < 1) || (numSizes == 0)) {
+        fprintf(stderr, usage, argv[0]);
+        return (2);
+    }
+
+    times = malloc(runs * sizeof(double));
+    flushBuf = malloc(FLUSHSIZE);
+
+    for (i = 0; i < numSizes; i++) {
+        if ((only == NULL) || (strcmp(only, "gray") == 0)) {
+            fail |= benchGray(widths[i], heights[i], times);
+        }
+        if ((only == NULL) || (strcmp(only, "sad") == 0)) {
+            fail |= benchSad(widths[i], heights[i], times);
+        }
+        if ((only == NULL) || (strcmp(only, "chroma") == 0)) {
+            fail |= benchChroma(widths[i], heights[i], times);
+        }
+        if ((only == NULL) || (strcmp(only, "codec") == 0)) {
+            fail |= benchCodec(widths[i], heights[i], times);
+        }
+    }
+
+    if (format == JSON) {
+        printf(numResults > 0 ? "\n]\n" : "[]\n");
+    }
+
+    free(flushBuf);
+    free(times);
+
+    if (fail) {
+        fprintf(stderr, "%s: a kernel variant differs from the C "
+            "reference, or a frame from its decoded one\n", argv[0]);
+    }
+
+    return (fail);
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2010, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+/*
+ *  ======== framefile.h ========
+ *  Indexed frame file written by the app with -f, and read back by
+ *  replay.
+ *
+ *  A FrameFile_Header comes first.  Every frame follows as a record, a
+ *  FrameFile_FrameHeader and then size bytes of payload, and each record
+ *  starts at a multiple of the header's align, the gaps are zero.  After
+ *  the last frame comes the index, one FrameFile_IndexEntry per frame,
+ *  and the FrameFile_Trailer is the last bytes of the file.  A file cut
+ *  short without its index can still be read by walking the records.
+ *
+ *  All fields are in the byte order of the machine that wrote the file.
+ */
+#ifndef FRAMEFILE_
+#define FRAMEFILE_
+
+#include <stdint.h>
+
+#define FRAMEFILE_MAGIC         0x4d524656  /* "VFRM" */
+#define FRAMEFILE_FRAMEMAGIC    0x45524656  /* "VFRE" */
+#define FRAMEFILE_INDEXMAGIC    0x58444e49  /* "INDX" */
+#define FRAMEFILE_VERSION       1
+
+/* record size rounded up to the file's alignment */
+#define FRAMEFILE_ALIGN(size, align) \
+    (((size) + (align) - 1) / (align) * (align))
+
+typedef struct FrameFile_Header {
+    uint32_t magic;         /* FRAMEFILE_MAGIC */
+    uint16_t version;       /* FRAMEFILE_VERSION */
+    uint16_t headerSize;    /* sizeof(FrameFile_Header) */
+    uint32_t fourcc;        /* V4L2_PIX_FMT_* of the payloads, or */
+                            /* IVIDDECCOPY_DELTAMAGIC for delta records */
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch;         /* bytes per line of a whole frame */
+    uint32_t align;         /* records and the index start at multiples */
+    uint32_t reserved;
+} FrameFile_Header;
+
+typedef struct FrameFile_FrameHeader {
+    uint32_t magic;         /* FRAMEFILE_FRAMEMAGIC */
+    uint32_t size;          /* payload bytes that follow */
+    uint32_t sequence;      /* V4L2 sequence number of the frame */
+    uint32_t reserved;
+    uint64_t timestamp;     /* V4L2 timestamp, in ns */
+} FrameFile_FrameHeader;
+
+typedef struct FrameFile_IndexEntry {
+    uint64_t offset;        /* of the frame's FrameFile_FrameHeader */
+    uint64_t timestamp;
+    uint32_t sequence;
+    uint32_t size;
+} FrameFile_IndexEntry;
+
+typedef struct FrameFile_Trailer {
+    uint64_t indexOffset;   /* of the first FrameFile_IndexEntry */
+    uint32_t numFrames;
+    uint32_t magic;         /* FRAMEFILE_INDEXMAGIC */
+} FrameFile_Trailer;
+
+#endif
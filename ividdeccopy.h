@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2010, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+/*
+ *  ======== ividdeccopy.h ========
+ *  Extended xDM structures for the VIDDECCOPY algorithm.
+ *
+ *  Each extended structure embeds the base IVIDDEC structure as its first
+ *  field.  The algorithm accepts either the base or the extended form and
+ *  tells them apart by the size field; fields only present in the extended
+ *  form keep their current value (or default) when the base form is used.
+ */
+#ifndef IVIDDECCOPY_
+#define IVIDDECCOPY_
+
+#include <ti/xdais/dm/ividdec.h>
+
+/* motion detection works on 16x16 blocks, up to 1920x1088 pixels */
+#define IVIDDECCOPY_BLOCKSIZE   16
+#define IVIDDECCOPY_MAXWIDTH    1920
+#define IVIDDECCOPY_MAXHEIGHT   1088
+#define IVIDDECCOPY_MAXBLOCKS   ((IVIDDECCOPY_MAXWIDTH / 16) * \
+                                 (IVIDDECCOPY_MAXHEIGHT / 16))
+
+/* blocks along a line or column of n pixels */
+#define IVIDDECCOPY_BLOCKS(n)   (((n) + IVIDDECCOPY_BLOCKSIZE - 1) / \
+                                 IVIDDECCOPY_BLOCKSIZE)
+
+/* outputMode values */
+#define IVIDDECCOPY_FULL        0   /* the whole gray frame */
+#define IVIDDECCOPY_DELTA       1   /* a record of the changed blocks */
+
+#define IVIDDECCOPY_DELTAMAGIC  0x41544c44  /* "DLTA" */
+
+/*
+ *  ======== IVIDDECCOPY_DeltaHeader ========
+ *  Start of a record written in IVIDDECCOPY_DELTA output mode, followed
+ *  by:
+ *    - a bitmap of IVIDDECCOPY_BITMAPSIZE(width, height) bytes, one bit
+ *      per block in raster order, least significant bit first; a set bit
+ *      means the block is in the record
+ *    - the pixels of those blocks in the same order, each block a line
+ *      at a time.  Blocks on the right and bottom edges are only as
+ *      wide and high as what is left of the image.
+ *
+ *  A keyframe has every block.  Applying the blocks of each record to
+ *  the image rebuilt from the records before it gives the image the
+ *  codec compares the next frame with.
+ */
+typedef struct IVIDDECCOPY_DeltaHeader {
+    XDAS_UInt32 magic;          /* IVIDDECCOPY_DELTAMAGIC */
+    XDAS_UInt32 size;           /* bytes of the record, header included */
+    XDAS_Int32  frameId;        /* inputID of the frame */
+    XDAS_Int32  keyFrame;       /* XDAS_TRUE if every block is present */
+    XDAS_Int32  width;
+    XDAS_Int32  height;
+    XDAS_Int32  blockSize;      /* IVIDDECCOPY_BLOCKSIZE */
+    XDAS_Int32  numBlocks;      /* blocks in the record */
+} IVIDDECCOPY_DeltaHeader;
+
+/* bytes of the block bitmap, a multiple of 4 */
+#define IVIDDECCOPY_BITMAPSIZE(w, h) \
+    (((IVIDDECCOPY_BLOCKS(w) * IVIDDECCOPY_BLOCKS(h) + 31) / 32) * 4)
+
+/* the largest record, a keyframe */
+#define IVIDDECCOPY_DELTASIZE(w, h) ((XDAS_Int32)sizeof( \
+    IVIDDECCOPY_DeltaHeader) + IVIDDECCOPY_BITMAPSIZE(w, h) + (w) * (h))
+
+/* bins of the luma histogram, one per gray level */
+#define IVIDDECCOPY_HISTBINS    256
+#define IVIDDECCOPY_MAXSTATSPIXELS  (0xffffffffu / 255)
+
+/* band threads of an instance, not available on the DSP */
+#define IVIDDECCOPY_MAXTHREADS  16
+
+/* timeUnit values of IVIDDECCOPY_Status */
+#define IVIDDECCOPY_NS          0   /* nanoseconds of the monotonic clock */
+#define IVIDDECCOPY_CYCLES      1   /* CPU cycles, from the time stamp counter */
+
+/* output buffers of a frame in each chromaFormat, one per plane */
+#define IVIDDECCOPY_PLANES(fmt) (((fmt) == XDM_YUV_420P) ? 3 : \
+                                 ((fmt) == XDM_YUV_420SP) ? 2 : 1)
+
+/* room for a kernel variant name, terminating NUL included */
+#define IVIDDECCOPY_NAMELEN     8
+
+/*
+ *  ======== IVIDDECCOPY_Params ========
+ *  With numThreads > 1 the instance converts each frame in that many
+ *  horizontal bands at once, on threads of its own that live as long as
+ *  it does.  Delta output is always done on the calling thread.
+ */
+typedef struct IVIDDECCOPY_Params {
+    IVIDDEC_Params viddecParams;                /* must be first field */
+    XDAS_Int32  numThreads;     /* 1 to IVIDDECCOPY_MAXTHREADS */
+} IVIDDECCOPY_Params;
+
+/*
+ *  ======== IVIDDECCOPY_DynamicParams ========
+ *  Input geometry.  A pitch of 0 selects a tightly packed image: 2 * width
+ *  bytes per YUYV input line, and displayWidth (or the output width, if
+ *  that is 0) bytes per gray output line.
+ *
+ *  Only the region of interest, cropWidth x cropHeight input pixels from
+ *  (cropX, cropY) on, is read.  A cropWidth or cropHeight of 0 goes up to
+ *  the right or bottom edge.  It is scaled down by scaleFactor, 2 or 4,
+ *  with a box filter: each output pixel is the mean of that many squared
+ *  input pixels, and what is left over at the right and bottom is not
+ *  read.  Or with scaleWidth and scaleHeight set, and scaleFactor 0 or 1,
+ *  it is scaled to that size with a bilinear filter.  Cropping and
+ *  scaling are done in the pass that extracts the luma, and the output
+ *  geometry, returned in outputWidth and outputHeight by XDM_GETSTATUS,
+ *  is what everything else works on.
+ *
+ *  chromaFormat selects the output: XDM_GRAY (or 0), the luma alone;
+ *  XDM_YUV_420SP, NV12, a luma plane and a plane of interleaved U and V
+ *  pairs; or XDM_YUV_420P, I420, a luma plane, a U and a V plane.  Each
+ *  frame then takes one output buffer per plane, in that order.  The
+ *  chroma planes have half as many lines as the output, their samples
+ *  the rounded mean of two input lines.  The NV12 chroma plane has the
+ *  output pitch, the I420 ones half of it, which must then be even.  The
+ *  color formats need an even output width and height and cropX, and
+ *  are not scaled; they can't be combined with delta output.
+ *
+ *  With lumaStats set, the histogram of the output luma and the
+ *  statistics derived from it are returned in IVIDDECCOPY_OutArgs.  They
+ *  are gathered from each block row as it is converted, while it is
+ *  still in the cache, so the output is not read again.  The output can
+ *  then have up to IVIDDECCOPY_MAXSTATSPIXELS pixels, whose sum fits
+ *  lumaSum.
+ *
+ *  With motionDetect set, every frame is compared with the previous one
+ *  and the result is returned in IVIDDECCOPY_OutArgs.  The previous frame
+ *  is kept in a buffer sized from the maxWidth and maxHeight creation
+ *  params, so larger geometries, or ones beyond IVIDDECCOPY_MAXWIDTH x
+ *  IVIDDECCOPY_MAXHEIGHT, are refused while it is on.
+ *
+ *  With outputMode IVIDDECCOPY_DELTA, each output buffer gets a record of
+ *  the blocks whose mean absolute difference from the previous frame is
+ *  above deltaThreshold (0: any change) instead of the gray frame, and
+ *  every keyInterval-th record is a keyframe (0: only the first one after
+ *  creation, XDM_RESET or a change of geometry or mode).  The same limits
+ *  as for motionDetect apply; an output buffer must hold
+ *  IVIDDECCOPY_DELTASIZE(width, height) bytes and the pitches are unused.
+ */
+typedef struct IVIDDECCOPY_DynamicParams {
+    IVIDDEC_DynamicParams viddecDynamicParams;  /* must be first field */
+    XDAS_Int32  width;          /* pixels per line */
+    XDAS_Int32  height;         /* lines per frame */
+    XDAS_Int32  inPitch;        /* bytes between input lines */
+    XDAS_Int32  outPitch;       /* bytes between output lines */
+    XDAS_Int32  motionDetect;   /* XDAS_TRUE to compare frames */
+    XDAS_Int32  motionThreshold;/* mean abs difference of a moving block */
+    XDAS_Int32  outputMode;     /* IVIDDECCOPY_FULL or IVIDDECCOPY_DELTA */
+    XDAS_Int32  keyInterval;    /* records from one keyframe to the next */
+    XDAS_Int32  deltaThreshold; /* mean abs difference of a changed block */
+    XDAS_Int32  cropX;          /* region of interest, input pixels */
+    XDAS_Int32  cropY;
+    XDAS_Int32  cropWidth;      /* 0: up to the edge */
+    XDAS_Int32  cropHeight;
+    XDAS_Int32  scaleFactor;    /* 0 or 1: no box filter, 2 or 4 */
+    XDAS_Int32  scaleWidth;     /* bilinear output size, 0: none */
+    XDAS_Int32  scaleHeight;
+    XDAS_Int32  chromaFormat;   /* XDM_GRAY, XDM_YUV_420SP or XDM_YUV_420P */
+    XDAS_Int32  lumaStats;      /* XDAS_TRUE for the luma histogram */
+} IVIDDECCOPY_DynamicParams;
+
+/*
+ *  ======== IVIDDECCOPY_Status ========
+ *  The current output width and height are reported in the base
+ *  outputWidth and outputHeight fields.  scaleFactor is 0 if the region
+ *  of interest is scaled with the bilinear filter.  The chroma format
+ *  is the base outputChromaFormat, and bufInfo has the size of each
+ *  plane's output buffer.
+ *
+ *  The counters cover the process() calls since creation or the last
+ *  XDM_RESET and are kept by the codec itself, so on a remote server
+ *  they leave out the IPC and cache maintenance around each call.  The
+ *  64 bit totals are split in two words, since the ARM and DSP
+ *  compilers do not agree on their alignment.  A call is timed from
+ *  entry to return, which must take less than 2^32 time units.
+ */
+typedef struct IVIDDECCOPY_Status {
+    IVIDDEC_Status viddecStatus;                /* must be first field */
+    XDAS_Int32  inPitch;
+    XDAS_Int32  outPitch;
+    XDAS_Int32  motionDetect;
+    XDAS_Int32  motionThreshold;
+    XDAS_Int32  outputMode;
+    XDAS_Int32  keyInterval;
+    XDAS_Int32  deltaThreshold;
+    XDAS_Int32  inputWidth;
+    XDAS_Int32  inputHeight;
+    XDAS_Int32  cropX;
+    XDAS_Int32  cropY;
+    XDAS_Int32  cropWidth;
+    XDAS_Int32  cropHeight;
+    XDAS_Int32  scaleFactor;
+    XDAS_Int32  lumaStats;
+
+    XDAS_UInt32 calls;          /* process() calls */
+    XDAS_UInt32 frames;         /* frames decoded */
+    XDAS_UInt32 failedFrames;   /* frames refused, e.g. buffers too small */
+    XDAS_UInt32 bytesInHi;      /* input bytes of the decoded frames */
+    XDAS_UInt32 bytesInLo;
+    XDAS_UInt32 bytesOutHi;     /* output bytes, gray frames or records */
+    XDAS_UInt32 bytesOutLo;
+    XDAS_Int32  timeUnit;       /* IVIDDECCOPY_NS or IVIDDECCOPY_CYCLES */
+    XDAS_UInt32 totalTimeHi;    /* time spent in process() */
+    XDAS_UInt32 totalTimeLo;
+    XDAS_UInt32 maxTime;        /* longest call */
+    XDAS_Int32  numThreads;     /* band threads, the caller's included */
+    XDAS_Int8   grayKernel[IVIDDECCOPY_NAMELEN];    /* active variants */
+    XDAS_Int8   sadKernel[IVIDDECCOPY_NAMELEN];
+    XDAS_Int8   chromaKernel[IVIDDECCOPY_NAMELEN];
+} IVIDDECCOPY_Status;
+
+/*
+ *  ======== IVIDDECCOPY_OutArgs ========
+ *  Motion detection result for the last frame decoded by the call.
+ *  motionMap holds blocksY rows of blocksX entries, each the mean
+ *  absolute difference of the block's pixels clipped to 255.  Nothing is
+ *  valid for the first frame after creation, XDM_RESET or a change of
+ *  geometry, since there is no previous frame to compare with.
+ *  outputBytes is the size of the last output, a whole gray frame or a
+ *  delta record, whose type also sets the base decodedFrameType.
+ *
+ *  statsValid is set if lumaStats is on and a frame was decoded; the
+ *  histogram then counts the output pixels of the last one at each gray
+ *  level, and lumaSum is their sum, lumaMean its rounded mean.  In delta
+ *  output mode it covers the whole frame, not just the blocks sent.
+ *
+ *  A call decodes one frame per input buffer and its output buffers, one
+ *  per plane.  For each of the numFrames frames, frameError holds the
+ *  extendedError bits of that frame alone (0 if it was decoded) and
+ *  frameBytes its output size, all planes together.  The base
+ *  bytesConsumed counts the frames that were decoded.
+ */
+typedef struct IVIDDECCOPY_OutArgs {
+    IVIDDEC_OutArgs viddecOutArgs;              /* must be first field */
+    XDAS_Int32  motionValid;    /* XDAS_TRUE if the fields below are set */
+    XDAS_Int32  blocksX;
+    XDAS_Int32  blocksY;
+    XDAS_Int32  motionScore;    /* moving blocks, per mille of all blocks */
+    XDAS_UInt32 totalSad;       /* sum of absolute differences, all pixels */
+    XDAS_Int32  outputBytes;    /* bytes written to the output buffer */
+    XDAS_Int32  numFrames;      /* entries set in the two arrays below */
+    XDAS_Int32  frameError[XDM_MAX_IO_BUFFERS];
+    XDAS_Int32  frameBytes[XDM_MAX_IO_BUFFERS];
+    XDAS_Int32  statsValid;     /* XDAS_TRUE if the fields below are set */
+    XDAS_Int32  lumaMin;
+    XDAS_Int32  lumaMax;
+    XDAS_Int32  lumaMean;
+    XDAS_UInt32 lumaSum;
+    XDAS_UInt32 histogram[IVIDDECCOPY_HISTBINS];
+    XDAS_UInt8  motionMap[IVIDDECCOPY_MAXBLOCKS];
+} IVIDDECCOPY_OutArgs;
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2010, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+/*
+ *  ======== ividencgray.h ========
+ *  Stream format of the VIDENCGRAY lossless gray encoder.
+ *
+ *  Each encoded frame is an IVIDENCGRAY_FrameHeader followed by the
+ *  frame's lines, top to bottom.  A line is coded in groups of 32
+ *  pixels, the last one padded with pixels that predict exactly:
+ *    - every pixel is predicted from its neighbours a (left), b (above)
+ *      and c (above left) by the median of a, b and a + b - c, the LOCO-I
+ *      predictor.  The first line predicts from a alone, the first pixel
+ *      of a line from b alone, the first pixel of the frame is
+ *      predicted as 128.
+ *    - the difference to the prediction, modulo 256 as a signed byte e,
+ *      is mapped to 2e for e >= 0 and -2e - 1 otherwise, so small
+ *      differences of either sign give small codes.
+ *    - a group starts with a byte whose low and high nibble are the bit
+ *      widths n0 and n1, 0 to 8, of the largest code of its first and
+ *      second 16 pixels.  Then come the codes of each half, 2 * n bytes
+ *      of them: two runs of 8 codes of n bits, the first code in the
+ *      least significant bits of the first byte.
+ *
+ *  Frames are coded on their own, any one can be decoded without the
+ *  ones before it.
+ */
+#ifndef IVIDENCGRAY_
+#define IVIDENCGRAY_
+
+#include <ti/xdais/dm/ividenc.h>
+
+#define IVIDENCGRAY_MAGIC       0x30595247  /* "GRY0" */
+
+/* pixels per group of a line */
+#define IVIDENCGRAY_GROUP       32
+
+typedef struct IVIDENCGRAY_FrameHeader {
+    XDAS_UInt32 magic;          /* IVIDENCGRAY_MAGIC */
+    XDAS_UInt32 size;           /* bytes of the frame, header included */
+    XDAS_Int32  width;
+    XDAS_Int32  height;
+} IVIDENCGRAY_FrameHeader;
+
+/*
+ *  Buffer size for an encoded frame: every code 8 bits wide, and 8 bytes
+ *  the encoder may write past the end of the frame.
+ */
+#define IVIDENCGRAY_MAXSIZE(w, h) ((XDAS_Int32)sizeof( \
+    IVIDENCGRAY_FrameHeader) + (h) * (((w) + IVIDENCGRAY_GROUP - 1) / \
+    IVIDENCGRAY_GROUP) * (IVIDENCGRAY_GROUP + 1) + 8)
+
+#endif
@@ -0,0 +1,593 @@
+/*
+ * Copyright (c) 2010, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+/*
+ *  ======== stats.c ========
+ *  Latency histograms and their exposition, see stats.h.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "stats.h"
+
+#define MAXSTATS        32
+#define SUBBUCKETS      (1 << STATS_SUBBITS)
+#define MAXVALUE        ((1ULL << STATS_MAXBITS) - 1)
+#define LEFIRST         10      /* le buckets 2^10 ns (1 us) ... */
+#define LELAST          36      /* ... 2^36 ns (69 s) */
+#define SENDTIMEOUT     1       /* s a client has to take a dump */
+
+typedef struct Histogram {
+    unsigned long long  count;
+    unsigned long long  sum;    /* ns */
+    unsigned long long  max;
+    unsigned long long  buckets[STATS_BUCKETS];
+} Histogram;
+
+struct Stats {
+    char               *name;
+    Histogram           stage[STATS_NUMSTAGES];
+};
+
+static const char *stageNames[STATS_NUMSTAGES] = {
+    "sensor", "queue", "process", "writeq", "write", "total"
+};
+
+static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+/* every Stats there is, and the dump thread */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static Stats *all[MAXSTATS];
+static int numStats = 0;
+
+static pthread_t thread;
+static int running = 0;
+static int wake[2] = { -1, -1 };    /* a pipe, closed to stop the thread */
+static int listenFd = -1;
+static char *path;
+static int interval;
+
+
+/*
+ *  ======== bucketOf ========
+ *  Values below 2^STATS_SUBBITS have a bucket each; above, each power of
+ *  two is split into SUBBUCKETS buckets by the bits after the top one.
+ */
+static int bucketOf(unsigned long long v)
+{
+    int e;
+
+    if (v > MAXVALUE) {
+        v = MAXVALUE;
+    }
+    if (v < SUBBUCKETS) {
+        return ((int)v);
+    }
+
+    e = 63 - __builtin_clzll(v);
+
+    return (((e - STATS_SUBBITS + 1) << STATS_SUBBITS) +
+        (int)((v >> (e - STATS_SUBBITS)) & (SUBBUCKETS - 1)));
+}
+
+/*
+ *  ======== bucketTop ========
+ *  The largest value in bucket b.
+ */
+static unsigned long long bucketTop(int b)
+{
+    int m = b >> STATS_SUBBITS;
+    unsigned long long sub = b & (SUBBUCKETS - 1);
+
+    if (m == 0) {
+        return (sub);
+    }
+
+    return (((SUBBUCKETS + sub + 1) << (m - 1)) - 1);
+}
+
+/*
+ *  ======== Stats_create ========
+ */
+Stats *Stats_create(const char *name)
+{
+    Stats *s;
+
+    if ((s = calloc(1, sizeof(*s))) == NULL) {
+        return (NULL);
+    }
+
+    if ((s->name = strdup(name)) == NULL) {
+        free(s);
+        return (NULL);
+    }
+
+    pthread_mutex_lock(&lock);
+    if (numStats < MAXSTATS) {
+        all[numStats++] = s;
+    }
+    pthread_mutex_unlock(&lock);
+
+    return (s);
+}
+
+/*
+ *  ======== Stats_delete ========
+ */
+void Stats_delete(Stats *s)
+{
+    int i;
+
+    pthread_mutex_lock(&lock);
+    for (i = 0; i < numStats; i++) {
+        if (all[i] == s) {
+            all[i] = all[--numStats];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    free(s->name);
+    free(s);
+}
+
+/*
+ *  ======== Stats_record ========
+ */
+void Stats_record(Stats *s, Stats_Stage stage, unsigned long long ns)
+{
+    Histogram *h = &s->stage[stage];
+    unsigned long long max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+
+    __atomic_fetch_add(&h->buckets[bucketOf(ns)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum, ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+
+    while ((ns > max) && !__atomic_compare_exchange_n(&h->max, &max, ns, 1,
+        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/*
+ *  ======== Stats_frame ========
+ *  A stage that ends before it starts, a clock step or a stage a path
+ *  doesn't have, is left out.
+ */
+void Stats_frame(Stats *s, const Stats_Frame *f, unsigned long long done)
+{
+    if ((s == NULL) || (f->dequeued == 0)) {
+        return;
+    }
+
+    if (f->monotonic && (f->sensor != 0) && (f->dequeued >= f->sensor)) {
+        Stats_record(s, STATS_SENSOR, f->dequeued - f->sensor);
+    }
+    if (f->started >= f->dequeued) {
+        Stats_record(s, STATS_QUEUE, f->started - f->dequeued);
+    }
+    if (f->ended >= f->started) {
+        Stats_record(s, STATS_PROCESS, f->ended - f->started);
+    }
+    if (f->submitted >= f->ended) {
+        Stats_record(s, STATS_WRITEQ, f->submitted - f->ended);
+    }
+    if (done >= f->submitted) {
+        Stats_record(s, STATS_WRITE, done - f->submitted);
+    }
+    if (done >= f->dequeued) {
+        Stats_record(s, STATS_TOTAL, done - f->dequeued);
+    }
+}
+
+/*
+ *  ======== quantileOf ========
+ *  The top of the bucket holding the value at quantile q, from a copy
+ *  of the buckets.
+ */
+static unsigned long long quantileOf(const unsigned long long *buckets,
+    unsigned long long count, double q)
+{
+    unsigned long long rank = (unsigned long long)(q * count + 0.5);
+    unsigned long long seen = 0;
+    int b;
+
+    if (count == 0) {
+        return (0);
+    }
+
+    rank = rank < 1 ? 1 : rank;
+
+    for (b = 0; b < STATS_BUCKETS; b++) {
+        if ((seen += buckets[b]) >= rank) {
+            return (bucketTop(b));
+        }
+    }
+
+    return (MAXVALUE);
+}
+
+/*
+ *  ======== Stats_quantile ========
+ */
+unsigned long long Stats_quantile(Stats *s, Stats_Stage stage, double q)
+{
+    Histogram *h = &s->stage[stage];
+    unsigned long long buckets[STATS_BUCKETS];
+    unsigned long long count = 0;
+    int b;
+
+    for (b = 0; b < STATS_BUCKETS; b++) {
+        buckets[b] = __atomic_load_n(&h->buckets[b], __ATOMIC_RELAXED);
+        count += buckets[b];
+    }
+
+    return (quantileOf(buckets, count, q));
+}
+
+/*
+ *  ======== snapshot ========
+ *  Copy the buckets of a histogram, returning the count they add up to,
+ *  so a dump is consistent even while frames are being recorded.
+ */
+static unsigned long long snapshot(Histogram *h, unsigned long long *buckets)
+{
+    unsigned long long count = 0;
+    int b;
+
+    for (b = 0; b < STATS_BUCKETS; b++) {
+        buckets[b] = __atomic_load_n(&h->buckets[b], __ATOMIC_RELAXED);
+        count += buckets[b];
+    }
+
+    return (count);
+}
+
+/*
+ *  ======== dumpHistogram ========
+ *  One histogram as a Prometheus histogram; bucket boundaries fall on
+ *  every power of two, so the le buckets are exact sums.
+ */
+static void dumpHistogram(FILE *f, Stats *s, int stage)
+{
+    Histogram *h = &s->stage[stage];
+    unsigned long long buckets[STATS_BUCKETS];
+    unsigned long long count = snapshot(h, buckets);
+    unsigned long long below = 0;
+    int b = 0;
+    int e;
+
+    for (e = LEFIRST; e <= LELAST; e++) {
+        for (; (b < STATS_BUCKETS) && (bucketTop(b) < (1ULL << e)); b++) {
+            below += buckets[b];
+        }
+        fprintf(f, "viddec_frame_stage_seconds_bucket{device=\"%s\","
+            "stage=\"%s\",le=\"%.9g\"} %llu\n", s->name, stageNames[stage],
+            (double)(1ULL << e) / 1e9, below);
+    }
+    fprintf(f, "viddec_frame_stage_seconds_bucket{device=\"%s\",stage=\"%s\","
+        "le=\"+Inf\"} %llu\n", s->name, stageNames[stage], count);
+    fprintf(f, "viddec_frame_stage_seconds_sum{device=\"%s\",stage=\"%s\"} "
+        "%.9f\n", s->name, stageNames[stage],
+        __atomic_load_n(&h->sum, __ATOMIC_RELAXED) / 1e9);
+    fprintf(f, "viddec_frame_stage_seconds_count{device=\"%s\",stage=\"%s\"} "
+        "%llu\n", s->name, stageNames[stage], count);
+}
+
+/*
+ *  ======== dumpQuantiles ========
+ */
+static void dumpQuantiles(FILE *f, Stats *s, int stage)
+{
+    unsigned long long buckets[STATS_BUCKETS];
+    unsigned long long count = snapshot(&s->stage[stage], buckets);
+    unsigned int q;
+
+    for (q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++) {
+        fprintf(f, "viddec_frame_stage_quantile_seconds{device=\"%s\","
+            "stage=\"%s\",quantile=\"%g\"} %.9f\n", s->name,
+            stageNames[stage], quantiles[q],
+            quantileOf(buckets, count, quantiles[q]) / 1e9);
+    }
+}
+
+/*
+ *  ======== dumpMax ========
+ */
+static void dumpMax(FILE *f, Stats *s, int stage)
+{
+    fprintf(f, "viddec_frame_stage_max_seconds{device=\"%s\",stage=\"%s\"} "
+        "%.9f\n", s->name, stageNames[stage],
+        __atomic_load_n(&s->stage[stage].max, __ATOMIC_RELAXED) / 1e9);
+}
+
+/*
+ *  ======== dumpFamily ========
+ *  Every line of a metric family must come together.
+ */
+static void dumpFamily(FILE *f, const char *help,
+    void (*fxn)(FILE *f, Stats *s, int stage))
+{
+    int stage;
+    int i;
+
+    fputs(help, f);
+
+    for (i = 0; i < numStats; i++) {
+        for (stage = 0; stage < STATS_NUMSTAGES; stage++) {
+            fxn(f, all[i], stage);
+        }
+    }
+}
+
+/*
+ *  ======== sendAll ========
+ *  Write len bytes to fd, a socket or a file.  Sockets are sent to with
+ *  MSG_NOSIGNAL: a client gone is an EPIPE error, not a SIGPIPE.
+ */
+static int sendAll(int fd, const char *buf, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0) {
+        n = send(fd, buf, len, MSG_NOSIGNAL);
+        if ((n < 0) && (errno == ENOTSOCK)) {
+            n = write(fd, buf, len);
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return (-1);
+        }
+        buf += n;
+        len -= n;
+    }
+
+    return (0);
+}
+
+/*
+ *  ======== Stats_dump ========
+ *  The text is put together under the lock and written without it, so
+ *  a slow reader holds up no one recording.
+ */
+int Stats_dump(int fd)
+{
+    FILE *f;
+    char *buf = NULL;
+    size_t len = 0;
+    int r;
+
+    if ((f = open_memstream(&buf, &len)) == NULL) {
+        return (-1);
+    }
+
+    pthread_mutex_lock(&lock);
+
+    dumpFamily(f, "# HELP viddec_frame_stage_seconds Time frames spend in "
+        "each stage from sensor to disk.\n"
+        "# TYPE viddec_frame_stage_seconds histogram\n", dumpHistogram);
+    dumpFamily(f, "# HELP viddec_frame_stage_quantile_seconds Quantiles of "
+        "viddec_frame_stage_seconds, to within 3%.\n"
+        "# TYPE viddec_frame_stage_quantile_seconds gauge\n", dumpQuantiles);
+    dumpFamily(f, "# HELP viddec_frame_stage_max_seconds Longest time in "
+        "the stage.\n"
+        "# TYPE viddec_frame_stage_max_seconds gauge\n", dumpMax);
+
+    pthread_mutex_unlock(&lock);
+
+    r = (ferror(f) != 0) ? -1 : 0;
+    if (fclose(f) != 0) {
+        r = -1;
+    }
+
+    if (r == 0) {
+        r = sendAll(fd, buf, len);
+    }
+    free(buf);
+
+    return (r);
+}
+
+/*
+ *  ======== dumpFile ========
+ *  Replace the file as a whole, so a reader never sees half a dump.
+ */
+static void dumpFile(void)
+{
+    char tmp[4096];
+    int fd;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    if ((fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+        return;
+    }
+
+    if ((Stats_dump(fd) == 0) && (close(fd) == 0)) {
+        rename(tmp, path);
+    }
+    else {
+        close(fd);
+        unlink(tmp);
+    }
+}
+
+/*
+ *  ======== dumpThread ========
+ */
+static void *dumpThread(void *arg)
+{
+    struct timeval timeout = { SENDTIMEOUT, 0 };
+    struct pollfd fds[2];
+    int fd;
+
+    (void)arg;
+
+    fds[0].fd = wake[0];
+    fds[0].events = POLLIN;
+    fds[1].fd = listenFd;
+    fds[1].events = POLLIN;
+
+    for (;;) {
+        if (poll(fds, listenFd >= 0 ? 2 : 1,
+            listenFd >= 0 ? -1 : interval * 1000) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (fds[0].revents) {
+            break;
+        }
+
+        if (listenFd < 0) {
+            dumpFile();
+        }
+        else if (fds[1].revents &&
+            ((fd = accept(listenFd, NULL, NULL)) >= 0)) {
+            /* a client that doesn't read is dropped, not waited for */
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout,
+                sizeof(timeout));
+            Stats_dump(fd);
+            close(fd);
+        }
+    }
+
+    return (NULL);
+}
+
+/*
+ *  ======== Stats_start ========
+ */
+int Stats_start(const char *where, int every)
+{
+    struct sockaddr_un addr;
+    int error;
+
+    if (running) {
+        errno = EBUSY;
+        return (-1);
+    }
+
+    interval = every > 0 ? every : 1;
+
+    if (strncmp(where, "unix:", 5) == 0) {
+        where += 5;
+
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(where) >= sizeof(addr.sun_path)) {
+            errno = ENAMETOOLONG;
+            return (-1);
+        }
+        strcpy(addr.sun_path, where);
+
+        /* a socket left by an earlier run */
+        unlink(where);
+
+        if (((listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) ||
+            (bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+            (listen(listenFd, 4) != 0)) {
+            goto fail;
+        }
+    }
+
+    if (((path = strdup(where)) == NULL) || (pipe(wake) != 0)) {
+        goto fail;
+    }
+
+    if ((errno = pthread_create(&thread, NULL, dumpThread, NULL)) != 0) {
+        goto fail;
+    }
+
+    running = 1;
+
+    return (0);
+
+fail:
+    error = errno;
+    if (wake[0] >= 0) {
+        close(wake[0]);
+        close(wake[1]);
+        wake[0] = wake[1] = -1;
+    }
+    if (listenFd >= 0) {
+        close(listenFd);
+        listenFd = -1;
+    }
+    free(path);
+    path = NULL;
+    errno = error;
+
+    return (-1);
+}
+
+/*
+ *  ======== Stats_stop ========
+ */
+void Stats_stop(void)
+{
+    if (!running) {
+        return;
+    }
+
+    /* the read end hangs up */
+    close(wake[1]);
+    pthread_join(thread, NULL);
+    running = 0;
+
+    close(wake[0]);
+    wake[0] = wake[1] = -1;
+
+    if (listenFd >= 0) {
+        close(listenFd);
+        listenFd = -1;
+        unlink(path);
+    }
+    else {
+        dumpFile();
+    }
+
+    free(path);
+    path = NULL;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2010, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+/*
+ *  ======== stats.h ========
+ *  Per-stage frame latency histograms of the app.
+ *
+ *  Each frame carries a Stats_Frame with the CLOCK_MONOTONIC time it
+ *  reached each stage, and Stats_frame() adds the time between stages to
+ *  the histograms of its device once the frame is on disk.  Histograms
+ *  are log-linear, in the style of HdrHistogram: 2^STATS_SUBBITS buckets
+ *  between each power of two ns, so a value is kept to within 3%.
+ *  Recording is a few relaxed atomic adds and takes no lock, from any
+ *  thread.
+ *
+ *  Stats_start() writes all histograms in the Prometheus text exposition
+ *  format, every so many seconds to a file, or to each client that
+ *  connects to a Unix socket.
+ */
+#ifndef STATS_
+#define STATS_
+
+#define STATS_SUBBITS   5
+#define STATS_MAXBITS   40      /* longer than 2^40 ns (18 min) is clamped */
+#define STATS_BUCKETS   ((STATS_MAXBITS - STATS_SUBBITS + 1) << STATS_SUBBITS)
+
+/* the time between two stages of a frame */
+typedef enum Stats_Stage {
+    STATS_SENSOR,       /* V4L2 timestamp to VIDIOC_DQBUF */
+    STATS_QUEUE,        /* dequeued to VIDDEC_process() */
+    STATS_PROCESS,      /* VIDDEC_process() */
+    STATS_WRITEQ,       /* process end to write submit */
+    STATS_WRITE,        /* write submit to write complete */
+    STATS_TOTAL,        /* dequeued to write complete */
+    STATS_NUMSTAGES
+} Stats_Stage;
+
+typedef struct Stats_Frame {
+    unsigned int        sequence;   /* V4L2 sequence number */
+    unsigned long long  sensor;     /* V4L2 timestamp, in ns */
+    int                 monotonic;  /* sensor is CLOCK_MONOTONIC too */
+    unsigned long long  dequeued;   /* 0 if this is no frame */
+    unsigned long long  started;
+    unsigned long long  ended;
+    unsigned long long  submitted;
+} Stats_Frame;
+
+typedef struct Stats Stats;
+
+/* histograms labelled name; NULL if there is no memory */
+extern Stats *Stats_create(const char *name);
+extern void Stats_delete(Stats *s);
+
+/* add ns to the histogram of stage */
+extern void Stats_record(Stats *s, Stats_Stage stage, unsigned long long ns);
+
+/* add every stage of f, which completed at time done */
+extern void Stats_frame(Stats *s, const Stats_Frame *f,
+    unsigned long long done);
+
+/* the value at quantile q (0 to 1) of stage, in ns */
+extern unsigned long long Stats_quantile(Stats *s, Stats_Stage stage,
+    double q);
+
+/* write every histogram created so far to fd; -1 with errno on failure */
+extern int Stats_dump(int fd);
+
+/*
+ * dump every interval s to the file where, or to each client of the
+ * Unix socket path where is "unix:path", dropping a client that doesn't
+ * take it within a second; 0 on success, -1 with errno
+ */
+extern int Stats_start(const char *where, int interval);
+
+/* stop dumping, after a last dump to the file */
+extern void Stats_stop(void);
+
+#endif
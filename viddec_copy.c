@@ -39,25 +39,56 @@
  */
 #include <xdc/std.h>
 #include <string.h>
+#ifndef _TI_
+#include <time.h>
+#endif
 
 #include <ti/xdais/dm/ividdec.h>
 #include <ti/sdo/ce/trace/gt.h>
 
 #include "viddec_copy_ti.h"
+#include "ividdeccopy.h"
+#include "viddec_copy_kernels.h"
 #include "viddec_copy_ti_priv.h"
 
 /* buffer definitions */
 #define MININBUFS       1
 #define MINOUTBUFS      1
-#define MININBUFSIZE    1
-#define MINOUTBUFSIZE   1
+
+/* memTab entries of one instance */
+#define OBJMEMTAB       0   /* VIDDECCOPY_TI_Obj, persistent */
+#define PREVMEMTAB      1   /* previous gray frame, persistent */
+#define STRIPMEMTAB     2   /* block rows being worked on, scratch */
+#define NUMMEMTABS      3
+
+#define CACHELINE       128 /* the longest cache line of the targets */
 
 #define NSAMPLES    1024  /* must be multiple of 128 for cache/DMA reasons */
 #define OFRAMESIZE  (NSAMPLES * 300)  /* raw frame (input) */
 
-#define WIDTH       640
+#define WIDTH       640   /* default geometry, see XDM_SETDEFAULT */
 #define HEIGHT      480
 
+#define MOTIONTHRESHOLD 8 /* default mean abs difference of a moving block */
+#define KEYINTERVAL     30  /* default delta records per keyframe */
+
+/* bytes the current geometry touches in each input and output buffer */
+#define INFRAMESIZE(obj)  ((obj)->inPitch * ((obj)->inHeight - 1) + \
+                           (obj)->inWidth * 2)
+#define OUTFRAMESIZE(obj) ((obj)->outputMode == IVIDDECCOPY_DELTA ? \
+    IVIDDECCOPY_DELTASIZE((obj)->width, (obj)->height) : \
+    (obj)->outPitch * ((obj)->height - 1) + (obj)->width)
+
+/* output buffers of a frame, and the bytes of each chroma plane */
+#define NUMPLANES(obj)    IVIDDECCOPY_PLANES((obj)->chromaFormat)
+#define UVPLANESIZE(obj)  ((obj)->uvPitch * ((obj)->height / 2 - 1) + \
+    (((obj)->chromaFormat == XDM_YUV_420SP) ? (obj)->width : \
+     (obj)->width / 2))
+
+/* whether the previous frame is kept up to date */
+#define KEEPPREV(obj)     ((obj)->motionDetect || \
+                           ((obj)->outputMode == IVIDDECCOPY_DELTA))
+
 extern IALG_Fxns VIDDECCOPY_TI_IALG;
 
 #define IALGFXNS  \
@@ -104,36 +135,137 @@ IALG_Fxns VIDDECCOPY_TI_IALG = {      /* module_vendor_interface */
 
 #endif
 
-/* tracing information */
+/*
+ *  tracing information; only alloc(), free() and initObj() use the
+ *  module mask, instances trace through their own copy in the object
+ */
 #define GTNAME "ti.sdo.ce.examples.codecs.viddec_copy"
 static GT_Mask curTrace = {NULL,NULL};
 
+static Void setGeometry(VIDDECCOPY_TI_Obj *obj, XDAS_Int32 width,
+    XDAS_Int32 height, XDAS_Int32 inPitch, XDAS_Int32 outPitch,
+    const VIDDECCOPY_TI_Region *roi);
+#ifndef _TI_
+static Void startThreads(VIDDECCOPY_TI_Obj *obj);
+static Void stopThreads(VIDDECCOPY_TI_Obj *obj);
+#endif
+
+/* the creator's maximum geometry, if it gave one */
+#define HAVEMAXGEOMETRY(params) (((params) != NULL) && \
+    ((params)->maxWidth > 0) && ((params)->maxHeight > 0))
+
+/* band threads the creator asked for; the DSP has one core to give */
+#ifdef _TI_
+#define NUMTHREADS(params) 1
+#else
+#define NUMTHREADS(params) (((params) == NULL) || \
+    ((params)->size != sizeof(IVIDDECCOPY_Params)) ? 1 : \
+    (((const IVIDDECCOPY_Params *)(params))->numThreads < 1) ? 1 : \
+    (((const IVIDDECCOPY_Params *)(params))->numThreads > \
+     IVIDDECCOPY_MAXTHREADS) ? IVIDDECCOPY_MAXTHREADS : \
+    ((const IVIDDECCOPY_Params *)(params))->numThreads)
+#endif
+
+/*
+ *  process() times itself with the cheapest clock at hand: the free
+ *  running time stamp counter on the DSP, the monotonic clock elsewhere.
+ *  Only the difference of the low 32 bits is kept.
+ */
+#ifdef _TI_
+extern cregister volatile unsigned int TSCL;
+
+#define TIMEUNIT IVIDDECCOPY_CYCLES
+#define NOW() ((XDAS_UInt32)TSCL)
+#else
+#define TIMEUNIT IVIDDECCOPY_NS
+#define NOW() now()
+
+static XDAS_UInt32 now(Void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((XDAS_UInt32)((XDAS_UInt32)ts.tv_sec * 1000000000u +
+        (XDAS_UInt32)ts.tv_nsec));
+}
+#endif
+
+/* add n to the counter c of two words, c[0] the low one */
+static Void count64(XDAS_UInt32 c[2], XDAS_UInt32 n)
+{
+    c[0] += n;
+    if (c[0] < n) {
+        c[1]++;
+    }
+}
+
+/* copy a kernel name into a status field of IVIDDECCOPY_NAMELEN bytes */
+static Void copyName(XDAS_Int8 *dst, String name)
+{
+    strncpy((char *)dst, name, IVIDDECCOPY_NAMELEN - 1);
+    dst[IVIDDECCOPY_NAMELEN - 1] = '\0';
+}
+
+/* clear the counters reported by XDM_GETSTATUS */
+static Void resetCounters(VIDDECCOPY_TI_Obj *obj)
+{
+    obj->calls = 0;
+    obj->frames = 0;
+    obj->failedFrames = 0;
+    obj->bytesIn[0] = obj->bytesIn[1] = 0;
+    obj->bytesOut[0] = obj->bytesOut[1] = 0;
+    obj->totalTime[0] = obj->totalTime[1] = 0;
+    obj->maxTime = 0;
+}
+
 /*
  *  ======== VIDDECCOPY_TI_alloc ========
  */
 Int VIDDECCOPY_TI_alloc(const IALG_Params *algParams,
     IALG_Fxns **pf, IALG_MemRec memTab[])
 {
+    const IVIDDEC_Params *params = (const IVIDDEC_Params *)algParams;
+    XDAS_Int32 numThreads = NUMTHREADS(params);
+
     if (curTrace.modName == NULL) {   /* initialize GT (tracing) */
         GT_create(&curTrace, GTNAME);
     }
 
+    /* pick the fastest pixel kernels this CPU supports */
+    VIDENCCOPY_TI_kernelInit();
+
     GT_3trace(curTrace, GT_ENTER, "VIDDECCOPY_TI_alloc(0x%lx, 0x%lx, 0x%lx)\n",
         algParams, pf, memTab);
 
     /* Request memory for my object */
-    memTab[0].size = sizeof(VIDDECCOPY_TI_Obj);
-    memTab[0].alignment = 0;
-    memTab[0].space = IALG_EXTERNAL;
-    memTab[0].attrs = IALG_PERSIST;
-
-    // memTab[1].size = OFRAMESIZE;
-    // memTab[1].alignment = 0;
-    // memTab[1].space = IALG_EXTERNAL;
-    // memTab[1].attrs = IALG_SCRATCH;
-
-    // return (2);
-    return(1);
+    memTab[OBJMEMTAB].size = sizeof(VIDDECCOPY_TI_Obj);
+    memTab[OBJMEMTAB].alignment = 0;
+    memTab[OBJMEMTAB].space = IALG_EXTERNAL;
+    memTab[OBJMEMTAB].attrs = IALG_PERSIST;
+
+    /* the previous frame, for motion detection up to the max geometry */
+    memTab[PREVMEMTAB].size = HAVEMAXGEOMETRY(params) ?
+        params->maxWidth * params->maxHeight : WIDTH * HEIGHT;
+    memTab[PREVMEMTAB].alignment = 128;
+    memTab[PREVMEMTAB].space = IALG_EXTERNAL;
+    memTab[PREVMEMTAB].attrs = IALG_PERSIST;
+
+    /*
+     *  A block row of the new frame for each band thread and, for delta
+     *  output, a copy of the previous one: a thread's part is 30 KB at
+     *  1920 pixels a line, which the DSP can have in internal RAM and
+     *  which stays in the L2 of a GPP.  Nothing is kept in it from one
+     *  process() call to the next.
+     */
+    memTab[STRIPMEMTAB].size = ((numThreads > 2) ? numThreads : 2) *
+        IVIDDECCOPY_BLOCKSIZE *
+        (HAVEMAXGEOMETRY(params) ? params->maxWidth : WIDTH);
+    memTab[STRIPMEMTAB].alignment = 128;
+    memTab[STRIPMEMTAB].space = IALG_DARAM0;
+    memTab[STRIPMEMTAB].attrs = IALG_SCRATCH;
+
+    return (NUMMEMTABS);
 }
 
 
@@ -142,21 +274,29 @@ Int VIDDECCOPY_TI_alloc(const IALG_Params *algParams,
  */
 Int VIDDECCOPY_TI_free(IALG_Handle handle, IALG_MemRec memTab[])
 {
+    VIDDECCOPY_TI_Obj *obj = (VIDDECCOPY_TI_Obj *)handle;
+
     GT_2trace(curTrace, GT_ENTER, "VIDDECCOPY_TI_free(0x%lx, 0x%lx)\n",
         handle, memTab);
 
-    // VIDDECCOPY_TI_Obj *VIDENC_COPY = (VIDDECCOPY_TI_Obj*)handle;
+#ifndef _TI_
+    /* the instance is about to go away, its threads go first */
+    if (obj->numThreads > 1) {
+        stopThreads(obj);
+    }
+#endif
 
     VIDDECCOPY_TI_alloc(NULL, NULL, memTab);
 
-    memTab[0].base = handle;
+    memTab[OBJMEMTAB].base = handle;
 
-    // memTab[1].base = ((VIDDECCOPY_TI_Obj *)handle)->pGray;
-    // memTab[1].size = OFRAMESIZE;
+    memTab[PREVMEMTAB].base = obj->pPrev;
+    memTab[PREVMEMTAB].size = obj->prevSize;
 
-    // return (2);
+    memTab[STRIPMEMTAB].base = obj->pStrip;
+    memTab[STRIPMEMTAB].size = obj->stripSize;
 
-    return(1);
+    return (NUMMEMTABS);
 }
 
 
@@ -167,30 +307,855 @@ Int VIDDECCOPY_TI_initObj(IALG_Handle handle,
     const IALG_MemRec memTab[], IALG_Handle p,
     const IALG_Params *algParams)
 {
+    VIDDECCOPY_TI_Obj *obj = (VIDDECCOPY_TI_Obj *)handle;
+    const IVIDDEC_Params *params = (const IVIDDEC_Params *)algParams;
+
     GT_4trace(curTrace, GT_ENTER, "VIDDECCOPY_TI_initObj(0x%lx, 0x%lx, 0x%lx, "
         "0x%lx)\n", handle, memTab, p, algParams);
 
-    // VIDENCCOPY_TI_Obj *VIDENC_COPY = (Void *)handle;
+    obj->trace = curTrace;
+    obj->gray = VIDENCCOPY_TI_YUV422_GRAY;
+    obj->sad = VIDENCCOPY_TI_BLOCK_SAD;
+    obj->nv12 = VIDENCCOPY_TI_YUV422_NV12;
+    obj->i420 = VIDENCCOPY_TI_YUV422_I420;
+    obj->grayName = VIDENCCOPY_TI_grayKernelName;
+    obj->sadName = VIDENCCOPY_TI_sadKernelName;
+    obj->chromaName = VIDENCCOPY_TI_chromaKernelName;
+
+    obj->pPrev = (XDAS_UInt8 *)memTab[PREVMEMTAB].base;
+    obj->prevSize = memTab[PREVMEMTAB].size;
+    obj->prevValid = XDAS_FALSE;
+    obj->motionDetect = XDAS_FALSE;
+    obj->motionThreshold = MOTIONTHRESHOLD;
+
+    obj->pStrip = (XDAS_UInt8 *)memTab[STRIPMEMTAB].base;
+    obj->stripSize = memTab[STRIPMEMTAB].size;
+    obj->outputMode = IVIDDECCOPY_FULL;
+    obj->keyInterval = KEYINTERVAL;
+    obj->deltaThreshold = 0;
+    obj->sinceKey = 0;
+    obj->chromaFormat = XDM_GRAY;
+    obj->lumaStats = XDAS_FALSE;
+
+    resetCounters(obj);
+#ifdef _TI_
+    TSCL = 0;   /* the first write starts the counter, later ones are ignored */
+#endif
 
-   // ((VIDDECCOPY_TI_Obj *)handle)->pGray  = memTab[1].base;
+    obj->numThreads = NUMTHREADS(params);
+    obj->numBands = 1;
+    obj->band[0].obj = obj;
+    obj->band[0].index = 0;
+#ifndef _TI_
+    if (obj->numThreads > 1) {
+        startThreads(obj);
+    }
+#endif
+
+    /* start out at the maximum geometry the creator asked for */
+    if (HAVEMAXGEOMETRY(params)) {
+        setGeometry(obj, params->maxWidth, params->maxHeight, 0, 0, NULL);
+    }
+    else {
+        setGeometry(obj, WIDTH, HEIGHT, 0, 0, NULL);
+    }
 
     return (IALG_EOK);
 }
 
 
-Int VIDENCCOPY_TI_YUV422_C_GRAY(XDAS_UInt8* pGray, XDAS_UInt8* pYUV422, 
-    XDAS_Int32 height, XDAS_Int32 width)
+/*
+ *  ======== setGeometry ========
+ *  Set the input geometry, a pitch of 0 meaning tightly packed lines,
+ *  and the region of it that is converted: all of it, unscaled, if roi
+ *  is NULL.  A new region or output size makes the previous frame
+ *  useless for motion detection.
+ */
+static Void setGeometry(VIDDECCOPY_TI_Obj *obj, XDAS_Int32 width,
+    XDAS_Int32 height, XDAS_Int32 inPitch, XDAS_Int32 outPitch,
+    const VIDDECCOPY_TI_Region *roi)
 {
+    VIDDECCOPY_TI_Region full;
+
+    if (roi == NULL) {
+        full.x = 0;
+        full.y = 0;
+        full.width = width;
+        full.height = height;
+        full.factor = 1;
+        full.outWidth = width;
+        full.outHeight = height;
+        roi = &full;
+    }
+
+    if (memcmp(roi, &obj->roi, sizeof(*roi)) != 0) {
+        obj->prevValid = XDAS_FALSE;
+    }
 
-    XDAS_Int32 frames = height * width;
+    obj->inWidth = width;
+    obj->inHeight = height;
+    obj->inPitch = (inPitch == 0) ? width * 2 : inPitch;
+    obj->roi = *roi;
+    obj->width = roi->outWidth;
+    obj->height = roi->outHeight;
+    obj->outPitch = (outPitch == 0) ? obj->width : outPitch;
+    obj->uvPitch = (obj->chromaFormat == XDM_YUV_420P) ? obj->outPitch / 2 :
+        obj->outPitch;
+    obj->stepX = (XDAS_Int32)(((XDAS_UInt32)roi->width << 16) /
+        roi->outWidth);
+    obj->stepY = (XDAS_Int32)(((XDAS_UInt32)roi->height << 16) /
+        roi->outHeight);
+}
+
+
+/*
+ *  ======== setParams ========
+ *  Apply base or extended dynamic params.  The current geometry is only
+ *  changed if the new one is valid.
+ */
+static XDAS_Int32 setParams(VIDDECCOPY_TI_Obj *obj,
+    IVIDDEC_DynamicParams *params)
+{
+    VIDDECCOPY_TI_Region roi = obj->roi;
+    XDAS_Int32 width = obj->inWidth;
+    XDAS_Int32 height = obj->inHeight;
+    XDAS_Int32 inWidth;
+    XDAS_Int32 inHeight;
+    XDAS_Int32 inPitch = obj->inPitch;
+    XDAS_Int32 outPitch = 0;
+    XDAS_Int32 motionDetect = obj->motionDetect;
+    XDAS_Int32 motionThreshold = obj->motionThreshold;
+    XDAS_Int32 outputMode = obj->outputMode;
+    XDAS_Int32 keyInterval = obj->keyInterval;
+    XDAS_Int32 deltaThreshold = obj->deltaThreshold;
+    XDAS_Int32 chromaFormat = obj->chromaFormat;
+    XDAS_Int32 lumaStats = obj->lumaStats;
+    XDAS_Int32 delta;
+
+    if (params->size == sizeof(IVIDDECCOPY_DynamicParams)) {
+        IVIDDECCOPY_DynamicParams *ext = (IVIDDECCOPY_DynamicParams *)params;
+
+        width = ext->width;
+        height = ext->height;
+        inPitch = (ext->inPitch == 0) ? width * 2 : ext->inPitch;
+        outPitch = ext->outPitch;
+        motionDetect = ext->motionDetect ? XDAS_TRUE : XDAS_FALSE;
+        motionThreshold = ext->motionThreshold;
+        outputMode = ext->outputMode;
+        keyInterval = ext->keyInterval;
+        deltaThreshold = ext->deltaThreshold;
+        chromaFormat = (ext->chromaFormat == 0) ? XDM_GRAY :
+            ext->chromaFormat;
+        lumaStats = ext->lumaStats ? XDAS_TRUE : XDAS_FALSE;
+
+        roi.x = ext->cropX;
+        roi.y = ext->cropY;
+        roi.width = (ext->cropWidth == 0) ? width - roi.x : ext->cropWidth;
+        roi.height = (ext->cropHeight == 0) ? height - roi.y :
+            ext->cropHeight;
+        roi.factor = (ext->scaleFactor == 0) ? 1 : ext->scaleFactor;
+        roi.outWidth = ext->scaleWidth;
+        roi.outHeight = ext->scaleHeight;
+
+        /* bilinear to a size, or a box filter, not both */
+        if ((roi.outWidth != 0) || (roi.outHeight != 0)) {
+            roi.factor = (roi.factor == 1) ? 0 : -1;
+        }
+    }
 
-    int i;
-    for (i = 0; i < frames; ++i)
+    if ((roi.factor == 1) || (roi.factor == 2) || (roi.factor == 4)) {
+        roi.outWidth = roi.width / roi.factor;
+        roi.outHeight = roi.height / roi.factor;
+    }
+
+    /* base xDM: displayWidth is the output pitch, 0 => image width */
+    if (outPitch == 0) {
+        outPitch = (params->displayWidth > 0) ? params->displayWidth :
+            roi.outWidth;
+    }
+
+    if ((width <= 0) || (height <= 0) || (inPitch < width * 2) ||
+        (outPitch < roi.outWidth)) {
+
+        GT_4trace(obj->trace, GT_7CLASS, "VIDDECCOPY_TI_control> unsupported "
+            "geometry %dx%d, pitch in %d out %d\n", width, height,
+            inPitch, outPitch);
+
+        return (IVIDDEC_EFAIL);
+    }
+
+    if ((roi.x < 0) || (roi.y < 0) || (roi.width <= 0) ||
+        (roi.height <= 0) || (roi.x + roi.width > width) ||
+        (roi.y + roi.height > height) || (roi.factor < 0) ||
+        (roi.factor == 3) || (roi.factor > 4) || (roi.outWidth <= 0) ||
+        (roi.outHeight <= 0)) {
+
+        GT_6trace(obj->trace, GT_7CLASS, "VIDDECCOPY_TI_control> unsupported "
+            "region %dx%d at (%d, %d) to %dx%d\n", roi.width, roi.height,
+            roi.x, roi.y, roi.outWidth, roi.outHeight);
+
+        return (IVIDDEC_EFAIL);
+    }
+
+    /* from here on, the output geometry */
+    inWidth = width;
+    inHeight = height;
+    width = roi.outWidth;
+    height = roi.outHeight;
+
+    if ((outputMode != IVIDDECCOPY_FULL) &&
+        (outputMode != IVIDDECCOPY_DELTA)) {
+
+        GT_1trace(obj->trace, GT_7CLASS, "VIDDECCOPY_TI_control> unsupported "
+            "output mode %d\n", outputMode);
+
+        return (IVIDDEC_EFAIL);
+    }
+
+    delta = (outputMode == IVIDDECCOPY_DELTA);
+
+    if (lumaStats &&
+        ((XDAS_UInt32)width * height > IVIDDECCOPY_MAXSTATSPIXELS)) {
+
+        GT_2trace(obj->trace, GT_7CLASS, "VIDDECCOPY_TI_control> no luma "
+            "statistics for %dx%d\n", width, height);
+
+        return (IVIDDEC_EFAIL);
+    }
+
+    /* 4:2:0 chroma comes from whole YUYV pairs of whole line pairs */
+    if ((chromaFormat != XDM_GRAY) && (delta || (roi.factor != 1) ||
+        ((chromaFormat != XDM_YUV_420SP) &&
+         (chromaFormat != XDM_YUV_420P)) || ((width & 1) != 0) ||
+        ((height & 1) != 0) || ((roi.x & 1) != 0) ||
+        ((chromaFormat == XDM_YUV_420P) && ((outPitch & 1) != 0)))) {
+
+        GT_4trace(obj->trace, GT_7CLASS, "VIDDECCOPY_TI_control> unsupported "
+            "chroma format %d for %dx%d, output mode %d\n", chromaFormat,
+            width, height, outputMode);
+
+        return (IVIDDEC_EFAIL);
+    }
+
+    /*
+     *  The previous frame and the motion map must hold the whole frame,
+     *  the strip buffer two block rows of it or one for each thread.
+     */
+    if ((motionDetect || delta) && ((width * height > obj->prevSize) ||
+        (((obj->numThreads > 2) ? obj->numThreads : 2) *
+         IVIDDECCOPY_BLOCKSIZE * width > obj->stripSize) ||
+        (width > IVIDDECCOPY_MAXWIDTH) || (height > IVIDDECCOPY_MAXHEIGHT) ||
+        (motionThreshold < 0))) {
+
+        GT_3trace(obj->trace, GT_7CLASS, "VIDDECCOPY_TI_control> no motion "
+            "detection for %dx%d, threshold %d\n", width, height,
+            motionThreshold);
+
+        return (IVIDDEC_EFAIL);
+    }
+
+    if (delta && ((keyInterval < 0) || (deltaThreshold < 0) ||
+        (deltaThreshold > 255))) {
+
+        GT_2trace(obj->trace, GT_7CLASS, "VIDDECCOPY_TI_control> no delta "
+            "output with keyframes every %d, threshold %d\n", keyInterval,
+            deltaThreshold);
+
+        return (IVIDDEC_EFAIL);
+    }
+
+    /* not kept up to date while unused, and a new mode starts with a key */
+    if (!KEEPPREV(obj) || (outputMode != obj->outputMode)) {
+        obj->prevValid = XDAS_FALSE;
+    }
+
+    obj->motionDetect = motionDetect;
+    obj->motionThreshold = motionThreshold;
+    obj->outputMode = outputMode;
+    obj->keyInterval = keyInterval;
+    obj->deltaThreshold = deltaThreshold;
+    obj->chromaFormat = chromaFormat;
+    obj->lumaStats = lumaStats;
+
+    setGeometry(obj, inWidth, inHeight, inPitch, outPitch, &roi);
+
+    return (IVIDDEC_EOK);
+}
+
+
+/*
+ *  ======== convertLines ========
+ *  Convert lines lines of the output image, from line first on, into
+ *  pGray, grayPitch bytes apart.  Each output line is made in one go from
+ *  the input lines of the region of interest it needs: the gray kernel,
+ *  over the whole run of lines if neither image has padding at the end
+ *  of its lines; the box filter; or the bilinear one.  Nothing outside
+ *  the region is read.
+ */
+static Void convertLines(VIDDECCOPY_TI_Obj *obj, XDAS_UInt8 *pGray,
+    XDAS_Int32 grayPitch, XDAS_Int32 first, XDAS_Int32 lines)
+{
+    XDAS_UInt8 *pRoi = obj->pYUV422 + obj->roi.y * obj->inPitch +
+        obj->roi.x * 2;
+    XDAS_Int32 factor = obj->roi.factor;
+    XDAS_Int32 y, y0, y1, pos;
+
+    switch (factor) {
+        case 1:
+            pRoi += first * obj->inPitch;
+
+            if ((obj->inPitch == obj->width * 2) &&
+                (grayPitch == obj->width)) {
+                obj->gray(pGray, pRoi, lines, obj->width);
+                break;
+            }
+
+            for (y = 0; y < lines; y++) {
+                obj->gray(pGray, pRoi, 1, obj->width);
+                pGray += grayPitch;
+                pRoi += obj->inPitch;
+            }
+            break;
+
+        case 2:
+        case 4:
+            pRoi += first * factor * obj->inPitch;
+
+            for (y = 0; y < lines; y++) {
+                VIDENCCOPY_TI_YUV422_C_GRAY_BOX(pGray, pRoi, obj->inPitch,
+                    obj->width, factor);
+                pGray += grayPitch;
+                pRoi += factor * obj->inPitch;
+            }
+            break;
+
+        default:
+            /* centred like VIDENCCOPY_TI_YUV422_C_GRAY_LINEAR's columns */
+            pos = (obj->stepY - 0x10000) / 2 + first * obj->stepY;
+
+            for (y = 0; y < lines; y++, pos += obj->stepY) {
+                y0 = (pos < 0) ? 0 : pos >> 16;
+                y1 = (y0 + 1 < obj->roi.height) ? y0 + 1 : y0;
+
+                VIDENCCOPY_TI_YUV422_C_GRAY_LINEAR(pGray,
+                    pRoi + y0 * obj->inPitch, pRoi + y1 * obj->inPitch,
+                    (pos < 0) ? 0 : (pos >> 8) & 0xff, obj->width,
+                    obj->roi.width, obj->stepX);
+                pGray += grayPitch;
+            }
+            break;
+    }
+}
+
+
+/*
+ *  ======== convertChroma ========
+ *  Make the chroma of lines lines (even) of the output image from line
+ *  first (even) on: each chroma line from a pair of the region's input
+ *  lines, which convertLines() has just brought into the cache.
+ */
+static Void convertChroma(VIDDECCOPY_TI_Obj *obj, XDAS_Int32 first,
+    XDAS_Int32 lines)
+{
+    XDAS_UInt8 *pRoi = obj->pYUV422 + (obj->roi.y + first) * obj->inPitch +
+        obj->roi.x * 2;
+    XDAS_Int32 offset = (first / 2) * obj->uvPitch;
+    XDAS_Int32 y;
+
+    for (y = 0; y < lines; y += 2) {
+        if (obj->chromaFormat == XDM_YUV_420SP) {
+            obj->nv12(obj->pU + offset, pRoi, pRoi + obj->inPitch,
+                obj->width);
+        }
+        else {
+            obj->i420(obj->pU + offset, obj->pV + offset, pRoi,
+                pRoi + obj->inPitch, obj->width);
+        }
+        pRoi += 2 * obj->inPitch;
+        offset += obj->uvPitch;
+    }
+}
+
+
+/*
+ *  ======== VIDENCCOPY_TI_diff ========
+ *  Motion stage for height (at most 16) lines of the new gray image at
+ *  curDiff, curPitch bytes apart: SAD of each block into blockSad,
+ *  against the previous frame at preDiff, which is updated in place.
+ *  Writes the row of the motion map if map is not NULL, adds the blocks
+ *  over the threshold to *moving and returns the total SAD of the lines.
+ */
+XDAS_UInt32 VIDENCCOPY_TI_diff(VIDDECCOPY_TI_Obj *obj, XDAS_UInt8 *preDiff,
+    XDAS_UInt8 *curDiff, XDAS_Int32 curPitch, XDAS_Int32 height,
+    XDAS_UInt32 *blockSad, XDAS_UInt8 *map, XDAS_Int32 *moving)
+{
+    XDAS_UInt32 totalSad = 0;
+    XDAS_UInt32 mean;
+    XDAS_Int32 blocks = IVIDDECCOPY_BLOCKS(obj->width);
+    XDAS_Int32 width;
+    XDAS_Int32 b;
+
+    obj->sad(blockSad, preDiff, obj->width, curDiff, curPitch, height,
+        obj->width);
+
+    for (b = 0; b < blocks; b++) {
+        width = obj->width - b * IVIDDECCOPY_BLOCKSIZE;
+        width = (width < IVIDDECCOPY_BLOCKSIZE) ? width : IVIDDECCOPY_BLOCKSIZE;
+
+        /* never above 255, the largest difference of two pixels */
+        mean = blockSad[b] / (width * height);
+
+        if (mean >= (XDAS_UInt32)obj->motionThreshold) {
+            (*moving)++;
+        }
+
+        if (map != NULL) {
+            map[b] = (XDAS_UInt8)mean;
+        }
+
+        totalSad += blockSad[b];
+    }
+
+    return (totalSad);
+}
+
+
+/*
+ *  ======== convertBand ========
+ *  Convert the lines of one band of a frame.  With motion detection on
+ *  this goes a block row at a time through the band's strip buffer: the
+ *  row is converted into it, compared with the previous frame there and
+ *  only then written to the output, so every stage works on the on-chip
+ *  (or cache resident) copy instead of making its own trip to external
+ *  memory.  The first frame of a geometry only fills the previous frame.
+ *  The chroma and the luma histogram, if asked for, are made from each
+ *  block row right after its luma, motion detection or not.
+ */
+static Void convertBand(VIDDECCOPY_TI_Obj *obj, VIDDECCOPY_TI_Band *band)
+{
+    XDAS_UInt32 blockSad[IVIDDECCOPY_MAXWIDTH / IVIDDECCOPY_BLOCKSIZE];
+    XDAS_Int32 blocksX = IVIDDECCOPY_BLOCKS(obj->width);
+    XDAS_UInt8 *pGray = obj->pGray + band->first * obj->outPitch;
+    XDAS_UInt8 *pPrev = obj->pPrev + band->first * obj->width;
+    XDAS_UInt8 *pStrip = obj->pStrip +
+        band->index * IVIDDECCOPY_BLOCKSIZE * obj->width;
+    XDAS_UInt8 *map = obj->pMap;
+    XDAS_Int32 end = band->first + band->lines;
+    XDAS_UInt32 totalSad = 0;
+    XDAS_Int32 moving = 0;
+    XDAS_Int32 lines;
+    XDAS_Int32 y;
+    XDAS_Int32 i;
+
+    band->totalSad = 0;
+    band->moving = 0;
+
+    /* a single stage, nothing to keep in cache between stages */
+    if (!obj->motionDetect && (obj->chromaFormat == XDM_GRAY) &&
+        !obj->lumaStats) {
+        convertLines(obj, pGray, obj->outPitch, band->first, band->lines);
+        return;
+    }
+
+    if (obj->lumaStats) {
+        memset(band->hist, 0, sizeof(band->hist));
+    }
+
+    /* the chroma and histogram of each block row right after its luma */
+    if (!obj->motionDetect) {
+        for (y = band->first; y < end; y += IVIDDECCOPY_BLOCKSIZE) {
+            lines = end - y;
+            lines = (lines < IVIDDECCOPY_BLOCKSIZE) ? lines :
+                IVIDDECCOPY_BLOCKSIZE;
+
+            convertLines(obj, pGray, obj->outPitch, y, lines);
+            if (obj->chromaFormat != XDM_GRAY) {
+                convertChroma(obj, y, lines);
+            }
+            if (obj->lumaStats) {
+                VIDENCCOPY_TI_C_HISTOGRAM(band->hist, pGray, obj->outPitch,
+                    lines, obj->width);
+            }
+            pGray += lines * obj->outPitch;
+        }
+        return;
+    }
+
+    for (y = band->first; y < end; y += IVIDDECCOPY_BLOCKSIZE) {
+        lines = end - y;
+        lines = (lines < IVIDDECCOPY_BLOCKSIZE) ? lines : IVIDDECCOPY_BLOCKSIZE;
+
+        convertLines(obj, pStrip, obj->width, y, lines);
+        if (obj->chromaFormat != XDM_GRAY) {
+            convertChroma(obj, y, lines);
+        }
+        if (obj->lumaStats) {
+            VIDENCCOPY_TI_C_HISTOGRAM(band->hist, pStrip, obj->width, lines,
+                obj->width);
+        }
+
+        if (obj->prevValid) {
+            totalSad += VIDENCCOPY_TI_diff(obj, pPrev, pStrip, obj->width,
+                lines, blockSad, (map != NULL) ?
+                map + (y / IVIDDECCOPY_BLOCKSIZE) * blocksX : NULL, &moving);
+        }
+        else {
+            memcpy(pPrev, pStrip, lines * obj->width);
+        }
+
+        /* the strip is done, write it out */
+        if (obj->outPitch == obj->width) {
+            memcpy(pGray, pStrip, lines * obj->width);
+        }
+        else {
+            for (i = 0; i < lines; i++) {
+                memcpy(pGray + i * obj->outPitch, pStrip + i * obj->width,
+                    obj->width);
+            }
+        }
+
+        pGray += lines * obj->outPitch;
+        pPrev += lines * obj->width;
+    }
+
+    /* only now, the bands of the other threads are next to this one */
+    band->totalSad = totalSad;
+    band->moving = moving;
+}
+
+
+/*
+ *  ======== splitBands ========
+ *  Cut the frame into at most numThreads bands of whole block rows, each
+ *  starting on a cache line of every output plane so no two threads
+ *  write to the same line.  Returns the number of bands.
+ */
+static XDAS_Int32 splitBands(VIDDECCOPY_TI_Obj *obj)
+{
+    /* a chroma plane has a half or a quarter of the luma bytes per line */
+    XDAS_Int32 unit = (obj->chromaFormat == XDM_YUV_420P) ? 4 * CACHELINE :
+        (obj->chromaFormat == XDM_YUV_420SP) ? 2 * CACHELINE : CACHELINE;
+    XDAS_Int32 pitch = obj->outPitch;
+    XDAS_Int32 units;
+    XDAS_Int32 bands;
+    XDAS_Int32 b, t;
+
+    /* lines per unit: a multiple of the block size whose bytes fill lines */
+    while ((unit > 1) && ((pitch % 2) == 0)) {
+        unit /= 2;
+        pitch /= 2;
+    }
+    unit = (unit < IVIDDECCOPY_BLOCKSIZE) ? IVIDDECCOPY_BLOCKSIZE : unit;
+
+    units = (obj->height + unit - 1) / unit;
+    bands = (units < obj->numThreads) ? units : obj->numThreads;
+
+    for (b = 0, t = 0; b < bands; b++) {
+        obj->band[b].index = b;
+        obj->band[b].first = t * unit;
+        t = units * (b + 1) / bands;
+        obj->band[b].lines = ((t * unit < obj->height) ? t * unit :
+            obj->height) - obj->band[b].first;
+    }
+
+    return (bands);
+}
+
+
+#ifndef _TI_
+/*
+ *  ======== bandThread ========
+ *  Worker i of an instance converts band i of each frame process()
+ *  hands out, if the frame has that many bands.
+ */
+static Void *bandThread(Void *arg)
+{
+    VIDDECCOPY_TI_Band *band = (VIDDECCOPY_TI_Band *)arg;
+    VIDDECCOPY_TI_Obj *obj = band->obj;
+    XDAS_UInt32 seen = 0;
+
+    pthread_mutex_lock(&obj->lock);
+
+    for (;;) {
+        while (!obj->quit && (obj->generation == seen)) {
+            pthread_cond_wait(&obj->start, &obj->lock);
+        }
+        if (obj->quit) {
+            break;
+        }
+        seen = obj->generation;
+
+        if (band->index < obj->numBands) {
+            pthread_mutex_unlock(&obj->lock);
+            convertBand(obj, band);
+            pthread_mutex_lock(&obj->lock);
+
+            if (--obj->pending == 0) {
+                pthread_cond_signal(&obj->done);
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&obj->lock);
+
+    return (NULL);
+}
+
+
+/*
+ *  ======== startThreads ========
+ *  Start the band workers of a new instance.  An instance that can't
+ *  get all of them makes do with the ones it got.
+ */
+static Void startThreads(VIDDECCOPY_TI_Obj *obj)
+{
+    XDAS_Int32 i;
+
+    pthread_mutex_init(&obj->lock, NULL);
+    pthread_cond_init(&obj->start, NULL);
+    pthread_cond_init(&obj->done, NULL);
+    obj->generation = 0;
+    obj->pending = 0;
+    obj->quit = XDAS_FALSE;
+
+    for (i = 1; i < obj->numThreads; i++) {
+        obj->band[i].obj = obj;
+        obj->band[i].index = i;
+        if (pthread_create(&obj->band[i].thread, NULL, bandThread,
+            &obj->band[i]) != 0) {
+
+            GT_2trace(obj->trace, GT_7CLASS, "VIDDECCOPY_TI_initObj> only "
+                "%d of %d band threads\n", i, obj->numThreads);
+            break;
+        }
+    }
+
+    obj->numThreads = i;
+}
+
+
+/*
+ *  ======== stopThreads ========
+ */
+static Void stopThreads(VIDDECCOPY_TI_Obj *obj)
+{
+    XDAS_Int32 i;
+
+    pthread_mutex_lock(&obj->lock);
+    obj->quit = XDAS_TRUE;
+    pthread_cond_broadcast(&obj->start);
+    pthread_mutex_unlock(&obj->lock);
+
+    for (i = 1; i < obj->numThreads; i++) {
+        pthread_join(obj->band[i].thread, NULL);
+    }
+
+    pthread_cond_destroy(&obj->done);
+    pthread_cond_destroy(&obj->start);
+    pthread_mutex_destroy(&obj->lock);
+}
+#endif
+
+
+/*
+ *  ======== convertFrame ========
+ *  Convert one frame into the output planes pOut, in bands on the
+ *  instance's threads if it has any.  Returns once every band is done.
+ */
+static XDAS_UInt32 convertFrame(VIDDECCOPY_TI_Obj *obj, XDAS_UInt8 **pOut,
+    XDAS_UInt8 *pYUV422, XDAS_UInt8 *map, XDAS_Int32 *moving)
+{
+    XDAS_UInt32 totalSad = 0;
+    XDAS_Int32 b;
+
+    obj->pGray = pOut[0];
+    obj->pU = (obj->chromaFormat != XDM_GRAY) ? pOut[1] : NULL;
+    obj->pV = (obj->chromaFormat == XDM_YUV_420P) ? pOut[2] : NULL;
+    obj->pYUV422 = pYUV422;
+    obj->pMap = map;
+
+    obj->numBands = splitBands(obj);
+
+#ifndef _TI_
+    if (obj->numBands > 1) {
+        pthread_mutex_lock(&obj->lock);
+        obj->pending = obj->numBands - 1;
+        obj->generation++;
+        pthread_cond_broadcast(&obj->start);
+        pthread_mutex_unlock(&obj->lock);
+
+        convertBand(obj, &obj->band[0]);
+
+        pthread_mutex_lock(&obj->lock);
+        while (obj->pending > 0) {
+            pthread_cond_wait(&obj->done, &obj->lock);
+        }
+        pthread_mutex_unlock(&obj->lock);
+    }
+    else
+#endif
     {
-        pGray[i] = pYUV422[i * 2];
+        convertBand(obj, &obj->band[0]);
+    }
+
+    *moving = 0;
+    for (b = 0; b < obj->numBands; b++) {
+        totalSad += obj->band[b].totalSad;
+        *moving += obj->band[b].moving;
+    }
+
+    if (obj->motionDetect) {
+        obj->prevValid = XDAS_TRUE;
+    }
+
+    return (totalSad);
+}
+
+
+/*
+ *  ======== deltaFrame ========
+ *  Convert one frame into a delta record at pOut and return its total
+ *  SAD.  Each block row is converted into the strip buffer and compared
+ *  there with a copy of the previous frame's row.  Only the blocks that
+ *  changed by more than deltaThreshold go into the record and into the
+ *  previous frame, which so stays the image a reader of the records has
+ *  rebuilt and slow changes still add up to a block being sent.
+ */
+static XDAS_UInt32 deltaFrame(VIDDECCOPY_TI_Obj *obj, XDAS_UInt8 *pOut,
+    XDAS_UInt8 *pYUV422, XDAS_Int32 id, XDAS_UInt8 *map, XDAS_Int32 *moving)
+{
+    IVIDDECCOPY_DeltaHeader *hdr = (IVIDDECCOPY_DeltaHeader *)pOut;
+    XDAS_UInt32 blockSad[IVIDDECCOPY_MAXWIDTH / IVIDDECCOPY_BLOCKSIZE];
+    XDAS_Int32 blocksX = IVIDDECCOPY_BLOCKS(obj->width);
+    XDAS_UInt8 *bitmap = pOut + sizeof(*hdr);
+    XDAS_UInt8 *pTile = bitmap +
+        IVIDDECCOPY_BITMAPSIZE(obj->width, obj->height);
+    XDAS_UInt8 *pCur = obj->pStrip;
+    XDAS_UInt8 *pSaved = obj->pStrip + IVIDDECCOPY_BLOCKSIZE * obj->width;
+    XDAS_UInt8 *pPrev = obj->pPrev;
+    XDAS_UInt32 totalSad = 0;
+    XDAS_Int32 keyFrame;
+    XDAS_Int32 numBlocks = 0;
+    XDAS_Int32 lines;
+    XDAS_Int32 width;
+    XDAS_Int32 x, y;
+    XDAS_Int32 b, i;
+
+    obj->pYUV422 = pYUV422;
+
+    /* on this thread alone, its statistics are those of band 0 */
+    obj->numBands = 1;
+    if (obj->lumaStats) {
+        memset(obj->band[0].hist, 0, sizeof(obj->band[0].hist));
+    }
+
+    keyFrame = !obj->prevValid ||
+        ((obj->keyInterval > 0) && (obj->sinceKey >= obj->keyInterval));
+
+    *moving = 0;
+    memset(bitmap, 0, pTile - bitmap);
+
+    for (y = 0; y < obj->height; y += IVIDDECCOPY_BLOCKSIZE) {
+        lines = obj->height - y;
+        lines = (lines < IVIDDECCOPY_BLOCKSIZE) ? lines : IVIDDECCOPY_BLOCKSIZE;
+
+        convertLines(obj, pCur, obj->width, y, lines);
+        if (obj->lumaStats) {
+            VIDENCCOPY_TI_C_HISTOGRAM(obj->band[0].hist, pCur, obj->width,
+                lines, obj->width);
+        }
+
+        /* compare with a copy, the previous frame only takes sent blocks */
+        if (obj->prevValid) {
+            memcpy(pSaved, pPrev, lines * obj->width);
+            totalSad += VIDENCCOPY_TI_diff(obj, pSaved, pCur, obj->width,
+                lines, blockSad, (map != NULL) ?
+                map + (y / IVIDDECCOPY_BLOCKSIZE) * blocksX : NULL, moving);
+        }
+
+        if (keyFrame) {
+            memcpy(pPrev, pCur, lines * obj->width);
+        }
+
+        for (b = 0, x = 0; b < blocksX; b++, x += IVIDDECCOPY_BLOCKSIZE) {
+            width = obj->width - x;
+            width = (width < IVIDDECCOPY_BLOCKSIZE) ? width :
+                IVIDDECCOPY_BLOCKSIZE;
+
+            if (!keyFrame && (blockSad[b] <=
+                (XDAS_UInt32)(obj->deltaThreshold * width * lines))) {
+                continue;
+            }
+
+            numBlocks++;
+            i = (y / IVIDDECCOPY_BLOCKSIZE) * blocksX + b;
+            bitmap[i >> 3] |= 1 << (i & 7);
+
+            for (i = 0; i < lines; i++) {
+                memcpy(pTile, pCur + i * obj->width + x, width);
+                if (!keyFrame) {
+                    memcpy(pPrev + i * obj->width + x, pTile, width);
+                }
+                pTile += width;
+            }
+        }
+
+        pPrev += lines * obj->width;
+    }
+
+    hdr->magic = IVIDDECCOPY_DELTAMAGIC;
+    hdr->size = pTile - pOut;
+    hdr->frameId = id;
+    hdr->keyFrame = keyFrame;
+    hdr->width = obj->width;
+    hdr->height = obj->height;
+    hdr->blockSize = IVIDDECCOPY_BLOCKSIZE;
+    hdr->numBlocks = numBlocks;
+
+    obj->sinceKey = keyFrame ? 1 : obj->sinceKey + 1;
+    obj->prevValid = XDAS_TRUE;
+
+    return (totalSad);
+}
+
+
+/*
+ *  ======== sumStats ========
+ *  Add up the sub-histograms of the bands of the last frame converted
+ *  into ext, and derive the other statistics from the histogram rather
+ *  than from the pixels.
+ */
+static Void sumStats(VIDDECCOPY_TI_Obj *obj, IVIDDECCOPY_OutArgs *ext)
+{
+    XDAS_UInt32 *hist;
+    XDAS_UInt32 pixels = 0;
+    XDAS_UInt32 sum = 0;
+    XDAS_UInt32 n;
+    XDAS_Int32 b, i;
+
+    ext->lumaMin = -1;
+    ext->lumaMax = 0;
+
+    for (i = 0; i < IVIDDECCOPY_HISTBINS; i++) {
+        n = 0;
+        for (b = 0; b < obj->numBands; b++) {
+            hist = obj->band[b].hist + i;
+            n += hist[0] + hist[IVIDDECCOPY_HISTBINS] +
+                hist[2 * IVIDDECCOPY_HISTBINS] +
+                hist[3 * IVIDDECCOPY_HISTBINS];
+        }
+
+        ext->histogram[i] = n;
+        if (n != 0) {
+            ext->lumaMin = (ext->lumaMin < 0) ? i : ext->lumaMin;
+            ext->lumaMax = i;
+        }
+        pixels += n;
+        sum += n * i;
     }
 
-    return 0;
+    ext->lumaSum = sum;
+    ext->lumaMean = (sum + pixels / 2) / pixels;
 }
 
 
@@ -201,62 +1166,168 @@ XDAS_Int32 VIDDECCOPY_TI_process(IVIDDEC_Handle h, XDM_BufDesc *inBufs,
     XDM_BufDesc *outBufs, IVIDDEC_InArgs *inArgs, IVIDDEC_OutArgs *outArgs)
 {
 
-    // VIDDECCOPY_TI_Obj *VIDENC_COPY = (VIDDECCOPY_TI_Obj *)h;
+    VIDDECCOPY_TI_Obj *obj = (VIDDECCOPY_TI_Obj *)h;
+    IVIDDECCOPY_OutArgs *ext = NULL;
 
     XDAS_Int32 curBuf;
-    XDAS_Int32 minSamples;
-
-    // GT_5trace(curTrace, GT_ENTER, "VIDDECCOPY_TI_process(0x%lx, 0x%lx, 0x%lx, "
+    XDAS_Int32 inSize = INFRAMESIZE(obj);
+    XDAS_Int32 outSize = OUTFRAMESIZE(obj);
+    XDAS_Int32 uvSize = UVPLANESIZE(obj);
+    XDAS_Int32 planes = NUMPLANES(obj);
+    XDAS_UInt8 *pOut[3];
+    XDAS_Int32 p;
+    XDAS_Int32 motionValid = XDAS_FALSE;
+    XDAS_Int32 statsValid = XDAS_FALSE;
+    XDAS_Int32 moving = 0;
+    XDAS_UInt32 totalSad = 0;
+    XDAS_Int32 outputBytes = 0;
+    XDAS_Int32 frameType = IVIDEO_I_FRAME;
+    XDAS_Int32 numFrames;
+    XDAS_Int32 lastFrame = 0;
+    XDAS_Int32 retVal = IVIDDEC_EOK;
+    XDAS_UInt32 start = NOW();
+    XDAS_UInt32 elapsed;
+
+    // GT_5trace(obj->trace, GT_ENTER, "VIDDECCOPY_TI_process(0x%lx, 0x%lx, 0x%lx, "
     //     "0x%lx, 0x%lx)\n", h, inBufs, outBufs, inArgs, outArgs);
 
-    /* validate arguments - this codec only supports "base" xDM. */
+    /* validate arguments - base inArgs, base or IVIDDECCOPY outArgs */
     if ((inArgs->size != sizeof(*inArgs)) ||
-        (outArgs->size != sizeof(*outArgs))) {
+        ((outArgs->size != sizeof(*outArgs)) &&
+         (outArgs->size != sizeof(IVIDDECCOPY_OutArgs)))) {
 
-        GT_2trace(curTrace, GT_ENTER, "VIDDECCOPY_TI_process, unsupported size "
+        GT_2trace(obj->trace, GT_ENTER, "VIDDECCOPY_TI_process, unsupported size "
             "(0x%lx, 0x%lx)\n", inArgs->size, outArgs->size);
 
         return (IVIDDEC_EFAIL);
     }
 
+    if (outArgs->size == sizeof(IVIDDECCOPY_OutArgs)) {
+        ext = (IVIDDECCOPY_OutArgs *)outArgs;
+    }
+
     /* outArgs->bytesConsumed reports the total number of bytes consumed */
     outArgs->bytesConsumed = 0;
+    outArgs->extendedError = 0;
 
     /*
      * A couple constraints for this simple "copy" codec:
-     *    - Given a different number of input and output buffers, only
-     *      decode (i.e., copy) the lesser number of buffers.
-     *    - Given a different size of an input and output buffers, only
-     *      decode (i.e., copy) the lesser of the sizes.
+     *    - Each input buffer and the next output buffer, or the next one
+     *      for each plane of a color format, are one frame; the call
+     *      decodes as many frames as there are buffers for; frame i
+     *      has the id inArgs->inputID + i.
+     *    - Every buffer must hold a whole frame of the geometry set with
+     *      XDM_SETPARAMS; only the region of interest is read, the rest
+     *      and the padding up to the pitch are skipped.  A frame whose
+     *      buffers are too small fails on its own, the others are still
+     *      decoded.
+     *    - Each frame is compared with the one before it, the motion
+     *      result returned is the one of the last frame decoded.
      */
-
-    for (curBuf = 0; (curBuf < inBufs->numBufs) &&
-        (curBuf < outBufs->numBufs); curBuf++) {
-
-        /* there's an available in and out buffer, how many samples? */
-        minSamples = inBufs->bufSizes[curBuf] < outBufs->bufSizes[curBuf] ?
-            inBufs->bufSizes[curBuf] : outBufs->bufSizes[curBuf];
+    numFrames = (inBufs->numBufs < outBufs->numBufs / planes) ?
+        inBufs->numBufs : outBufs->numBufs / planes;
+    numFrames = (numFrames < XDM_MAX_IO_BUFFERS) ?
+        numFrames : XDM_MAX_IO_BUFFERS;
+
+    for (curBuf = 0; curBuf < numFrames; curBuf++) {
+
+        if (ext != NULL) {
+            ext->frameError[curBuf] = 0;
+            ext->frameBytes[curBuf] = 0;
+        }
+
+        for (p = 0; p < planes; p++) {
+            pOut[p] = (XDAS_UInt8 *)outBufs->bufs[curBuf * planes + p];
+            if (outBufs->bufSizes[curBuf * planes + p] <
+                ((p == 0) ? outSize : uvSize)) {
+                break;
+            }
+        }
+
+        if ((inBufs->bufSizes[curBuf] < inSize) || (p < planes)) {
+
+            GT_3trace(obj->trace, GT_7CLASS, "VIDDECCOPY_TI_process> frame %d "
+                "buffers too small (in %d, out plane %d)\n", curBuf,
+                inBufs->bufSizes[curBuf], p);
+
+            XDM_SETINSUFFICIENTDATA(outArgs->extendedError);
+            if (ext != NULL) {
+                XDM_SETINSUFFICIENTDATA(ext->frameError[curBuf]);
+            }
+
+            obj->failedFrames++;
+            retVal = IVIDDEC_EFAIL;
+            continue;
+        }
 
         /* process the data: read input, produce output */
-        VIDENCCOPY_TI_YUV422_C_GRAY((XDAS_UInt8*)outBufs->bufs[curBuf], 
-            (XDAS_UInt8*)inBufs->bufs[curBuf], HEIGHT, WIDTH);
-        // memcpy(outBufs->bufs[curBuf], inBufs->bufs[curBuf], minSamples);
+        motionValid = obj->motionDetect && obj->prevValid;
+
+        if (obj->outputMode == IVIDDECCOPY_DELTA) {
+            totalSad = deltaFrame(obj, pOut[0],
+                (XDAS_UInt8*)inBufs->bufs[curBuf], inArgs->inputID + curBuf,
+                (ext != NULL) ? ext->motionMap : NULL, &moving);
+
+            outputBytes = ((IVIDDECCOPY_DeltaHeader *)
+                outBufs->bufs[curBuf])->size;
+            frameType = ((IVIDDECCOPY_DeltaHeader *)
+                outBufs->bufs[curBuf])->keyFrame ?
+                IVIDEO_I_FRAME : IVIDEO_P_FRAME;
+        }
+        else {
+            totalSad = convertFrame(obj, pOut,
+                (XDAS_UInt8*)inBufs->bufs[curBuf],
+                (ext != NULL) ? ext->motionMap : NULL, &moving);
+
+            outputBytes = outSize + (planes - 1) * uvSize;
+        }
 
         // VIDENCCOPY_TI_YUV422_C_GRAY(((VIDDECCOPY_TI_Obj *)h)->pGray, 
         //     (XDAS_UInt8*)inBufs->bufs[curBuf], HEIGHT, WIDTH);
         // memcpy(outBufs->bufs[curBuf], ((VIDDECCOPY_TI_Obj *)h)->pGray, minSamples);
-        // GT_1trace( curTrace, GT_2CLASS, "VIDDECCOPY_TI_process> "
+        // GT_1trace( obj->trace, GT_2CLASS, "VIDDECCOPY_TI_process> "
         //        "Processed %d bytes.\n", minSamples );
-        outArgs->bytesConsumed += minSamples;
+        outArgs->bytesConsumed += inSize;
+        lastFrame = curBuf;
+        statsValid = obj->lumaStats;
+
+        obj->frames++;
+        count64(obj->bytesIn, inSize);
+        count64(obj->bytesOut, outputBytes);
+
+        if (ext != NULL) {
+            ext->frameBytes[curBuf] = outputBytes;
+        }
     }
 
     /* Fill out the rest of the outArgs struct */
-    outArgs->extendedError = 0;
-    outArgs->decodedFrameType = 0;     /* TODO */
-    outArgs->outputID = inArgs->inputID;
+    outArgs->decodedFrameType = frameType;
+    outArgs->outputID = inArgs->inputID + lastFrame;
     outArgs->displayBufs.numBufs = 0;  /* important: indicate no displayBufs */
 
-    return (IVIDDEC_EOK);
+    if (ext != NULL) {
+        ext->motionValid = motionValid;
+        ext->blocksX = IVIDDECCOPY_BLOCKS(obj->width);
+        ext->blocksY = IVIDDECCOPY_BLOCKS(obj->height);
+        ext->motionScore = motionValid ?
+            moving * 1000 / (ext->blocksX * ext->blocksY) : 0;
+        ext->totalSad = totalSad;
+        ext->outputBytes = outputBytes;
+        ext->numFrames = numFrames;
+        ext->statsValid = statsValid;
+        if (statsValid) {
+            sumStats(obj, ext);
+        }
+    }
+
+    elapsed = NOW() - start;
+    obj->calls++;
+    count64(obj->totalTime, elapsed);
+    if (elapsed > obj->maxTime) {
+        obj->maxTime = elapsed;
+    }
+
+    return (retVal);
 }
 
 
@@ -266,46 +1337,115 @@ XDAS_Int32 VIDDECCOPY_TI_process(IVIDDEC_Handle h, XDM_BufDesc *inBufs,
 XDAS_Int32 VIDDECCOPY_TI_control(IVIDDEC_Handle handle, IVIDDEC_Cmd id,
     IVIDDEC_DynamicParams *params, IVIDDEC_Status *status)
 {
+    VIDDECCOPY_TI_Obj *obj = (VIDDECCOPY_TI_Obj *)handle;
     XDAS_Int32 retVal;
+    XDAS_Int32 p;
 
-    GT_4trace(curTrace, GT_ENTER, "VIDDECCOPY_TI_control(0x%lx, 0x%lx, 0x%lx, "
+    GT_4trace(obj->trace, GT_ENTER, "VIDDECCOPY_TI_control(0x%lx, 0x%lx, 0x%lx, "
         "0x%lx)\n", handle, id, params, status);
 
-    /* validate arguments - this codec only supports "base" xDM. */
-    if ((params->size != sizeof(*params)) ||
-        (status->size != sizeof(*status))) {
+    /* validate arguments - base or IVIDDECCOPY extended structs */
+    if (((params->size != sizeof(IVIDDEC_DynamicParams)) &&
+         (params->size != sizeof(IVIDDECCOPY_DynamicParams))) ||
+        ((status->size != sizeof(IVIDDEC_Status)) &&
+         (status->size != sizeof(IVIDDECCOPY_Status)))) {
 
-        GT_2trace(curTrace, GT_ENTER, "VIDDECCOPY_TI_control, unsupported size "
+        GT_2trace(obj->trace, GT_ENTER, "VIDDECCOPY_TI_control, unsupported size "
             "(0x%lx, 0x%lx)\n", params->size, status->size);
 
         return (IVIDDEC_EFAIL);
     }
 
+    status->extendedError = 0;
+
     switch (id) {
         case XDM_GETSTATUS:
-            status->extendedError = 0;
-            status->outputHeight = 0;  /* TODO */
-            status->outputWidth = 0;  /* TODO */
-            status->frameRate = 0;  /* TODO */
-            status->bitRate = 0;  /* TODO */
-            status->contentType = 0;  /* TODO */
-            status->outputChromaFormat = 0;  /* TODO */
+            status->outputHeight = obj->height;
+            status->outputWidth = obj->width;
+            status->frameRate = 0;  /* not known to the codec */
+            status->bitRate = 0;
+            status->contentType = IVIDEO_PROGRESSIVE;
+            status->outputChromaFormat = obj->chromaFormat;
+
+            if (status->size == sizeof(IVIDDECCOPY_Status)) {
+                IVIDDECCOPY_Status *ext = (IVIDDECCOPY_Status *)status;
+
+                ext->inPitch = obj->inPitch;
+                ext->outPitch = obj->outPitch;
+                ext->motionDetect = obj->motionDetect;
+                ext->motionThreshold = obj->motionThreshold;
+                ext->outputMode = obj->outputMode;
+                ext->keyInterval = obj->keyInterval;
+                ext->deltaThreshold = obj->deltaThreshold;
+                ext->inputWidth = obj->inWidth;
+                ext->inputHeight = obj->inHeight;
+                ext->cropX = obj->roi.x;
+                ext->cropY = obj->roi.y;
+                ext->cropWidth = obj->roi.width;
+                ext->cropHeight = obj->roi.height;
+                ext->scaleFactor = obj->roi.factor;
+                ext->lumaStats = obj->lumaStats;
+
+                ext->calls = obj->calls;
+                ext->frames = obj->frames;
+                ext->failedFrames = obj->failedFrames;
+                ext->bytesInHi = obj->bytesIn[1];
+                ext->bytesInLo = obj->bytesIn[0];
+                ext->bytesOutHi = obj->bytesOut[1];
+                ext->bytesOutLo = obj->bytesOut[0];
+                ext->timeUnit = TIMEUNIT;
+                ext->totalTimeHi = obj->totalTime[1];
+                ext->totalTimeLo = obj->totalTime[0];
+                ext->maxTime = obj->maxTime;
+                ext->numThreads = obj->numThreads;
+                copyName(ext->grayKernel, obj->grayName);
+                copyName(ext->sadKernel, obj->sadName);
+                copyName(ext->chromaKernel, obj->chromaName);
+            }
 
             /* Note, intentionally no break here so we fill in bufInfo, too */
 
         case XDM_GETBUFINFO:
             status->bufInfo.minNumInBufs = MININBUFS;
-            status->bufInfo.minNumOutBufs = MINOUTBUFS;
-            status->bufInfo.minInBufSize[0] = MININBUFSIZE;
-            status->bufInfo.minOutBufSize[0] = MINOUTBUFSIZE;
+            status->bufInfo.minNumOutBufs = MINOUTBUFS * NUMPLANES(obj);
+            status->bufInfo.minInBufSize[0] = INFRAMESIZE(obj);
+            status->bufInfo.minOutBufSize[0] = OUTFRAMESIZE(obj);
+            for (p = 1; p < NUMPLANES(obj); p++) {
+                status->bufInfo.minOutBufSize[p] = UVPLANESIZE(obj);
+            }
 
             retVal = IVIDDEC_EOK;
 
             break;
 
         case XDM_SETPARAMS:
+            retVal = setParams(obj, params);
+            if (retVal != IVIDDEC_EOK) {
+                XDM_SETUNSUPPORTEDPARAM(status->extendedError);
+            }
+            break;
+
         case XDM_SETDEFAULT:
+            obj->chromaFormat = XDM_GRAY;
+            obj->lumaStats = XDAS_FALSE;
+            setGeometry(obj, WIDTH, HEIGHT, 0, 0, NULL);
+            obj->motionDetect = XDAS_FALSE;
+            obj->motionThreshold = MOTIONTHRESHOLD;
+            obj->outputMode = IVIDDECCOPY_FULL;
+            obj->keyInterval = KEYINTERVAL;
+            obj->deltaThreshold = 0;
+
+            retVal = IVIDDEC_EOK;
+            break;
+
         case XDM_RESET:
+            /* the next frame starts a new sequence, with a keyframe */
+            obj->prevValid = XDAS_FALSE;
+            resetCounters(obj);
+
+            retVal = IVIDDEC_EOK;
+            break;
+
         case XDM_FLUSH:
             /* TODO - for now just return success. */
 
@@ -0,0 +1,842 @@
+/*
+ * Copyright (c) 2010, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+/*
+ *  ======== viddec_copy_kernels.c ========
+ *  C reference and SIMD implementations of the VIDDECCOPY pixel kernels.
+ *
+ *  The SIMD variants are compiled with per-function target attributes, so
+ *  this file builds with the toolchain's baseline flags and the variant
+ *  is chosen at runtime.  Define VIDENCCOPY_TI_NOSIMD to build the C
+ *  kernels only.  The DSP build (_TI_) always uses the C kernels.
+ */
+#include <xdc/std.h>
+
+#include "viddec_copy_kernels.h"
+
+#if !defined(_TI_) && !defined(VIDENCCOPY_TI_NOSIMD) && defined(__GNUC__)
+#if defined(__x86_64__) || defined(__i386__)
+#define VIDENCCOPY_TI_X86
+#include <immintrin.h>
+#define TARGET(isa) __attribute__((target(isa)))
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VIDENCCOPY_TI_ARMNEON
+#include <arm_neon.h>
+#if !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+#endif
+
+
+/*
+ *  ======== VIDENCCOPY_TI_YUV422_C_GRAY ========
+ *  Reference implementation: Y is every even byte of YUYV.
+ */
+Int VIDENCCOPY_TI_YUV422_C_GRAY(XDAS_UInt8* pGray, XDAS_UInt8* pYUV422,
+    XDAS_Int32 height, XDAS_Int32 width)
+{
+
+    XDAS_Int32 frames = height * width;
+
+    int i;
+    for (i = 0; i < frames; ++i)
+    {
+        pGray[i] = pYUV422[i * 2];
+    }
+
+    return 0;
+}
+
+
+/*
+ *  ======== VIDENCCOPY_TI_YUV422_C_GRAY_BOX ========
+ *  One line of a gray image scaled down by factor: the rounded mean of
+ *  the luma of factor x factor pixels, from factor YUYV lines pitch bytes
+ *  apart.  Only factor * width pixels of each line are read.
+ */
+Int VIDENCCOPY_TI_YUV422_C_GRAY_BOX(XDAS_UInt8 *pGray, XDAS_UInt8 *pYUV422,
+    XDAS_Int32 pitch, XDAS_Int32 width, XDAS_Int32 factor)
+{
+    XDAS_UInt8 *p0 = pYUV422;
+    XDAS_UInt8 *p1 = pYUV422 + pitch;
+    XDAS_UInt32 sum;
+    XDAS_Int32 x, i, j;
+
+    if (factor == 2) {
+        for (x = 0; x < width; x++) {
+            pGray[x] = (XDAS_UInt8)((p0[4 * x] + p0[4 * x + 2] +
+                p1[4 * x] + p1[4 * x + 2] + 2) >> 2);
+        }
+
+        return 0;
+    }
+
+    for (x = 0; x < width; x++) {
+        sum = factor * factor / 2;
+        for (j = 0; j < factor; j++) {
+            p0 = pYUV422 + j * pitch + 2 * factor * x;
+            for (i = 0; i < factor; i++) {
+                sum += p0[2 * i];
+            }
+        }
+        pGray[x] = (XDAS_UInt8)(sum / (factor * factor));
+    }
+
+    return 0;
+}
+
+
+/*
+ *  ======== VIDENCCOPY_TI_YUV422_C_GRAY_LINEAR ========
+ *  One line of a gray image scaled from srcWidth pixels to width with a
+ *  bilinear filter, between the YUYV lines pLine0 and pLine1 with pLine1
+ *  weighing wy / 256.  Output pixel x is centred on input pixel
+ *  (x + 1/2) * stepX - 1/2, stepX in 16.16 fixed point; no pixel beyond
+ *  srcWidth is read.
+ */
+Int VIDENCCOPY_TI_YUV422_C_GRAY_LINEAR(XDAS_UInt8 *pGray, XDAS_UInt8 *pLine0,
+    XDAS_UInt8 *pLine1, XDAS_Int32 wy, XDAS_Int32 width,
+    XDAS_Int32 srcWidth, XDAS_Int32 stepX)
+{
+    XDAS_Int32 pos = (stepX - 0x10000) / 2;
+    XDAS_Int32 x, ix, ix1, fx;
+    XDAS_UInt32 top, bottom;
+
+    for (x = 0; x < width; x++, pos += stepX) {
+        ix = (pos < 0) ? 0 : pos >> 16;
+        fx = (pos < 0) ? 0 : (pos >> 8) & 0xff;
+        ix1 = (ix + 1 < srcWidth) ? ix + 1 : ix;
+
+        top = pLine0[2 * ix] * (256 - fx) + pLine0[2 * ix1] * fx;
+        bottom = pLine1[2 * ix] * (256 - fx) + pLine1[2 * ix1] * fx;
+
+        pGray[x] = (XDAS_UInt8)((top * (256 - wy) + bottom * wy + 0x8000) >>
+            16);
+    }
+
+    return 0;
+}
+
+
+/*
+ *  ======== VIDENCCOPY_TI_C_HISTOGRAM ========
+ *  Consecutive pixels go to different sub-histograms, so a run of equal
+ *  pixels doesn't make each increment wait for the store of the one
+ *  before it to the same bin.  The caller adds the four up.
+ */
+Int VIDENCCOPY_TI_C_HISTOGRAM(XDAS_UInt32 *hist, XDAS_UInt8 *pGray,
+    XDAS_Int32 pitch, XDAS_Int32 lines, XDAS_Int32 width)
+{
+    XDAS_UInt32 *h0 = hist;
+    XDAS_UInt32 *h1 = hist + 256;
+    XDAS_UInt32 *h2 = hist + 512;
+    XDAS_UInt32 *h3 = hist + 768;
+    XDAS_Int32 x;
+    XDAS_Int32 y;
+
+    for (y = 0; y < lines; y++) {
+        for (x = 0; x + 4 <= width; x += 4) {
+            h0[pGray[x]]++;
+            h1[pGray[x + 1]]++;
+            h2[pGray[x + 2]]++;
+            h3[pGray[x + 3]]++;
+        }
+        for (; x < width; x++) {
+            h0[pGray[x]]++;
+        }
+        pGray += pitch;
+    }
+
+    return 0;
+}
+
+
+/*
+ *  ======== nv12Columns ========
+ *  C chroma of NV12 from pixel x0 (even) up to width; the whole
+ *  reference, and the tail of the SIMD variants.  The chroma bytes of
+ *  YUYV are already in NV12 order, U V U V, one pair per two pixels.
+ */
+static Int nv12Columns(XDAS_UInt8 *pUV, XDAS_UInt8 *pLine0,
+    XDAS_UInt8 *pLine1, XDAS_Int32 x0, XDAS_Int32 width)
+{
+    XDAS_Int32 x;
+
+    for (x = x0; x < width; x++) {
+        pUV[x] = (XDAS_UInt8)((pLine0[2 * x + 1] + pLine1[2 * x + 1] + 1) >>
+            1);
+    }
+
+    return 0;
+}
+
+/*
+ *  ======== i420Columns ========
+ *  C chroma of I420 from pixel x0 (even) up to width.
+ */
+static Int i420Columns(XDAS_UInt8 *pU, XDAS_UInt8 *pV, XDAS_UInt8 *pLine0,
+    XDAS_UInt8 *pLine1, XDAS_Int32 x0, XDAS_Int32 width)
+{
+    XDAS_Int32 x;
+
+    for (x = x0; x < width; x += 2) {
+        pU[x / 2] = (XDAS_UInt8)((pLine0[2 * x + 1] + pLine1[2 * x + 1] +
+            1) >> 1);
+        pV[x / 2] = (XDAS_UInt8)((pLine0[2 * x + 3] + pLine1[2 * x + 3] +
+            1) >> 1);
+    }
+
+    return 0;
+}
+
+/*
+ *  ======== VIDENCCOPY_TI_YUV422_C_NV12 ========
+ */
+Int VIDENCCOPY_TI_YUV422_C_NV12(XDAS_UInt8 *pUV, XDAS_UInt8 *pLine0,
+    XDAS_UInt8 *pLine1, XDAS_Int32 width)
+{
+    return (nv12Columns(pUV, pLine0, pLine1, 0, width));
+}
+
+/*
+ *  ======== VIDENCCOPY_TI_YUV422_C_I420 ========
+ */
+Int VIDENCCOPY_TI_YUV422_C_I420(XDAS_UInt8 *pU, XDAS_UInt8 *pV,
+    XDAS_UInt8 *pLine0, XDAS_UInt8 *pLine1, XDAS_Int32 width)
+{
+    return (i420Columns(pU, pV, pLine0, pLine1, 0, width));
+}
+
+
+/*
+ *  ======== sadColumns ========
+ *  C block SAD and update of columns x0 (a multiple of 16) up to width;
+ *  the whole reference, and the tail of the SIMD variants.
+ */
+static Int sadColumns(XDAS_UInt32 *blockSad, XDAS_UInt8 *pPrev,
+    XDAS_Int32 prevPitch, XDAS_UInt8 *pCur, XDAS_Int32 curPitch,
+    XDAS_Int32 lines, XDAS_Int32 x0, XDAS_Int32 width)
+{
+    XDAS_Int32 x;
+    XDAS_Int32 y;
+    XDAS_Int32 d;
+
+    for (x = x0; x < width; x += 16) {
+        blockSad[x >> 4] = 0;
+    }
+
+    for (y = 0; y < lines; y++) {
+        for (x = x0; x < width; x++) {
+            d = pCur[x] - pPrev[x];
+            blockSad[x >> 4] += (d < 0) ? -d : d;
+            pPrev[x] = pCur[x];
+        }
+        pPrev += prevPitch;
+        pCur += curPitch;
+    }
+
+    return 0;
+}
+
+/*
+ *  ======== VIDENCCOPY_TI_C_BLOCK_SAD ========
+ */
+Int VIDENCCOPY_TI_C_BLOCK_SAD(XDAS_UInt32 *blockSad, XDAS_UInt8 *pPrev,
+    XDAS_Int32 prevPitch, XDAS_UInt8 *pCur, XDAS_Int32 curPitch,
+    XDAS_Int32 lines, XDAS_Int32 width)
+{
+    return (sadColumns(blockSad, pPrev, prevPitch, pCur, curPitch, lines, 0,
+        width));
+}
+
+
+#ifdef VIDENCCOPY_TI_X86
+
+/*
+ *  ======== VIDENCCOPY_TI_YUV422_SSE2_GRAY ========
+ *  64 pixels per iteration: mask off chroma in each 16-bit word and
+ *  saturating-pack the words back down to bytes.
+ */
+TARGET("sse2")
+static Int VIDENCCOPY_TI_YUV422_SSE2_GRAY(XDAS_UInt8* pGray,
+    XDAS_UInt8* pYUV422, XDAS_Int32 height, XDAS_Int32 width)
+{
+    XDAS_Int32 n = height * width;
+    XDAS_Int32 i;
+    __m128i mask = _mm_set1_epi16(0x00ff);
+
+    for (i = 0; i + 64 <= n; i += 64) {
+        const __m128i *s = (const __m128i *)(pYUV422 + i * 2);
+        __m128i a0 = _mm_and_si128(_mm_loadu_si128(s + 0), mask);
+        __m128i a1 = _mm_and_si128(_mm_loadu_si128(s + 1), mask);
+        __m128i a2 = _mm_and_si128(_mm_loadu_si128(s + 2), mask);
+        __m128i a3 = _mm_and_si128(_mm_loadu_si128(s + 3), mask);
+        __m128i a4 = _mm_and_si128(_mm_loadu_si128(s + 4), mask);
+        __m128i a5 = _mm_and_si128(_mm_loadu_si128(s + 5), mask);
+        __m128i a6 = _mm_and_si128(_mm_loadu_si128(s + 6), mask);
+        __m128i a7 = _mm_and_si128(_mm_loadu_si128(s + 7), mask);
+        __m128i *d = (__m128i *)(pGray + i);
+
+        _mm_storeu_si128(d + 0, _mm_packus_epi16(a0, a1));
+        _mm_storeu_si128(d + 1, _mm_packus_epi16(a2, a3));
+        _mm_storeu_si128(d + 2, _mm_packus_epi16(a4, a5));
+        _mm_storeu_si128(d + 3, _mm_packus_epi16(a6, a7));
+    }
+
+    for (; i < n; i++) {
+        pGray[i] = pYUV422[i * 2];
+    }
+
+    return 0;
+}
+
+/*
+ *  ======== VIDENCCOPY_TI_YUV422_SSSE3_GRAY ========
+ *  64 pixels per iteration: pshufb gathers the eight Y bytes of each
+ *  16-byte load into one half of the register.
+ */
+TARGET("ssse3")
+static Int VIDENCCOPY_TI_YUV422_SSSE3_GRAY(XDAS_UInt8* pGray,
+    XDAS_UInt8* pYUV422, XDAS_Int32 height, XDAS_Int32 width)
+{
+    XDAS_Int32 n = height * width;
+    XDAS_Int32 i;
+    __m128i lo = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14,
+        -1, -1, -1, -1, -1, -1, -1, -1);
+    __m128i hi = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,
+        0, 2, 4, 6, 8, 10, 12, 14);
+
+    for (i = 0; i + 64 <= n; i += 64) {
+        const __m128i *s = (const __m128i *)(pYUV422 + i * 2);
+        __m128i *d = (__m128i *)(pGray + i);
+        int k;
+
+        for (k = 0; k < 4; k++) {
+            __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(s + 2 * k), lo);
+            __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(s + 2 * k + 1), hi);
+
+            _mm_storeu_si128(d + k, _mm_or_si128(a, b));
+        }
+    }
+
+    for (; i < n; i++) {
+        pGray[i] = pYUV422[i * 2];
+    }
+
+    return 0;
+}
+
+/*
+ *  ======== VIDENCCOPY_TI_YUV422_AVX2_GRAY ========
+ *  64 pixels per iteration.  packus works per 128-bit lane, so the
+ *  64-bit quarters are put back in order with a cross-lane permute.
+ */
+TARGET("avx2")
+static Int VIDENCCOPY_TI_YUV422_AVX2_GRAY(XDAS_UInt8* pGray,
+    XDAS_UInt8* pYUV422, XDAS_Int32 height, XDAS_Int32 width)
+{
+    XDAS_Int32 n = height * width;
+    XDAS_Int32 i;
+    __m256i mask = _mm256_set1_epi16(0x00ff);
+
+    for (i = 0; i + 64 <= n; i += 64) {
+        const __m256i *s = (const __m256i *)(pYUV422 + i * 2);
+        __m256i a0 = _mm256_and_si256(_mm256_loadu_si256(s + 0), mask);
+        __m256i a1 = _mm256_and_si256(_mm256_loadu_si256(s + 1), mask);
+        __m256i a2 = _mm256_and_si256(_mm256_loadu_si256(s + 2), mask);
+        __m256i a3 = _mm256_and_si256(_mm256_loadu_si256(s + 3), mask);
+        __m256i *d = (__m256i *)(pGray + i);
+
+        _mm256_storeu_si256(d + 0,
+            _mm256_permute4x64_epi64(_mm256_packus_epi16(a0, a1), 0xd8));
+        _mm256_storeu_si256(d + 1,
+            _mm256_permute4x64_epi64(_mm256_packus_epi16(a2, a3), 0xd8));
+    }
+
+    for (; i < n; i++) {
+        pGray[i] = pYUV422[i * 2];
+    }
+
+    return 0;
+}
+
+/*
+ *  ======== VIDENCCOPY_TI_YUV422_SSE2_NV12 ========
+ *  16 pixels per iteration: pavgb averages the two lines, which is the
+ *  rounded mean of the reference, and the chroma (odd) bytes are
+ *  shifted down and packed, already in NV12 order.
+ */
+TARGET("sse2")
+static Int VIDENCCOPY_TI_YUV422_SSE2_NV12(XDAS_UInt8 *pUV,
+    XDAS_UInt8 *pLine0, XDAS_UInt8 *pLine1, XDAS_Int32 width)
+{
+    XDAS_Int32 i;
+
+    for (i = 0; i + 16 <= width; i += 16) {
+        const __m128i *s0 = (const __m128i *)(pLine0 + i * 2);
+        const __m128i *s1 = (const __m128i *)(pLine1 + i * 2);
+        __m128i a = _mm_avg_epu8(_mm_loadu_si128(s0),
+            _mm_loadu_si128(s1));
+        __m128i b = _mm_avg_epu8(_mm_loadu_si128(s0 + 1),
+            _mm_loadu_si128(s1 + 1));
+
+        _mm_storeu_si128((__m128i *)(pUV + i),
+            _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+    }
+
+    return (nv12Columns(pUV, pLine0, pLine1, i, width));
+}
+
+/*
+ *  ======== VIDENCCOPY_TI_YUV422_SSE2_I420 ========
+ *  32 pixels per iteration: the NV12 pairs of two halves are split into
+ *  U (low byte of each word) and V (high byte).
+ */
+TARGET("sse2")
+static Int VIDENCCOPY_TI_YUV422_SSE2_I420(XDAS_UInt8 *pU, XDAS_UInt8 *pV,
+    XDAS_UInt8 *pLine0, XDAS_UInt8 *pLine1, XDAS_Int32 width)
+{
+    XDAS_Int32 i;
+    __m128i mask = _mm_set1_epi16(0x00ff);
+
+    for (i = 0; i + 32 <= width; i += 32) {
+        const __m128i *s0 = (const __m128i *)(pLine0 + i * 2);
+        const __m128i *s1 = (const __m128i *)(pLine1 + i * 2);
+        __m128i uv0 = _mm_packus_epi16(
+            _mm_srli_epi16(_mm_avg_epu8(_mm_loadu_si128(s0),
+                _mm_loadu_si128(s1)), 8),
+            _mm_srli_epi16(_mm_avg_epu8(_mm_loadu_si128(s0 + 1),
+                _mm_loadu_si128(s1 + 1)), 8));
+        __m128i uv1 = _mm_packus_epi16(
+            _mm_srli_epi16(_mm_avg_epu8(_mm_loadu_si128(s0 + 2),
+                _mm_loadu_si128(s1 + 2)), 8),
+            _mm_srli_epi16(_mm_avg_epu8(_mm_loadu_si128(s0 + 3),
+                _mm_loadu_si128(s1 + 3)), 8));
+
+        _mm_storeu_si128((__m128i *)(pU + i / 2), _mm_packus_epi16(
+            _mm_and_si128(uv0, mask), _mm_and_si128(uv1, mask)));
+        _mm_storeu_si128((__m128i *)(pV + i / 2), _mm_packus_epi16(
+            _mm_srli_epi16(uv0, 8), _mm_srli_epi16(uv1, 8)));
+    }
+
+    return (i420Columns(pU, pV, pLine0, pLine1, i, width));
+}
+
+/*
+ *  ======== avx2Chroma ========
+ *  The NV12 chroma of the 32 pixels at pLine0 and pLine1, in order.
+ */
+TARGET("avx2")
+static __m256i avx2Chroma(XDAS_UInt8 *pLine0, XDAS_UInt8 *pLine1)
+{
+    const __m256i *s0 = (const __m256i *)pLine0;
+    const __m256i *s1 = (const __m256i *)pLine1;
+    __m256i a = _mm256_avg_epu8(_mm256_loadu_si256(s0),
+        _mm256_loadu_si256(s1));
+    __m256i b = _mm256_avg_epu8(_mm256_loadu_si256(s0 + 1),
+        _mm256_loadu_si256(s1 + 1));
+
+    return (_mm256_permute4x64_epi64(_mm256_packus_epi16(
+        _mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8)), 0xd8));
+}
+
+/*
+ *  ======== VIDENCCOPY_TI_YUV422_AVX2_NV12 ========
+ *  32 pixels per iteration, like the SSE2 variant.
+ */
+TARGET("avx2")
+static Int VIDENCCOPY_TI_YUV422_AVX2_NV12(XDAS_UInt8 *pUV,
+    XDAS_UInt8 *pLine0, XDAS_UInt8 *pLine1, XDAS_Int32 width)
+{
+    XDAS_Int32 i;
+
+    for (i = 0; i + 32 <= width; i += 32) {
+        _mm256_storeu_si256((__m256i *)(pUV + i),
+            avx2Chroma(pLine0 + i * 2, pLine1 + i * 2));
+    }
+
+    return (nv12Columns(pUV, pLine0, pLine1, i, width));
+}
+
+/*
+ *  ======== VIDENCCOPY_TI_YUV422_AVX2_I420 ========
+ *  64 pixels per iteration, packus needs the same permute again.
+ */
+TARGET("avx2")
+static Int VIDENCCOPY_TI_YUV422_AVX2_I420(XDAS_UInt8 *pU, XDAS_UInt8 *pV,
+    XDAS_UInt8 *pLine0, XDAS_UInt8 *pLine1, XDAS_Int32 width)
+{
+    XDAS_Int32 i;
+    __m256i mask = _mm256_set1_epi16(0x00ff);
+
+    for (i = 0; i + 64 <= width; i += 64) {
+        __m256i uv0 = avx2Chroma(pLine0 + i * 2, pLine1 + i * 2);
+        __m256i uv1 = avx2Chroma(pLine0 + i * 2 + 64, pLine1 + i * 2 + 64);
+
+        _mm256_storeu_si256((__m256i *)(pU + i / 2),
+            _mm256_permute4x64_epi64(_mm256_packus_epi16(
+            _mm256_and_si256(uv0, mask), _mm256_and_si256(uv1, mask)), 0xd8));
+        _mm256_storeu_si256((__m256i *)(pV + i / 2),
+            _mm256_permute4x64_epi64(_mm256_packus_epi16(
+            _mm256_srli_epi16(uv0, 8), _mm256_srli_epi16(uv1, 8)), 0xd8));
+    }
+
+    return (i420Columns(pU, pV, pLine0, pLine1, i, width));
+}
+
+/*
+ *  ======== VIDENCCOPY_TI_SSE2_BLOCK_SAD ========
+ *  One block at a time, down its lines: psadbw leaves two partial sums
+ *  per line in the 64-bit halves of the accumulator.
+ */
+TARGET("sse2")
+static Int VIDENCCOPY_TI_SSE2_BLOCK_SAD(XDAS_UInt32 *blockSad,
+    XDAS_UInt8 *pPrev, XDAS_Int32 prevPitch, XDAS_UInt8 *pCur,
+    XDAS_Int32 curPitch, XDAS_Int32 lines, XDAS_Int32 width)
+{
+    XDAS_Int32 blocks = width >> 4;
+    XDAS_Int32 b;
+    XDAS_Int32 y;
+
+    for (b = 0; b < blocks; b++) {
+        XDAS_UInt8 *p = pPrev + b * 16;
+        XDAS_UInt8 *c = pCur + b * 16;
+        __m128i acc = _mm_setzero_si128();
+
+        for (y = 0; y < lines; y++) {
+            __m128i cur = _mm_loadu_si128((const __m128i *)c);
+
+            acc = _mm_add_epi64(acc,
+                _mm_sad_epu8(cur, _mm_loadu_si128((const __m128i *)p)));
+            _mm_storeu_si128((__m128i *)p, cur);
+            p += prevPitch;
+            c += curPitch;
+        }
+
+        blockSad[b] = _mm_cvtsi128_si32(acc) +
+            _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+    }
+
+    return (sadColumns(blockSad, pPrev, prevPitch, pCur, curPitch, lines,
+        blocks * 16, width));
+}
+
+/*
+ *  ======== VIDENCCOPY_TI_AVX2_BLOCK_SAD ========
+ *  Two blocks at a time; the 128-bit lanes of the accumulator hold the
+ *  sums of the left and the right block.
+ */
+TARGET("avx2")
+static Int VIDENCCOPY_TI_AVX2_BLOCK_SAD(XDAS_UInt32 *blockSad,
+    XDAS_UInt8 *pPrev, XDAS_Int32 prevPitch, XDAS_UInt8 *pCur,
+    XDAS_Int32 curPitch, XDAS_Int32 lines, XDAS_Int32 width)
+{
+    XDAS_Int32 blocks = width >> 4;
+    XDAS_Int32 b;
+    XDAS_Int32 y;
+
+    for (b = 0; b + 2 <= blocks; b += 2) {
+        XDAS_UInt8 *p = pPrev + b * 16;
+        XDAS_UInt8 *c = pCur + b * 16;
+        __m256i acc = _mm256_setzero_si256();
+        __m128i lo;
+        __m128i hi;
+
+        for (y = 0; y < lines; y++) {
+            __m256i cur = _mm256_loadu_si256((const __m256i *)c);
+
+            acc = _mm256_add_epi64(acc,
+                _mm256_sad_epu8(cur, _mm256_loadu_si256((const __m256i *)p)));
+            _mm256_storeu_si256((__m256i *)p, cur);
+            p += prevPitch;
+            c += curPitch;
+        }
+
+        lo = _mm256_castsi256_si128(acc);
+        hi = _mm256_extracti128_si256(acc, 1);
+        blockSad[b] = _mm_cvtsi128_si32(lo) +
+            _mm_cvtsi128_si32(_mm_srli_si128(lo, 8));
+        blockSad[b + 1] = _mm_cvtsi128_si32(hi) +
+            _mm_cvtsi128_si32(_mm_srli_si128(hi, 8));
+    }
+
+    /* an odd block and the narrow tail */
+    return (VIDENCCOPY_TI_SSE2_BLOCK_SAD(blockSad + b, pPrev + b * 16,
+        prevPitch, pCur + b * 16, curPitch, lines, width - b * 16));
+}
+
+#endif /* VIDENCCOPY_TI_X86 */
+
+
+#ifdef VIDENCCOPY_TI_ARMNEON
+
+/*
+ *  ======== VIDENCCOPY_TI_YUV422_NEON_GRAY ========
+ *  32 pixels per iteration: vld2 deinterleaves Y from the UV bytes.
+ */
+static Int VIDENCCOPY_TI_YUV422_NEON_GRAY(XDAS_UInt8* pGray,
+    XDAS_UInt8* pYUV422, XDAS_Int32 height, XDAS_Int32 width)
+{
+    XDAS_Int32 n = height * width;
+    XDAS_Int32 i;
+
+    for (i = 0; i + 32 <= n; i += 32) {
+        uint8x16x2_t a = vld2q_u8(pYUV422 + i * 2);
+        uint8x16x2_t b = vld2q_u8(pYUV422 + i * 2 + 32);
+
+        vst1q_u8(pGray + i, a.val[0]);
+        vst1q_u8(pGray + i + 16, b.val[0]);
+    }
+
+    for (; i < n; i++) {
+        pGray[i] = pYUV422[i * 2];
+    }
+
+    return 0;
+}
+
+/*
+ *  ======== VIDENCCOPY_TI_YUV422_NEON_NV12 ========
+ *  16 pixels per iteration: vld2 puts the chroma bytes of each line in
+ *  val[1], already in NV12 order, and vrhadd takes their rounded mean.
+ */
+static Int VIDENCCOPY_TI_YUV422_NEON_NV12(XDAS_UInt8 *pUV,
+    XDAS_UInt8 *pLine0, XDAS_UInt8 *pLine1, XDAS_Int32 width)
+{
+    XDAS_Int32 i;
+
+    for (i = 0; i + 16 <= width; i += 16) {
+        uint8x16x2_t a = vld2q_u8(pLine0 + i * 2);
+        uint8x16x2_t b = vld2q_u8(pLine1 + i * 2);
+
+        vst1q_u8(pUV + i, vrhaddq_u8(a.val[1], b.val[1]));
+    }
+
+    return (nv12Columns(pUV, pLine0, pLine1, i, width));
+}
+
+/*
+ *  ======== VIDENCCOPY_TI_YUV422_NEON_I420 ========
+ *  32 pixels per iteration: vld4 splits Y0 U Y1 V into four registers.
+ */
+static Int VIDENCCOPY_TI_YUV422_NEON_I420(XDAS_UInt8 *pU, XDAS_UInt8 *pV,
+    XDAS_UInt8 *pLine0, XDAS_UInt8 *pLine1, XDAS_Int32 width)
+{
+    XDAS_Int32 i;
+
+    for (i = 0; i + 32 <= width; i += 32) {
+        uint8x16x4_t a = vld4q_u8(pLine0 + i * 2);
+        uint8x16x4_t b = vld4q_u8(pLine1 + i * 2);
+
+        vst1q_u8(pU + i / 2, vrhaddq_u8(a.val[1], b.val[1]));
+        vst1q_u8(pV + i / 2, vrhaddq_u8(a.val[3], b.val[3]));
+    }
+
+    return (i420Columns(pU, pV, pLine0, pLine1, i, width));
+}
+
+/*
+ *  ======== VIDENCCOPY_TI_NEON_BLOCK_SAD ========
+ *  vabd/vpadal per line into eight 16-bit partial sums (at most
+ *  16 lines * 2 * 255, no overflow), folded once per block.
+ */
+static Int VIDENCCOPY_TI_NEON_BLOCK_SAD(XDAS_UInt32 *blockSad,
+    XDAS_UInt8 *pPrev, XDAS_Int32 prevPitch, XDAS_UInt8 *pCur,
+    XDAS_Int32 curPitch, XDAS_Int32 lines, XDAS_Int32 width)
+{
+    XDAS_Int32 blocks = width >> 4;
+    XDAS_Int32 b;
+    XDAS_Int32 y;
+
+    for (b = 0; b < blocks; b++) {
+        XDAS_UInt8 *p = pPrev + b * 16;
+        XDAS_UInt8 *c = pCur + b * 16;
+        uint16x8_t acc = vdupq_n_u16(0);
+        uint64x2_t sum;
+
+        for (y = 0; y < lines; y++) {
+            uint8x16_t cur = vld1q_u8(c);
+
+            acc = vpadalq_u8(acc, vabdq_u8(cur, vld1q_u8(p)));
+            vst1q_u8(p, cur);
+            p += prevPitch;
+            c += curPitch;
+        }
+
+        sum = vpaddlq_u32(vpaddlq_u16(acc));
+        blockSad[b] = (XDAS_UInt32)(vgetq_lane_u64(sum, 0) +
+            vgetq_lane_u64(sum, 1));
+    }
+
+    return (sadColumns(blockSad, pPrev, prevPitch, pCur, curPitch, lines,
+        blocks * 16, width));
+}
+
+#endif /* VIDENCCOPY_TI_ARMNEON */
+
+
+const VIDENCCOPY_TI_GrayKernel VIDENCCOPY_TI_grayKernels[] = {
+    {"c",     VIDENCCOPY_TI_ISA_C,     VIDENCCOPY_TI_YUV422_C_GRAY},
+#ifdef VIDENCCOPY_TI_X86
+    {"sse2",  VIDENCCOPY_TI_ISA_SSE2,  VIDENCCOPY_TI_YUV422_SSE2_GRAY},
+    {"ssse3", VIDENCCOPY_TI_ISA_SSSE3, VIDENCCOPY_TI_YUV422_SSSE3_GRAY},
+    {"avx2",  VIDENCCOPY_TI_ISA_AVX2,  VIDENCCOPY_TI_YUV422_AVX2_GRAY},
+#endif
+#ifdef VIDENCCOPY_TI_ARMNEON
+    {"neon",  VIDENCCOPY_TI_ISA_NEON,  VIDENCCOPY_TI_YUV422_NEON_GRAY},
+#endif
+};
+
+const Int VIDENCCOPY_TI_numGrayKernels =
+    sizeof(VIDENCCOPY_TI_grayKernels) / sizeof(VIDENCCOPY_TI_grayKernels[0]);
+
+VIDENCCOPY_TI_GrayFxn VIDENCCOPY_TI_YUV422_GRAY = VIDENCCOPY_TI_YUV422_C_GRAY;
+String VIDENCCOPY_TI_grayKernelName = "c";
+
+const VIDENCCOPY_TI_SadKernel VIDENCCOPY_TI_sadKernels[] = {
+    {"c",     VIDENCCOPY_TI_ISA_C,     VIDENCCOPY_TI_C_BLOCK_SAD},
+#ifdef VIDENCCOPY_TI_X86
+    {"sse2",  VIDENCCOPY_TI_ISA_SSE2,  VIDENCCOPY_TI_SSE2_BLOCK_SAD},
+    {"avx2",  VIDENCCOPY_TI_ISA_AVX2 | VIDENCCOPY_TI_ISA_SSE2,
+        VIDENCCOPY_TI_AVX2_BLOCK_SAD},
+#endif
+#ifdef VIDENCCOPY_TI_ARMNEON
+    {"neon",  VIDENCCOPY_TI_ISA_NEON,  VIDENCCOPY_TI_NEON_BLOCK_SAD},
+#endif
+};
+
+const Int VIDENCCOPY_TI_numSadKernels =
+    sizeof(VIDENCCOPY_TI_sadKernels) / sizeof(VIDENCCOPY_TI_sadKernels[0]);
+
+VIDENCCOPY_TI_SadFxn VIDENCCOPY_TI_BLOCK_SAD = VIDENCCOPY_TI_C_BLOCK_SAD;
+String VIDENCCOPY_TI_sadKernelName = "c";
+
+const VIDENCCOPY_TI_ChromaKernel VIDENCCOPY_TI_chromaKernels[] = {
+    {"c",     VIDENCCOPY_TI_ISA_C,     VIDENCCOPY_TI_YUV422_C_NV12,
+        VIDENCCOPY_TI_YUV422_C_I420},
+#ifdef VIDENCCOPY_TI_X86
+    {"sse2",  VIDENCCOPY_TI_ISA_SSE2,  VIDENCCOPY_TI_YUV422_SSE2_NV12,
+        VIDENCCOPY_TI_YUV422_SSE2_I420},
+    {"avx2",  VIDENCCOPY_TI_ISA_AVX2,  VIDENCCOPY_TI_YUV422_AVX2_NV12,
+        VIDENCCOPY_TI_YUV422_AVX2_I420},
+#endif
+#ifdef VIDENCCOPY_TI_ARMNEON
+    {"neon",  VIDENCCOPY_TI_ISA_NEON,  VIDENCCOPY_TI_YUV422_NEON_NV12,
+        VIDENCCOPY_TI_YUV422_NEON_I420},
+#endif
+};
+
+const Int VIDENCCOPY_TI_numChromaKernels =
+    sizeof(VIDENCCOPY_TI_chromaKernels) /
+    sizeof(VIDENCCOPY_TI_chromaKernels[0]);
+
+VIDENCCOPY_TI_NV12Fxn VIDENCCOPY_TI_YUV422_NV12 = VIDENCCOPY_TI_YUV422_C_NV12;
+VIDENCCOPY_TI_I420Fxn VIDENCCOPY_TI_YUV422_I420 = VIDENCCOPY_TI_YUV422_C_I420;
+String VIDENCCOPY_TI_chromaKernelName = "c";
+
+
+/*
+ *  ======== VIDENCCOPY_TI_cpuIsa ========
+ *  Return the VIDENCCOPY_TI_ISA_* extensions the running CPU supports.
+ */
+XDAS_UInt32 VIDENCCOPY_TI_cpuIsa(Void)
+{
+    XDAS_UInt32 isa = VIDENCCOPY_TI_ISA_C;
+
+#if defined(VIDENCCOPY_TI_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        isa |= VIDENCCOPY_TI_ISA_SSE2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        isa |= VIDENCCOPY_TI_ISA_SSSE3;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        isa |= VIDENCCOPY_TI_ISA_AVX2;
+    }
+#elif defined(VIDENCCOPY_TI_ARMNEON)
+#if defined(__aarch64__)
+    isa |= VIDENCCOPY_TI_ISA_NEON;
+#else
+    if (getauxval(AT_HWCAP) & HWCAP_NEON) {
+        isa |= VIDENCCOPY_TI_ISA_NEON;
+    }
+#endif
+#endif
+
+    return (isa);
+}
+
+
+/*
+ *  ======== VIDENCCOPY_TI_kernelInit ========
+ *  Select the last (fastest) table entry of each kernel the CPU can run.
+ *  Safe to call more than once; every call picks the same variants.
+ */
+Void VIDENCCOPY_TI_kernelInit(Void)
+{
+    XDAS_UInt32 isa = VIDENCCOPY_TI_cpuIsa();
+    Int i;
+
+    for (i = VIDENCCOPY_TI_numGrayKernels - 1; i > 0; i--) {
+        if ((VIDENCCOPY_TI_grayKernels[i].isa & isa) ==
+            VIDENCCOPY_TI_grayKernels[i].isa) {
+            break;
+        }
+    }
+
+    VIDENCCOPY_TI_YUV422_GRAY = VIDENCCOPY_TI_grayKernels[i].fxn;
+    VIDENCCOPY_TI_grayKernelName = VIDENCCOPY_TI_grayKernels[i].name;
+
+    for (i = VIDENCCOPY_TI_numSadKernels - 1; i > 0; i--) {
+        if ((VIDENCCOPY_TI_sadKernels[i].isa & isa) ==
+            VIDENCCOPY_TI_sadKernels[i].isa) {
+            break;
+        }
+    }
+
+    VIDENCCOPY_TI_BLOCK_SAD = VIDENCCOPY_TI_sadKernels[i].fxn;
+    VIDENCCOPY_TI_sadKernelName = VIDENCCOPY_TI_sadKernels[i].name;
+
+    for (i = VIDENCCOPY_TI_numChromaKernels - 1; i > 0; i--) {
+        if ((VIDENCCOPY_TI_chromaKernels[i].isa & isa) ==
+            VIDENCCOPY_TI_chromaKernels[i].isa) {
+            break;
+        }
+    }
+
+    VIDENCCOPY_TI_YUV422_NV12 = VIDENCCOPY_TI_chromaKernels[i].nv12;
+    VIDENCCOPY_TI_YUV422_I420 = VIDENCCOPY_TI_chromaKernels[i].i420;
+    VIDENCCOPY_TI_chromaKernelName = VIDENCCOPY_TI_chromaKernels[i].name;
+}
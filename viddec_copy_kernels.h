@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2010, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+/*
+ *  ======== viddec_copy_kernels.h ========
+ *  Pixel kernels shared by the VIDDECCOPY algorithm and the capture app.
+ *
+ *  Every kernel has a portable C version which is the reference for
+ *  bit-exactness and the fallback on targets without SIMD.  The SIMD
+ *  variants built for the current target are listed in a table, and
+ *  VIDENCCOPY_TI_kernelInit() points the dispatched entry at the best
+ *  one the running CPU supports.
+ */
+#ifndef VIDDECCOPY_KERNELS_
+#define VIDDECCOPY_KERNELS_
+
+#include <ti/xdais/xdas.h>
+
+/* instruction set extensions a kernel variant may require */
+#define VIDENCCOPY_TI_ISA_C         0x0
+#define VIDENCCOPY_TI_ISA_SSE2      0x1
+#define VIDENCCOPY_TI_ISA_SSSE3     0x2
+#define VIDENCCOPY_TI_ISA_AVX2      0x4
+#define VIDENCCOPY_TI_ISA_NEON      0x8
+
+/*
+ *  ======== VIDENCCOPY_TI_GrayFxn ========
+ *  Extract the luma of a packed YUYV (YUV 4:2:2 interleaved) image of
+ *  height x width pixels into pGray.  Both images are tightly packed.
+ */
+typedef Int (*VIDENCCOPY_TI_GrayFxn)(XDAS_UInt8 *pGray, XDAS_UInt8 *pYUV422,
+    XDAS_Int32 height, XDAS_Int32 width);
+
+typedef struct VIDENCCOPY_TI_GrayKernel {
+    String                  name;
+    XDAS_UInt32             isa;    /* VIDENCCOPY_TI_ISA_* bits required */
+    VIDENCCOPY_TI_GrayFxn   fxn;
+} VIDENCCOPY_TI_GrayKernel;
+
+/*
+ *  ======== VIDENCCOPY_TI_SadFxn ========
+ *  Sum of absolute differences over the first lines (at most 16) lines
+ *  of two gray images, one sum per 16 pixel wide block: blockSad[b] covers
+ *  columns 16 * b up to 16 * b + 15, the last block may be narrower.
+ *  Each line of pCur is then copied over pPrev, so the previous frame is
+ *  brought up to date without another pass.
+ */
+typedef Int (*VIDENCCOPY_TI_SadFxn)(XDAS_UInt32 *blockSad, XDAS_UInt8 *pPrev,
+    XDAS_Int32 prevPitch, XDAS_UInt8 *pCur, XDAS_Int32 curPitch,
+    XDAS_Int32 lines, XDAS_Int32 width);
+
+typedef struct VIDENCCOPY_TI_SadKernel {
+    String                  name;
+    XDAS_UInt32             isa;
+    VIDENCCOPY_TI_SadFxn    fxn;
+} VIDENCCOPY_TI_SadKernel;
+
+/*
+ *  ======== VIDENCCOPY_TI_NV12Fxn ========
+ *  One line of 4:2:0 chroma from the YUYV lines pLine0 and pLine1 of
+ *  width (even) pixels: the rounded mean of the two lines' U and V
+ *  samples, interleaved like NV12 into pUV.
+ *
+ *  ======== VIDENCCOPY_TI_I420Fxn ========
+ *  Likewise, with U and V in the lines pU and pV of separate planes.
+ */
+typedef Int (*VIDENCCOPY_TI_NV12Fxn)(XDAS_UInt8 *pUV, XDAS_UInt8 *pLine0,
+    XDAS_UInt8 *pLine1, XDAS_Int32 width);
+
+typedef Int (*VIDENCCOPY_TI_I420Fxn)(XDAS_UInt8 *pU, XDAS_UInt8 *pV,
+    XDAS_UInt8 *pLine0, XDAS_UInt8 *pLine1, XDAS_Int32 width);
+
+typedef struct VIDENCCOPY_TI_ChromaKernel {
+    String                  name;
+    XDAS_UInt32             isa;
+    VIDENCCOPY_TI_NV12Fxn   nv12;
+    VIDENCCOPY_TI_I420Fxn   i420;
+} VIDENCCOPY_TI_ChromaKernel;
+
+/* all variants built for this target, slowest (the C reference) first */
+extern const VIDENCCOPY_TI_GrayKernel VIDENCCOPY_TI_grayKernels[];
+extern const Int VIDENCCOPY_TI_numGrayKernels;
+
+extern const VIDENCCOPY_TI_SadKernel VIDENCCOPY_TI_sadKernels[];
+extern const Int VIDENCCOPY_TI_numSadKernels;
+
+extern const VIDENCCOPY_TI_ChromaKernel VIDENCCOPY_TI_chromaKernels[];
+extern const Int VIDENCCOPY_TI_numChromaKernels;
+
+/* the variants picked by VIDENCCOPY_TI_kernelInit(); C until then */
+extern VIDENCCOPY_TI_GrayFxn VIDENCCOPY_TI_YUV422_GRAY;
+extern String VIDENCCOPY_TI_grayKernelName;
+
+extern VIDENCCOPY_TI_SadFxn VIDENCCOPY_TI_BLOCK_SAD;
+extern String VIDENCCOPY_TI_sadKernelName;
+
+extern VIDENCCOPY_TI_NV12Fxn VIDENCCOPY_TI_YUV422_NV12;
+extern VIDENCCOPY_TI_I420Fxn VIDENCCOPY_TI_YUV422_I420;
+extern String VIDENCCOPY_TI_chromaKernelName;
+
+extern XDAS_UInt32 VIDENCCOPY_TI_cpuIsa(Void);
+
+extern Void VIDENCCOPY_TI_kernelInit(Void);
+
+extern Int VIDENCCOPY_TI_YUV422_C_GRAY(XDAS_UInt8* pGray, XDAS_UInt8* pYUV422,
+    XDAS_Int32 height, XDAS_Int32 width);
+
+/* crop and scale kernels, C only; see viddec_copy_kernels.c */
+extern Int VIDENCCOPY_TI_YUV422_C_GRAY_BOX(XDAS_UInt8 *pGray,
+    XDAS_UInt8 *pYUV422, XDAS_Int32 pitch, XDAS_Int32 width,
+    XDAS_Int32 factor);
+
+extern Int VIDENCCOPY_TI_YUV422_C_GRAY_LINEAR(XDAS_UInt8 *pGray,
+    XDAS_UInt8 *pLine0, XDAS_UInt8 *pLine1, XDAS_Int32 wy, XDAS_Int32 width,
+    XDAS_Int32 srcWidth, XDAS_Int32 stepX);
+
+extern Int VIDENCCOPY_TI_YUV422_C_NV12(XDAS_UInt8 *pUV, XDAS_UInt8 *pLine0,
+    XDAS_UInt8 *pLine1, XDAS_Int32 width);
+
+extern Int VIDENCCOPY_TI_YUV422_C_I420(XDAS_UInt8 *pU, XDAS_UInt8 *pV,
+    XDAS_UInt8 *pLine0, XDAS_UInt8 *pLine1, XDAS_Int32 width);
+
+/*
+ *  Add lines lines of width pixels of a gray image, pitch bytes apart,
+ *  to four sub-histograms of 256 bins at hist, C only.
+ */
+extern Int VIDENCCOPY_TI_C_HISTOGRAM(XDAS_UInt32 *hist, XDAS_UInt8 *pGray,
+    XDAS_Int32 pitch, XDAS_Int32 lines, XDAS_Int32 width);
+
+extern Int VIDENCCOPY_TI_C_BLOCK_SAD(XDAS_UInt32 *blockSad, XDAS_UInt8 *pPrev,
+    XDAS_Int32 prevPitch, XDAS_UInt8 *pCur, XDAS_Int32 curPitch,
+    XDAS_Int32 lines, XDAS_Int32 width);
+
+#endif
@@ -44,11 +44,104 @@
 #ifndef VIDDECCOPY_TI_PRIV_
 #define VIDDECCOPY_TI_PRIV_
 
+#ifndef _TI_
+#include <pthread.h>
+#endif
+
+struct VIDDECCOPY_TI_Obj;
+
+/* the part of the input that is converted, and the size it is scaled to */
+typedef struct VIDDECCOPY_TI_Region {
+    XDAS_Int32  x;              /* top left corner, input pixels */
+    XDAS_Int32  y;
+    XDAS_Int32  width;
+    XDAS_Int32  height;
+    XDAS_Int32  factor;         /* box filter 1, 2 or 4; 0: bilinear */
+    XDAS_Int32  outWidth;
+    XDAS_Int32  outHeight;
+} VIDDECCOPY_TI_Region;
+
+/* the lines of a frame one thread converts */
+typedef struct VIDDECCOPY_TI_Band {
+    struct VIDDECCOPY_TI_Obj *obj;
+    XDAS_Int32  index;          /* band i is done by thread i */
+    XDAS_Int32  first;          /* first line */
+    XDAS_Int32  lines;
+    XDAS_UInt32 totalSad;       /* results of the band */
+    XDAS_Int32  moving;
+    XDAS_UInt32 hist[4 * IVIDDECCOPY_HISTBINS]; /* its sub-histograms */
+#ifndef _TI_
+    pthread_t   thread;
+#endif
+} VIDDECCOPY_TI_Band;
+
 typedef struct VIDDECCOPY_TI_Obj {
     IALG_Obj    alg;            /* MUST be first field of all XDAS algs */
 
-	// XDAS_UInt8* pGray;
-
+    /*
+     *  Everything process() and control() touch lives here, so any
+     *  number of instances can run concurrently.
+     */
+    GT_Mask     trace;          /* this instance's copy of the module mask */
+    VIDENCCOPY_TI_GrayFxn gray; /* luma kernel picked at create time */
+    VIDENCCOPY_TI_SadFxn sad;   /* block SAD kernel, likewise */
+    VIDENCCOPY_TI_NV12Fxn nv12; /* chroma kernels of the color outputs */
+    VIDENCCOPY_TI_I420Fxn i420;
+    String      grayName;       /* their names, for XDM_GETSTATUS */
+    String      sadName;
+    String      chromaName;
+
+    XDAS_Int32  width;          /* pixels per output line */
+    XDAS_Int32  height;         /* lines per output frame */
+    XDAS_Int32  inWidth;        /* pixels per input line */
+    XDAS_Int32  inHeight;       /* lines per input frame */
+    XDAS_Int32  inPitch;        /* bytes between YUYV input lines */
+    XDAS_Int32  outPitch;       /* bytes between gray output lines */
+    VIDDECCOPY_TI_Region roi;   /* what of the input makes the output */
+    XDAS_Int32  stepX;          /* bilinear: input pixels per output */
+    XDAS_Int32  stepY;          /* pixel, 16.16 fixed point */
+    XDAS_Int32  chromaFormat;   /* XDM_GRAY, XDM_YUV_420SP or XDM_YUV_420P */
+    XDAS_Int32  uvPitch;        /* bytes between chroma output lines */
+    XDAS_Int32  lumaStats;      /* histogram each frame */
+
+    XDAS_UInt8 *pPrev;          /* previous gray frame, width bytes/line */
+    XDAS_Int32  prevSize;       /* bytes at pPrev, from maxWidth/maxHeight */
+    XDAS_Int32  prevValid;      /* pPrev holds a frame of this geometry */
+    XDAS_Int32  motionDetect;
+    XDAS_Int32  motionThreshold;
+
+    XDAS_UInt8 *pStrip;         /* scratch, two block rows of width bytes */
+    XDAS_Int32  stripSize;
+    XDAS_Int32  outputMode;     /* IVIDDECCOPY_FULL or IVIDDECCOPY_DELTA */
+    XDAS_Int32  keyInterval;
+    XDAS_Int32  deltaThreshold;
+    XDAS_Int32  sinceKey;       /* delta records since the last keyframe */
+
+    /* counters of XDM_GETSTATUS, cleared by XDM_RESET; word 0 is low */
+    XDAS_UInt32 calls;
+    XDAS_UInt32 frames;
+    XDAS_UInt32 failedFrames;
+    XDAS_UInt32 bytesIn[2];
+    XDAS_UInt32 bytesOut[2];
+    XDAS_UInt32 totalTime[2];   /* in TIMEUNIT of viddec_copy.c */
+    XDAS_UInt32 maxTime;
+
+    XDAS_Int32  numThreads;     /* band threads, the caller's included */
+    XDAS_Int32  numBands;       /* bands of the frame being converted */
+    VIDDECCOPY_TI_Band band[IVIDDECCOPY_MAXTHREADS];
+    XDAS_UInt8 *pGray;          /* the frame being converted */
+    XDAS_UInt8 *pU;             /* its chroma planes, NV12 has only pU */
+    XDAS_UInt8 *pV;
+    XDAS_UInt8 *pYUV422;
+    XDAS_UInt8 *pMap;
+#ifndef _TI_
+    pthread_mutex_t lock;       /* guards the fields below */
+    pthread_cond_t start;       /* a new frame was handed out */
+    pthread_cond_t done;        /* the last band of a frame is done */
+    XDAS_UInt32 generation;     /* frames handed out */
+    XDAS_Int32  pending;        /* bands of the frame not done yet */
+    XDAS_Int32  quit;
+#endif
 } VIDDECCOPY_TI_Obj;
 
 
@@ -69,12 +162,10 @@ extern XDAS_Int32 VIDDECCOPY_TI_process(IVIDDEC_Handle h, XDM_BufDesc *inBufs,
 extern XDAS_Int32 VIDDECCOPY_TI_control(IVIDDEC_Handle handle,
     IVIDDEC_Cmd id, IVIDDEC_DynamicParams *params, IVIDDEC_Status *status);
 
-extern Int VIDENCCOPY_TI_YUV422_C_GRAY(XDAS_UInt8* pGray, XDAS_UInt8* pYUV422, 
-	XDAS_Int32 height, XDAS_Int32 width);
-
-
-extern Int VIDENCCOPY_TI_diff(XDAS_UInt8* preDiff, XDAS_UInt8* curDiff, 
-	XDAS_Int32 height, XDAS_Int32 width)
+extern XDAS_UInt32 VIDENCCOPY_TI_diff(VIDDECCOPY_TI_Obj *obj,
+    XDAS_UInt8 *preDiff, XDAS_UInt8 *curDiff, XDAS_Int32 curPitch,
+    XDAS_Int32 height, XDAS_UInt32 *blockSad, XDAS_UInt8 *map,
+    XDAS_Int32 *moving);
 
 #endif
 /*
@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2010, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+/*
+ *  ======== videnc_gray.c ========
+ *  A lossless encoder of 8-bit gray frames, such as the output of
+ *  VIDDECCOPY, through the xDM IVIDENC interface.  Each frame is coded on
+ *  its own by VIDENCGRAY_TI_encode(), see ividencgray.h for the stream.
+ */
+#include <xdc/std.h>
+#include <string.h>
+
+#include <ti/xdais/dm/ividenc.h>
+#include <ti/sdo/ce/trace/gt.h>
+
+#include "videnc_gray_ti.h"
+#include "ividencgray.h"
+#include "videnc_gray_kernels.h"
+#include "videnc_gray_ti_priv.h"
+
+/* buffer definitions */
+#define MININBUFS       1
+#define MINOUTBUFS      1
+
+/* memTab entries of one instance */
+#define OBJMEMTAB       0   /* VIDENCGRAY_TI_Obj, persistent */
+#define SCRATCHMEMTAB   1   /* codes of a line, scratch */
+#define NUMMEMTABS      2
+
+#define WIDTH       640   /* default geometry, see XDM_SETDEFAULT */
+#define HEIGHT      480
+
+/* bytes the current geometry touches in the input and output buffers */
+#define INFRAMESIZE(obj)  ((obj)->pitch * ((obj)->height - 1) + (obj)->width)
+#define OUTFRAMESIZE(obj) IVIDENCGRAY_MAXSIZE((obj)->width, (obj)->height)
+
+/* the widest line the creator asked for */
+#define MAXWIDTH(params) ((((params) != NULL) && ((params)->maxWidth > 0)) ? \
+    (params)->maxWidth : WIDTH)
+
+extern IALG_Fxns VIDENCGRAY_TI_IALG;
+
+#define IALGFXNS  \
+    &VIDENCGRAY_TI_IALG,/* module ID */                         \
+    NULL,               /* activate */                          \
+    VIDENCGRAY_TI_alloc,/* alloc */                             \
+    NULL,               /* control (NULL => no control ops) */  \
+    NULL,               /* deactivate */                        \
+    VIDENCGRAY_TI_free, /* free */                              \
+    VIDENCGRAY_TI_initObj, /* init */                           \
+    NULL,               /* moved */                             \
+    NULL                /* numAlloc (NULL => IALG_MAXMEMRECS) */
+
+/*
+ *  ======== VIDENCGRAY_TI_VIDENCGRAY ========
+ *  This structure defines TI's implementation of the IVIDENC interface
+ *  for the VIDENCGRAY_TI module.
+ */
+IVIDENC_Fxns VIDENCGRAY_TI_VIDENCGRAY = {    /* module_vendor_interface */
+    {IALGFXNS},
+    VIDENCGRAY_TI_process,
+    VIDENCGRAY_TI_control,
+};
+
+/*
+ *  ======== VIDENCGRAY_TI_IALG ========
+ *  This structure defines TI's implementation of the IALG interface
+ *  for the VIDENCGRAY_TI module.
+ */
+#ifdef _TI_
+
+asm("_VIDENCGRAY_TI_IALG .set _VIDENCGRAY_TI_VIDENCGRAY");
+
+#else
+
+/*
+ *  We duplicate the structure here to allow this code to be compiled and
+ *  run non-DSP platforms at the expense of unnecessary data space
+ *  consumed by the definition below.
+ */
+IALG_Fxns VIDENCGRAY_TI_IALG = {      /* module_vendor_interface */
+    IALGFXNS
+};
+
+#endif
+
+/*
+ *  tracing information; only alloc(), free() and initObj() use the
+ *  module mask, instances trace through their own copy in the object
+ */
+#define GTNAME "ti.sdo.ce.examples.codecs.videnc_gray"
+static GT_Mask curTrace = {NULL,NULL};
+
+/*
+ *  ======== VIDENCGRAY_TI_alloc ========
+ */
+Int VIDENCGRAY_TI_alloc(const IALG_Params *algParams,
+    IALG_Fxns **pf, IALG_MemRec memTab[])
+{
+    const IVIDENC_Params *params = (const IVIDENC_Params *)algParams;
+
+    if (curTrace.modName == NULL) {   /* initialize GT (tracing) */
+        GT_create(&curTrace, GTNAME);
+    }
+
+    GT_3trace(curTrace, GT_ENTER, "VIDENCGRAY_TI_alloc(0x%lx, 0x%lx, 0x%lx)\n",
+        algParams, pf, memTab);
+
+    /* Request memory for my object */
+    memTab[OBJMEMTAB].size = sizeof(VIDENCGRAY_TI_Obj);
+    memTab[OBJMEMTAB].alignment = 0;
+    memTab[OBJMEMTAB].space = IALG_EXTERNAL;
+    memTab[OBJMEMTAB].attrs = IALG_PERSIST;
+
+    /*
+     *  The codes of one line, written by the predictor and read back by
+     *  the packer right away, so internal RAM on the DSP.  Nothing is
+     *  kept in it from one process() call to the next.
+     */
+    memTab[SCRATCHMEMTAB].size = VIDENCGRAY_TI_SCRATCHSIZE(MAXWIDTH(params));
+    memTab[SCRATCHMEMTAB].alignment = 128;
+    memTab[SCRATCHMEMTAB].space = IALG_DARAM0;
+    memTab[SCRATCHMEMTAB].attrs = IALG_SCRATCH;
+
+    return (NUMMEMTABS);
+}
+
+
+/*
+ *  ======== VIDENCGRAY_TI_free ========
+ */
+Int VIDENCGRAY_TI_free(IALG_Handle handle, IALG_MemRec memTab[])
+{
+    VIDENCGRAY_TI_Obj *obj = (VIDENCGRAY_TI_Obj *)handle;
+
+    GT_2trace(curTrace, GT_ENTER, "VIDENCGRAY_TI_free(0x%lx, 0x%lx)\n",
+        handle, memTab);
+
+    VIDENCGRAY_TI_alloc(NULL, NULL, memTab);
+
+    memTab[OBJMEMTAB].base = handle;
+
+    memTab[SCRATCHMEMTAB].base = obj->pScratch;
+    memTab[SCRATCHMEMTAB].size = obj->scratchSize;
+
+    return (NUMMEMTABS);
+}
+
+
+/*
+ *  ======== VIDENCGRAY_TI_initObj ========
+ */
+Int VIDENCGRAY_TI_initObj(IALG_Handle handle,
+    const IALG_MemRec memTab[], IALG_Handle p,
+    const IALG_Params *algParams)
+{
+    VIDENCGRAY_TI_Obj *obj = (VIDENCGRAY_TI_Obj *)handle;
+    const IVIDENC_Params *params = (const IVIDENC_Params *)algParams;
+
+    GT_4trace(curTrace, GT_ENTER, "VIDENCGRAY_TI_initObj(0x%lx, 0x%lx, 0x%lx, "
+        "0x%lx)\n", handle, memTab, p, algParams);
+
+    obj->trace = curTrace;
+    obj->pScratch = (XDAS_UInt8 *)memTab[SCRATCHMEMTAB].base;
+    obj->scratchSize = memTab[SCRATCHMEMTAB].size;
+    obj->maxWidth = MAXWIDTH(params);
+
+    /* start out at the maximum geometry the creator asked for */
+    obj->width = obj->maxWidth;
+    obj->height = ((params != NULL) && (params->maxHeight > 0)) ?
+        params->maxHeight : HEIGHT;
+    obj->pitch = obj->width;
+
+    return (IALG_EOK);
+}
+
+
+/*
+ *  ======== VIDENCGRAY_TI_process ========
+ */
+XDAS_Int32 VIDENCGRAY_TI_process(IVIDENC_Handle h, XDM_BufDesc *inBufs,
+    XDM_BufDesc *outBufs, IVIDENC_InArgs *inArgs, IVIDENC_OutArgs *outArgs)
+{
+    VIDENCGRAY_TI_Obj *obj = (VIDENCGRAY_TI_Obj *)h;
+
+    /* validate arguments - this codec only supports "base" xDM. */
+    if ((inArgs->size != sizeof(*inArgs)) ||
+        (outArgs->size != sizeof(*outArgs))) {
+
+        GT_2trace(obj->trace, GT_ENTER, "VIDENCGRAY_TI_process, unsupported "
+            "size (0x%lx, 0x%lx)\n", inArgs->size, outArgs->size);
+
+        return (IVIDENC_EFAIL);
+    }
+
+    outArgs->extendedError = 0;
+    outArgs->bytesGenerated = 0;
+    outArgs->encodedFrameType = IVIDEO_I_FRAME;
+    outArgs->inputFrameSkip = IVIDEO_FRAME_ENCODED;
+    outArgs->reconBufs.numBufs = 0;     /* no reconstructed frames */
+
+    /*
+     *  One gray frame of the geometry set with XDM_SETPARAMS in
+     *  inBufs->bufs[0] is encoded into outBufs->bufs[0], which must have
+     *  room for the largest encoded frame of that geometry.
+     */
+    if ((inBufs->numBufs < MININBUFS) || (outBufs->numBufs < MINOUTBUFS) ||
+        (inBufs->bufSizes[0] < INFRAMESIZE(obj)) ||
+        (outBufs->bufSizes[0] < OUTFRAMESIZE(obj))) {
+
+        GT_2trace(obj->trace, GT_7CLASS, "VIDENCGRAY_TI_process> buffers "
+            "too small (in %d, out %d)\n",
+            (inBufs->numBufs < MININBUFS) ? 0 : inBufs->bufSizes[0],
+            (outBufs->numBufs < MINOUTBUFS) ? 0 : outBufs->bufSizes[0]);
+
+        XDM_SETINSUFFICIENTDATA(outArgs->extendedError);
+
+        return (IVIDENC_EFAIL);
+    }
+
+    outArgs->bytesGenerated = VIDENCGRAY_TI_encode(
+        (XDAS_UInt8 *)outBufs->bufs[0], (XDAS_UInt8 *)inBufs->bufs[0],
+        obj->pitch, obj->width, obj->height, obj->pScratch);
+
+    return (IVIDENC_EOK);
+}
+
+
+/*
+ *  ======== VIDENCGRAY_TI_control ========
+ */
+XDAS_Int32 VIDENCGRAY_TI_control(IVIDENC_Handle handle, IVIDENC_Cmd id,
+    IVIDENC_DynamicParams *params, IVIDENC_Status *status)
+{
+    VIDENCGRAY_TI_Obj *obj = (VIDENCGRAY_TI_Obj *)handle;
+    XDAS_Int32 retVal;
+
+    GT_4trace(obj->trace, GT_ENTER, "VIDENCGRAY_TI_control(0x%lx, 0x%lx, "
+        "0x%lx, 0x%lx)\n", handle, id, params, status);
+
+    /* validate arguments - this codec only supports "base" xDM. */
+    if ((params->size != sizeof(*params)) ||
+        (status->size != sizeof(*status))) {
+
+        GT_2trace(obj->trace, GT_ENTER, "VIDENCGRAY_TI_control, unsupported "
+            "size (0x%lx, 0x%lx)\n", params->size, status->size);
+
+        return (IVIDENC_EFAIL);
+    }
+
+    status->extendedError = 0;
+
+    switch (id) {
+        case XDM_GETSTATUS:
+        case XDM_GETBUFINFO:
+            status->bufInfo.minNumInBufs = MININBUFS;
+            status->bufInfo.minNumOutBufs = MINOUTBUFS;
+            status->bufInfo.minInBufSize[0] = INFRAMESIZE(obj);
+            status->bufInfo.minOutBufSize[0] = OUTFRAMESIZE(obj);
+
+            retVal = IVIDENC_EOK;
+            break;
+
+        case XDM_SETPARAMS:
+            /*
+             *  inputWidth x inputHeight gray pixels, captureWidth bytes
+             *  apart (0: tightly packed); no wider than the creator's
+             *  maxWidth, the scratch line is sized for that.
+             */
+            if ((params->inputWidth <= 0) || (params->inputHeight <= 0) ||
+                (params->inputWidth > obj->maxWidth) ||
+                ((params->captureWidth != 0) &&
+                 (params->captureWidth < params->inputWidth))) {
+
+                GT_3trace(obj->trace, GT_7CLASS, "VIDENCGRAY_TI_control> "
+                    "unsupported geometry %dx%d, pitch %d\n",
+                    params->inputWidth, params->inputHeight,
+                    params->captureWidth);
+
+                XDM_SETUNSUPPORTEDPARAM(status->extendedError);
+                retVal = IVIDENC_EFAIL;
+                break;
+            }
+
+            obj->width = params->inputWidth;
+            obj->height = params->inputHeight;
+            obj->pitch = params->captureWidth ? params->captureWidth :
+                params->inputWidth;
+
+            retVal = IVIDENC_EOK;
+            break;
+
+        case XDM_SETDEFAULT:
+            obj->width = (obj->maxWidth < WIDTH) ? obj->maxWidth : WIDTH;
+            obj->height = HEIGHT;
+            obj->pitch = obj->width;
+
+            retVal = IVIDENC_EOK;
+            break;
+
+        case XDM_RESET:
+        case XDM_FLUSH:
+            /* every frame is coded on its own, there is nothing to drop */
+            retVal = IVIDENC_EOK;
+            break;
+
+        default:
+            /* unsupported cmd */
+            retVal = IVIDENC_EFAIL;
+
+            break;
+    }
+
+    return (retVal);
+}
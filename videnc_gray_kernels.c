@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2010, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+/*
+ *  ======== videnc_gray_kernels.c ========
+ *  VIDENCGRAY encoder and decoder.
+ *
+ *  The encoder makes a line's codes in one pass over the line and the
+ *  line above, with no dependency from one pixel to the next, so it runs
+ *  16 pixels at a time where SIMD is available; it is the baseline on
+ *  x86-64 and AArch64, so no runtime dispatch is needed.  The decoder has
+ *  to go pixel by pixel since each prediction needs the pixel before it.
+ *  VIDENCCOPY_TI_NOSIMD builds the C code only here too.
+ */
+#include <xdc/std.h>
+#include <string.h>
+
+#include "videnc_gray_kernels.h"
+
+#if !defined(_TI_) && !defined(VIDENCCOPY_TI_NOSIMD) && defined(__GNUC__)
+#if defined(__SSE2__)
+#define VIDENCGRAY_TI_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VIDENCGRAY_TI_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(VIDENCGRAY_TI_SSE2)
+const String VIDENCGRAY_TI_kernelName = "sse2";
+#elif defined(VIDENCGRAY_TI_NEON)
+const String VIDENCGRAY_TI_kernelName = "neon";
+#else
+const String VIDENCGRAY_TI_kernelName = "c";
+#endif
+
+#define FIRSTPRED   128     /* prediction of the first pixel of a frame */
+
+#define HALF        (IVIDENCGRAY_GROUP / 2)
+
+/* a prediction error, modulo 256, to its code */
+#define CODE(p, pred)   ((XDAS_UInt8)((((XDAS_UInt32)((p) - (pred))) << 1) ^ \
+                         (0u - ((((XDAS_UInt32)((p) - (pred))) >> 7) & 1))))
+
+/* and back */
+#define ERROR(code)     (((code) >> 1) ^ -((code) & 1))
+
+/*
+ *  ======== MED ========
+ *  The median of a, b and a + b - c: a + b - c clamped to the range of a
+ *  and b, without branches on the pixel values.  The SIMD code works in
+ *  bytes and compares c to the range instead, which gives the same.
+ */
+#define MED(pred, a, b, c, lo, hi) \
+    (pred) = (a) + (b) - (c); \
+    (pred) = ((pred) < (lo)) ? (lo) : (pred); \
+    (pred) = ((pred) > (hi)) ? (hi) : (pred)
+
+/* bits of the largest value in 0 to 15 */
+static const XDAS_UInt8 nibbleBits[16] = {
+    0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4
+};
+
+/*
+ *  ======== codeLine ========
+ *  The codes of a line from its pixels and those of the line above, or
+ *  of the first line of a frame if pAbove is NULL.
+ */
+static Void codeLine(XDAS_UInt8 *pCodes, XDAS_UInt8 *pCur,
+    XDAS_UInt8 *pAbove, XDAS_Int32 width)
+{
+    XDAS_Int32 a, b, c;
+    XDAS_Int32 lo, hi, pred;
+    XDAS_Int32 x = 1;
+
+    if (pAbove == NULL) {
+        pCodes[0] = CODE(pCur[0], FIRSTPRED);
+        for (x = 1; x < width; x++) {
+            pCodes[x] = CODE(pCur[x], pCur[x - 1]);
+        }
+        return;
+    }
+
+    pCodes[0] = CODE(pCur[0], pAbove[0]);
+
+#if defined(VIDENCGRAY_TI_SSE2)
+    {
+        __m128i zero = _mm_setzero_si128();
+
+        for (; x + 16 <= width; x += 16) {
+            __m128i va = _mm_loadu_si128((const __m128i *)(pCur + x - 1));
+            __m128i vb = _mm_loadu_si128((const __m128i *)(pAbove + x));
+            __m128i vc = _mm_loadu_si128((const __m128i *)(pAbove + x - 1));
+            __m128i vx = _mm_loadu_si128((const __m128i *)(pCur + x));
+            __m128i vlo = _mm_min_epu8(va, vb);
+            __m128i vhi = _mm_max_epu8(va, vb);
+            __m128i geHi = _mm_cmpeq_epi8(_mm_max_epu8(vc, vhi), vc);
+            __m128i leLo = _mm_cmpeq_epi8(_mm_min_epu8(vc, vlo), vc);
+            __m128i pred = _mm_sub_epi8(_mm_add_epi8(va, vb), vc);
+            __m128i e;
+
+            pred = _mm_or_si128(_mm_and_si128(leLo, vhi),
+                _mm_andnot_si128(leLo, pred));
+            pred = _mm_or_si128(_mm_and_si128(geHi, vlo),
+                _mm_andnot_si128(geHi, pred));
+            e = _mm_sub_epi8(vx, pred);
+            e = _mm_xor_si128(_mm_add_epi8(e, e), _mm_cmpgt_epi8(zero, e));
+            _mm_storeu_si128((__m128i *)(pCodes + x), e);
+        }
+    }
+#elif defined(VIDENCGRAY_TI_NEON)
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t va = vld1q_u8(pCur + x - 1);
+        uint8x16_t vb = vld1q_u8(pAbove + x);
+        uint8x16_t vc = vld1q_u8(pAbove + x - 1);
+        uint8x16_t vlo = vminq_u8(va, vb);
+        uint8x16_t vhi = vmaxq_u8(va, vb);
+        uint8x16_t pred = vsubq_u8(vaddq_u8(va, vb), vc);
+        int8x16_t e;
+
+        pred = vbslq_u8(vcleq_u8(vc, vlo), vhi, pred);
+        pred = vbslq_u8(vcgeq_u8(vc, vhi), vlo, pred);
+        e = vreinterpretq_s8_u8(vsubq_u8(vld1q_u8(pCur + x), pred));
+        vst1q_u8(pCodes + x, veorq_u8(vreinterpretq_u8_s8(vaddq_s8(e, e)),
+            vreinterpretq_u8_s8(vshrq_n_s8(e, 7))));
+    }
+#endif
+
+    for (; x < width; x++) {
+        a = pCur[x - 1];
+        b = pAbove[x];
+        c = pAbove[x - 1];
+        lo = (a < b) ? a : b;
+        hi = (a < b) ? b : a;
+        MED(pred, a, b, c, lo, hi);
+        pCodes[x] = CODE(pCur[x], pred);
+    }
+}
+
+/*
+ *  ======== halfBits ========
+ *  Bits of the largest of the HALF codes at pCodes.
+ */
+static XDAS_Int32 halfBits(XDAS_UInt8 *pCodes)
+{
+    unsigned long long w0, w1;
+    XDAS_UInt32 v;
+    XDAS_Int32 n;
+
+    memcpy(&w0, pCodes, 8);
+    memcpy(&w1, pCodes + 8, 8);
+    w0 |= w1;
+    w0 |= w0 >> 32;
+    w0 |= w0 >> 16;
+    w0 |= w0 >> 8;
+    v = (XDAS_UInt32)w0 & 0xff;
+
+    /* without a branch, the codes' widths vary too much to predict */
+    n = (v >= 16) * 4;
+
+    return (n + nibbleBits[v >> n]);
+}
+
+/*
+ *  ======== pack ========
+ *  Write 8 codes of n bits as n bytes at pOut, return the end.  All 8
+ *  bytes are stored whatever n is, which saves a branch per group; those
+ *  past the first n are overwritten by what follows, or land in the
+ *  slack at the end of IVIDENCGRAY_MAXSIZE.
+ */
+static XDAS_UInt8 *pack(XDAS_UInt8 *pOut, XDAS_UInt8 *pCodes, XDAS_Int32 n)
+{
+    unsigned long long bits;
+
+    bits = (unsigned long long)pCodes[0] |
+        ((unsigned long long)pCodes[1] << n) |
+        ((unsigned long long)pCodes[2] << (2 * n)) |
+        ((unsigned long long)pCodes[3] << (3 * n)) |
+        ((unsigned long long)pCodes[4] << (4 * n)) |
+        ((unsigned long long)pCodes[5] << (5 * n)) |
+        ((unsigned long long)pCodes[6] << (6 * n)) |
+        ((unsigned long long)pCodes[7] << (7 * n));
+
+    pOut[0] = (XDAS_UInt8)bits;
+    pOut[1] = (XDAS_UInt8)(bits >> 8);
+    pOut[2] = (XDAS_UInt8)(bits >> 16);
+    pOut[3] = (XDAS_UInt8)(bits >> 24);
+    pOut[4] = (XDAS_UInt8)(bits >> 32);
+    pOut[5] = (XDAS_UInt8)(bits >> 40);
+    pOut[6] = (XDAS_UInt8)(bits >> 48);
+    pOut[7] = (XDAS_UInt8)(bits >> 56);
+
+    return (pOut + n);
+}
+
+/*
+ *  ======== unpack ========
+ *  Read 8 codes of n bits from pIn, return the end.  Reads 8 bytes
+ *  whatever n is, the caller makes sure there are.
+ */
+static XDAS_UInt8 *unpack(XDAS_UInt8 *pCodes, XDAS_UInt8 *pIn, XDAS_Int32 n)
+{
+    unsigned long long bits;
+    XDAS_UInt32 mask = (1u << n) - 1;
+
+    bits = (unsigned long long)pIn[0] |
+        ((unsigned long long)pIn[1] << 8) |
+        ((unsigned long long)pIn[2] << 16) |
+        ((unsigned long long)pIn[3] << 24) |
+        ((unsigned long long)pIn[4] << 32) |
+        ((unsigned long long)pIn[5] << 40) |
+        ((unsigned long long)pIn[6] << 48) |
+        ((unsigned long long)pIn[7] << 56);
+
+    pCodes[0] = (XDAS_UInt8)(bits & mask);
+    pCodes[1] = (XDAS_UInt8)((bits >> n) & mask);
+    pCodes[2] = (XDAS_UInt8)((bits >> (2 * n)) & mask);
+    pCodes[3] = (XDAS_UInt8)((bits >> (3 * n)) & mask);
+    pCodes[4] = (XDAS_UInt8)((bits >> (4 * n)) & mask);
+    pCodes[5] = (XDAS_UInt8)((bits >> (5 * n)) & mask);
+    pCodes[6] = (XDAS_UInt8)((bits >> (6 * n)) & mask);
+    pCodes[7] = (XDAS_UInt8)((bits >> (7 * n)) & mask);
+
+    return (pIn + n);
+}
+
+/*
+ *  ======== VIDENCGRAY_TI_encode ========
+ */
+XDAS_Int32 VIDENCGRAY_TI_encode(XDAS_UInt8 *pOut, XDAS_UInt8 *pGray,
+    XDAS_Int32 pitch, XDAS_Int32 width, XDAS_Int32 height,
+    XDAS_UInt8 *pScratch)
+{
+    IVIDENCGRAY_FrameHeader *hdr = (IVIDENCGRAY_FrameHeader *)pOut;
+    XDAS_UInt8 *p = pOut + sizeof(*hdr);
+    XDAS_UInt8 *pCur = pGray;
+    XDAS_Int32 n0, n1;
+    XDAS_Int32 x, y;
+
+    /* the padding at the end of the line codes as 0 */
+    memset(pScratch + width, 0, VIDENCGRAY_TI_SCRATCHSIZE(width) - width);
+
+    for (y = 0; y < height; y++, pCur += pitch) {
+        codeLine(pScratch, pCur, (y == 0) ? NULL : pCur - pitch, width);
+
+        for (x = 0; x < width; x += IVIDENCGRAY_GROUP) {
+            n0 = halfBits(pScratch + x);
+            n1 = halfBits(pScratch + x + HALF);
+
+            *p++ = (XDAS_UInt8)(n0 | (n1 << 4));
+            p = pack(p, pScratch + x, n0);
+            p = pack(p, pScratch + x + 8, n0);
+            p = pack(p, pScratch + x + HALF, n1);
+            p = pack(p, pScratch + x + HALF + 8, n1);
+        }
+    }
+
+    hdr->magic = IVIDENCGRAY_MAGIC;
+    hdr->size = p - pOut;
+    hdr->width = width;
+    hdr->height = height;
+
+    return (p - pOut);
+}
+
+/*
+ *  ======== VIDENCGRAY_TI_decode ========
+ */
+Int VIDENCGRAY_TI_decode(XDAS_UInt8 *pGray, XDAS_Int32 pitch,
+    XDAS_Int32 outSize, XDAS_UInt8 *pIn, XDAS_Int32 size)
+{
+    IVIDENCGRAY_FrameHeader *hdr = (IVIDENCGRAY_FrameHeader *)pIn;
+    XDAS_UInt8 codes[IVIDENCGRAY_GROUP];
+    XDAS_UInt8 tail[IVIDENCGRAY_GROUP + 8];
+    XDAS_UInt8 *p = pIn + sizeof(*hdr);
+    XDAS_UInt8 *end;
+    XDAS_UInt8 *pCur = pGray;
+    XDAS_UInt8 *pAbove;
+    XDAS_UInt8 *pSrc;
+    XDAS_UInt8 *pX;
+    XDAS_Int32 width;
+    XDAS_Int32 a, b, c;
+    XDAS_Int32 lo, hi, pred;
+    XDAS_Int32 n0, n1;
+    XDAS_Int32 x, y, i, k;
+
+    if ((size < (XDAS_Int32)sizeof(*hdr)) ||
+        (hdr->magic != IVIDENCGRAY_MAGIC) || (hdr->size > (XDAS_UInt32)size) ||
+        (hdr->width <= 0) || (hdr->height <= 0)) {
+        return (-1);
+    }
+
+    /* the header is not to be trusted with the size of pGray */
+    if ((hdr->width > pitch) || (hdr->height > outSize / pitch)) {
+        return (-1);
+    }
+    end = pIn + hdr->size;
+    width = hdr->width;
+
+    for (y = 0; y < hdr->height; y++, pCur += pitch) {
+        pAbove = pCur - pitch;
+
+        for (x = 0; x < width; x += IVIDENCGRAY_GROUP) {
+            if (p >= end) {
+                return (-1);
+            }
+            n0 = *p & 0xf;
+            n1 = *p++ >> 4;
+            if ((n0 > 8) || (n1 > 8) || (end - p < 2 * (n0 + n1))) {
+                return (-1);
+            }
+
+            /* near the end, unpack from a copy with room to read ahead */
+            pSrc = p;
+            if (end - p < IVIDENCGRAY_GROUP) {
+                memset(tail, 0, sizeof(tail));
+                memcpy(tail, p, 2 * (n0 + n1));
+                pSrc = tail;
+            }
+            pSrc = unpack(codes, pSrc, n0);
+            pSrc = unpack(codes + 8, pSrc, n0);
+            pSrc = unpack(codes + HALF, pSrc, n1);
+            unpack(codes + HALF + 8, pSrc, n1);
+            p += 2 * (n0 + n1);
+
+            k = (width - x < IVIDENCGRAY_GROUP) ? width - x :
+                IVIDENCGRAY_GROUP;
+            pX = pCur + x;
+            i = 0;
+
+            if (x == 0) {
+                pX[0] = (XDAS_UInt8)(((y == 0) ? FIRSTPRED : pAbove[0]) +
+                    ERROR(codes[0]));
+                i = 1;
+            }
+
+            /* a is kept from one pixel to the next, not read back */
+            a = pX[i - 1];
+            if (y == 0) {
+                for (; i < k; i++) {
+                    a = (a + ERROR(codes[i])) & 0xff;
+                    pX[i] = (XDAS_UInt8)a;
+                }
+            }
+            else {
+                for (; i < k; i++) {
+                    b = pAbove[x + i];
+                    c = pAbove[x + i - 1];
+                    lo = (a < b) ? a : b;
+                    hi = (a < b) ? b : a;
+                    MED(pred, a, b, c, lo, hi);
+                    a = (pred + ERROR(codes[i])) & 0xff;
+                    pX[i] = (XDAS_UInt8)a;
+                }
+            }
+        }
+    }
+
+    return (0);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2010, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+/*
+ *  ======== videnc_gray_kernels.h ========
+ *  Encoder and decoder of the VIDENCGRAY stream format, see
+ *  ividencgray.h.  Both are plain functions of a frame, so a reader
+ *  can decode recordings without an engine.
+ */
+#ifndef VIDENCGRAY_KERNELS_
+#define VIDENCGRAY_KERNELS_
+
+#include <ti/xdais/xdas.h>
+
+#include "ividencgray.h"
+
+/* bytes of the line of codes the encoder works through */
+#define VIDENCGRAY_TI_SCRATCHSIZE(w) \
+    ((((w) + IVIDENCGRAY_GROUP - 1) / IVIDENCGRAY_GROUP) * IVIDENCGRAY_GROUP)
+
+/* the instruction set the encoder was built for, "c" without SIMD */
+extern const String VIDENCGRAY_TI_kernelName;
+
+/*
+ *  ======== VIDENCGRAY_TI_encode ========
+ *  Encode the gray image of height lines of width pixels at pGray, pitch
+ *  bytes apart, into pOut, which must hold IVIDENCGRAY_MAXSIZE(width,
+ *  height) bytes.  pScratch is VIDENCGRAY_TI_SCRATCHSIZE(width) bytes of
+ *  working memory.  Returns the size of the encoded frame.
+ */
+extern XDAS_Int32 VIDENCGRAY_TI_encode(XDAS_UInt8 *pOut, XDAS_UInt8 *pGray,
+    XDAS_Int32 pitch, XDAS_Int32 width, XDAS_Int32 height,
+    XDAS_UInt8 *pScratch);
+
+/*
+ *  ======== VIDENCGRAY_TI_decode ========
+ *  Decode the frame of size bytes at pIn into the outSize bytes at pGray,
+ *  pitch bytes between lines.  Returns 0, or -1 if the frame is truncated,
+ *  not a VIDENCGRAY frame, or its header's width and height don't fit.
+ */
+extern Int VIDENCGRAY_TI_decode(XDAS_UInt8 *pGray, XDAS_Int32 pitch,
+    XDAS_Int32 outSize, XDAS_UInt8 *pIn, XDAS_Int32 size);
+
+#endif
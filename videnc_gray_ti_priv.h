@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2010, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+/*
+ *  ======== videnc_gray_ti_priv.h ========
+ *  Internal vendor specific (TI) interface header for the VIDENCGRAY
+ *  algorithm.  Only the implementation source files include this
+ *  header; it is not shipped as part of the algorithm.
+ */
+#ifndef VIDENCGRAY_TI_PRIV_
+#define VIDENCGRAY_TI_PRIV_
+
+typedef struct VIDENCGRAY_TI_Obj {
+    IALG_Obj    alg;            /* MUST be first field of all XDAS algs */
+
+    GT_Mask     trace;          /* this instance's copy of the module mask */
+    XDAS_Int32  width;          /* pixels per input line */
+    XDAS_Int32  height;         /* lines per input frame */
+    XDAS_Int32  pitch;          /* bytes between input lines */
+    XDAS_Int32  maxWidth;       /* the widest line pScratch can code */
+    XDAS_UInt8 *pScratch;       /* codes of the line being encoded */
+    XDAS_Int32  scratchSize;
+} VIDENCGRAY_TI_Obj;
+
+extern Int VIDENCGRAY_TI_alloc(const IALG_Params *algParams, IALG_Fxns **pf,
+    IALG_MemRec memTab[]);
+
+extern Int VIDENCGRAY_TI_free(IALG_Handle handle, IALG_MemRec memTab[]);
+
+extern Int VIDENCGRAY_TI_initObj(IALG_Handle handle,
+    const IALG_MemRec memTab[], IALG_Handle parent,
+    const IALG_Params *algParams);
+
+extern XDAS_Int32 VIDENCGRAY_TI_process(IVIDENC_Handle h, XDM_BufDesc *inBufs,
+    XDM_BufDesc *outBufs, IVIDENC_InArgs *inArgs, IVIDENC_OutArgs *outArgs);
+
+extern XDAS_Int32 VIDENCGRAY_TI_control(IVIDENC_Handle handle,
+    IVIDENC_Cmd id, IVIDENC_DynamicParams *params, IVIDENC_Status *status);
+
+#endif
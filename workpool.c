@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2010, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+/*
+ *  ======== workpool.c ========
+ *  Work-stealing thread pool, see workpool.h.
+ *
+ *  The deques are short (one entry per chain at most) and a task is a
+ *  whole VIDDEC_process() call, so each deque is simply guarded by its
+ *  own mutex.  Workers that find nothing to run or steal sleep on the
+ *  pool condition; a push only takes the pool lock when somebody sleeps.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "workpool.h"
+
+#define CACHELINE   64
+
+typedef struct Deque {
+    pthread_mutex_t lock;
+    void          **tasks;      /* ring of capacity entries */
+    int             top;        /* oldest task, the one thieves take */
+    int             count;
+    unsigned long   executed;   /* owner only */
+    unsigned long   stolen;     /* owner only */
+} __attribute__((aligned(CACHELINE))) Deque;
+
+typedef struct Worker {
+    WorkPool       *pool;
+    int             id;
+} Worker;
+
+struct WorkPool {
+    int             numWorkers;
+    int             capacity;
+    Deque          *deques;
+
+    pthread_mutex_t lock;       /* guards sleeping, not the deques */
+    pthread_cond_t  wake;
+    int             idle;       /* workers asleep or about to be */
+    int             pending;    /* tasks queued or running */
+
+    WorkPool_Fxn    fxn;
+    void           *arg;
+};
+
+/*
+ *  ======== take ========
+ *  Remove the newest (owner) or the oldest (thief) task of a deque.
+ */
+static void *take(WorkPool *pool, Deque *d, int newest)
+{
+    void *task = NULL;
+
+    pthread_mutex_lock(&d->lock);
+
+    if (d->count > 0) {
+        d->count--;
+        if (newest) {
+            task = d->tasks[(d->top + d->count) % pool->capacity];
+        }
+        else {
+            task = d->tasks[d->top];
+            d->top = (d->top + 1) % pool->capacity;
+        }
+    }
+
+    pthread_mutex_unlock(&d->lock);
+
+    return (task);
+}
+
+/*
+ *  ======== findTask ========
+ *  Own deque first, then steal, starting with the next worker so thieves
+ *  spread over the victims.
+ */
+static void *findTask(WorkPool *pool, int worker)
+{
+    void *task;
+    int i;
+
+    if ((task = take(pool, &pool->deques[worker], 1)) != NULL) {
+        return (task);
+    }
+
+    for (i = 1; i < pool->numWorkers; i++) {
+        task = take(pool, &pool->deques[(worker + i) % pool->numWorkers], 0);
+        if (task != NULL) {
+            pool->deques[worker].stolen++;
+            return (task);
+        }
+    }
+
+    return (NULL);
+}
+
+/*
+ *  ======== workerThread ========
+ */
+static void *workerThread(void *arg)
+{
+    Worker *w = (Worker *)arg;
+    WorkPool *pool = w->pool;
+    void *task;
+
+    for (;;) {
+        if ((task = findTask(pool, w->id)) == NULL) {
+
+            pthread_mutex_lock(&pool->lock);
+            __atomic_add_fetch(&pool->idle, 1, __ATOMIC_SEQ_CST);
+
+            /*
+             * Look again after announcing ourselves: a push that missed
+             * the idle count is seen here, any later one signals us.
+             */
+            while ((__atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) > 0) &&
+                ((task = findTask(pool, w->id)) == NULL)) {
+                pthread_cond_wait(&pool->wake, &pool->lock);
+            }
+
+            __atomic_sub_fetch(&pool->idle, 1, __ATOMIC_SEQ_CST);
+            pthread_mutex_unlock(&pool->lock);
+
+            if (task == NULL) {
+                break;  /* nothing pending, all done */
+            }
+        }
+
+        pool->fxn(pool, w->id, task, pool->arg);
+        pool->deques[w->id].executed++;
+
+        if (__atomic_sub_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST) == 0) {
+            pthread_mutex_lock(&pool->lock);
+            pthread_cond_broadcast(&pool->wake);
+            pthread_mutex_unlock(&pool->lock);
+        }
+    }
+
+    return (NULL);
+}
+
+/*
+ *  ======== WorkPool_create ========
+ */
+WorkPool *WorkPool_create(int numWorkers, int capacity)
+{
+    WorkPool *pool;
+    void *deques;
+    int i;
+
+    if ((numWorkers < 1) || (capacity < 1) ||
+        ((pool = (WorkPool *)calloc(1, sizeof(*pool))) == NULL)) {
+        return (NULL);
+    }
+
+    /* one deque per cache line, the owners update them all the time */
+    if (posix_memalign(&deques, CACHELINE, numWorkers * sizeof(Deque)) != 0) {
+        free(pool);
+        return (NULL);
+    }
+
+    pool->numWorkers = numWorkers;
+    pool->capacity = capacity;
+    pool->deques = (Deque *)deques;
+    memset(pool->deques, 0, numWorkers * sizeof(Deque));
+
+    for (i = 0; i < numWorkers; i++) {
+        pool->deques[i].tasks = (void **)calloc(capacity, sizeof(void *));
+        if (pool->deques[i].tasks == NULL) {
+            pool->numWorkers = i;
+            WorkPool_delete(pool);
+            return (NULL);
+        }
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+
+    return (pool);
+}
+
+/*
+ *  ======== WorkPool_delete ========
+ */
+void WorkPool_delete(WorkPool *pool)
+{
+    int i;
+
+    for (i = 0; i < pool->numWorkers; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+
+    free(pool->deques);
+    free(pool);
+}
+
+/*
+ *  ======== WorkPool_push ========
+ */
+void WorkPool_push(WorkPool *pool, int worker, void *task)
+{
+    Deque *d = &pool->deques[worker];
+
+    /* count it before anyone can take it */
+    __atomic_add_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST);
+
+    pthread_mutex_lock(&d->lock);
+
+    if (d->count == pool->capacity) {
+        fprintf(stderr, "WorkPool_push: worker %d deque full\n", worker);
+        abort();
+    }
+
+    d->tasks[(d->top + d->count) % pool->capacity] = task;
+    d->count++;
+
+    pthread_mutex_unlock(&d->lock);
+
+    if (__atomic_load_n(&pool->idle, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+/*
+ *  ======== WorkPool_run ========
+ */
+int WorkPool_run(WorkPool *pool, WorkPool_Fxn fxn, void *arg)
+{
+    pthread_t *threads;
+    Worker *workers;
+    int started = 0;
+    int i;
+
+    threads = (pthread_t *)calloc(pool->numWorkers, sizeof(pthread_t));
+    workers = (Worker *)calloc(pool->numWorkers, sizeof(Worker));
+    if ((threads == NULL) || (workers == NULL)) {
+        free(threads);
+        free(workers);
+        return (0);
+    }
+
+    pool->fxn = fxn;
+    pool->arg = arg;
+
+    for (i = 0; i < pool->numWorkers; i++) {
+        pool->deques[i].executed = 0;
+        pool->deques[i].stolen = 0;
+        workers[i].pool = pool;
+        workers[i].id = i;
+    }
+
+    /* fewer threads only means more stealing; worker 0 always runs */
+    for (i = 1; i < pool->numWorkers; i++) {
+        if (pthread_create(&threads[i], NULL, workerThread, &workers[i]) != 0) {
+            break;
+        }
+        started++;
+    }
+
+    workerThread(&workers[0]);
+
+    for (i = 1; i <= started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    free(threads);
+    free(workers);
+
+    return (started + 1);
+}
+
+/*
+ *  ======== WorkPool_numWorkers ========
+ */
+int WorkPool_numWorkers(WorkPool *pool)
+{
+    return (pool->numWorkers);
+}
+
+/*
+ *  ======== WorkPool_stats ========
+ */
+void WorkPool_stats(WorkPool *pool, int worker, unsigned long *executed,
+    unsigned long *stolen)
+{
+    *executed = pool->deques[worker].executed;
+    *stolen = pool->deques[worker].stolen;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2010, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+/*
+ *  ======== workpool.h ========
+ *  Work-stealing thread pool used by the app to run many codec
+ *  instances at once.
+ *
+ *  Every worker owns a deque of tasks.  A worker pushes and pops at the
+ *  bottom of its own deque and, when that is empty, steals from the top
+ *  of the others.  A task that has more work to do pushes its successor
+ *  from inside the task function; as long as each chain has at most one
+ *  task queued or running, the work of one chain never runs on two
+ *  workers at once.  WorkPool_run() returns when no tasks are left.
+ */
+#ifndef WORKPOOL_
+#define WORKPOOL_
+
+typedef struct WorkPool WorkPool;
+
+/* runs one task on worker, arg is the one passed to WorkPool_run() */
+typedef void (*WorkPool_Fxn)(WorkPool *pool, int worker, void *task,
+    void *arg);
+
+/* numWorkers threads, each deque holds up to capacity tasks */
+extern WorkPool *WorkPool_create(int numWorkers, int capacity);
+
+extern void WorkPool_delete(WorkPool *pool);
+
+/* queue task on worker's deque; from a task, pass the running worker */
+extern void WorkPool_push(WorkPool *pool, int worker, void *task);
+
+/*
+ * run the queued tasks and their successors to completion on the calling
+ * thread and numWorkers - 1 new ones; returns how many workers ran
+ */
+extern int WorkPool_run(WorkPool *pool, WorkPool_Fxn fxn, void *arg);
+
+extern int WorkPool_numWorkers(WorkPool *pool);
+
+/* tasks worker ran in the last WorkPool_run(), and how many it stole */
+extern void WorkPool_stats(WorkPool *pool, int worker,
+    unsigned long *executed, unsigned long *stolen);
+
+#endif
@@ -0,0 +1,788 @@
+/*
+ * Copyright (c) 2010, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+/*
+ *  ======== writer.c ========
+ *  Asynchronous output writer, see writer.h.
+ *
+ *  The io_uring version needs no thread: writes and syncs are queued on
+ *  the submission ring, and Writer_get() reaps completions on the
+ *  calling thread, waiting only when no buffer is free.  Every write
+ *  has its own file offset, so completions may come in any order.  A
+ *  sync is queued with IOSQE_IO_DRAIN, so it covers all writes before
+ *  it.
+ *
+ *  The thread version queues buffers to a writer thread, which writes
+ *  them in order and gives them back under the writer's lock.
+ */
+#define _GNU_SOURCE     /* O_DIRECT */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && \
+    defined(__NR_io_uring_register)
+#define HAVE_IO_URING
+#endif
+#endif
+#endif
+
+#include "writer.h"
+
+#define SYNCDATA    (~0ULL)     /* user_data of a sync, not a buffer */
+
+typedef struct Slot {
+    off_t           offset;     /* where the buffer goes in the file */
+    int             size;       /* bytes to write */
+    int             done;       /* bytes written so far */
+} Slot;
+
+struct Writer {
+    int             fd;
+    int             direct;     /* fd has O_DIRECT */
+    int             depth;
+    int             bufSize;
+    int             syncEvery;
+    int             sinceSync;  /* writes since the last sync */
+    void          (*doneFxn)(void *arg, void *buf);
+    void           *doneArg;
+    off_t           offset;     /* where the next Writer_put() goes */
+
+    char           *mem;        /* depth buffers of bufSize bytes */
+    Slot           *slots;
+    int            *free;       /* stack of free buffer indices */
+    int             numFree;
+
+    int             error;      /* errno of the first failure */
+    unsigned long   writes;
+    unsigned long long bytes;
+    unsigned long   waits;
+
+    int             uring;      /* io_uring fd, -1 for the writer thread */
+#ifdef HAVE_IO_URING
+    unsigned       *sqHead;
+    unsigned       *sqTail;
+    unsigned       *sqMask;
+    unsigned       *sqArray;
+    unsigned        sqEntries;
+    struct io_uring_sqe *sqes;
+    unsigned       *cqHead;
+    unsigned       *cqTail;
+    unsigned       *cqMask;
+    struct io_uring_cqe *cqes;
+    void           *sqRing;
+    size_t          sqRingSize;
+    void           *cqRing;     /* sqRing with IORING_FEAT_SINGLE_MMAP */
+    size_t          cqRingSize;
+    size_t          sqesSize;
+    unsigned        inFlight;   /* submitted, completion not seen yet */
+#endif
+
+    pthread_t       thread;
+    pthread_mutex_t lock;       /* guards the fields below and free */
+    pthread_cond_t  work;       /* a buffer was queued, or quit */
+    pthread_cond_t  done;       /* a buffer came back */
+    int            *queue;      /* ring of buffers to write, in order; */
+                                /* with io_uring, short writes to resume */
+    int             qHead;
+    int             qCount;
+    int             quit;
+};
+
+/*
+ *  ======== fail ========
+ *  Keep the first error, that is the one Writer_put() reports.
+ */
+static void fail(Writer *w, int error)
+{
+    if (w->error == 0) {
+        w->error = error;
+    }
+}
+
+/*
+ *  ======== writeSlot ========
+ *  Write buffer i with pwrite(), resuming after short writes.
+ */
+static int writeSlot(Writer *w, int i)
+{
+    Slot *slot = &w->slots[i];
+    ssize_t n;
+
+    while (slot->done < slot->size) {
+        n = pwrite(w->fd, w->mem + (size_t)i * w->bufSize + slot->done,
+            slot->size - slot->done, slot->offset + slot->done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return (errno);
+        }
+        if (n == 0) {
+            return (EIO);
+        }
+        slot->done += n;
+    }
+
+    return (0);
+}
+
+/*
+ *  ======== writerThread ========
+ */
+static void *writerThread(void *arg)
+{
+    Writer *w = (Writer *)arg;
+    int error;
+    int i;
+
+    pthread_mutex_lock(&w->lock);
+
+    for (;;) {
+        while ((w->qCount == 0) && !w->quit) {
+            pthread_cond_wait(&w->work, &w->lock);
+        }
+        if (w->qCount == 0) {
+            break;      /* quit, and everything is written */
+        }
+
+        i = w->queue[w->qHead];
+        w->qHead = (w->qHead + 1) % w->depth;
+        w->qCount--;
+
+        pthread_mutex_unlock(&w->lock);
+
+        error = writeSlot(w, i);
+        if ((error == 0) && (w->syncEvery > 0) &&
+            (++w->sinceSync >= w->syncEvery)) {
+            w->sinceSync = 0;
+            error = (fdatasync(w->fd) == 0) ? 0 : errno;
+        }
+
+        if ((error == 0) && (w->doneFxn != NULL)) {
+            w->doneFxn(w->doneArg, w->mem + (size_t)i * w->bufSize);
+        }
+
+        pthread_mutex_lock(&w->lock);
+
+        if (error != 0) {
+            fail(w, error);
+        }
+        else {
+            w->writes++;
+            w->bytes += w->slots[i].size;
+        }
+
+        w->free[w->numFree++] = i;
+        pthread_cond_signal(&w->done);
+    }
+
+    pthread_mutex_unlock(&w->lock);
+
+    return (NULL);
+}
+
+#ifdef HAVE_IO_URING
+/*
+ *  ======== uringEnter ========
+ */
+static int uringEnter(Writer *w, unsigned toSubmit, unsigned minComplete)
+{
+    int ret;
+
+    do {
+        ret = syscall(__NR_io_uring_enter, w->uring, toSubmit, minComplete,
+            minComplete > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while ((ret < 0) && (errno == EINTR));
+
+    return (ret);
+}
+
+static void submitWrite(Writer *w, int i);
+
+/*
+ *  ======== reap ========
+ *  Handle the completions there are, after waiting for one if wait is
+ *  set and anything is in flight.  The rest of a short write is only
+ *  queued once the completions are consumed: getSqe() may reap again.
+ */
+static void reap(Writer *w, int wait)
+{
+    struct io_uring_cqe *cqe;
+    unsigned head;
+    unsigned tail;
+    Slot *slot;
+    int i;
+
+    if (wait && (w->inFlight > 0) && (uringEnter(w, 0, 1) < 0)) {
+        fail(w, errno);
+    }
+
+    head = *w->cqHead;
+    tail = __atomic_load_n(w->cqTail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++) {
+        cqe = &w->cqes[head & *w->cqMask];
+        w->inFlight--;
+
+        if (cqe->user_data == SYNCDATA) {
+            if (cqe->res < 0) {
+                fail(w, -cqe->res);
+            }
+            continue;
+        }
+
+        i = (int)cqe->user_data;
+        slot = &w->slots[i];
+
+        if (cqe->res <= 0) {
+            fail(w, (cqe->res < 0) ? -cqe->res : EIO);
+        }
+        else if ((slot->done += cqe->res) < slot->size) {
+            w->queue[w->qCount++] = i;  /* short write, resume it below */
+            continue;
+        }
+        else {
+            w->writes++;
+            w->bytes += slot->size;
+            if (w->doneFxn != NULL) {
+                w->doneFxn(w->doneArg, w->mem + (size_t)i * w->bufSize);
+            }
+        }
+
+        w->free[w->numFree++] = i;
+    }
+
+    __atomic_store_n(w->cqHead, head, __ATOMIC_RELEASE);
+
+    while (w->qCount > 0) {
+        submitWrite(w, w->queue[--w->qCount]);
+    }
+}
+
+/*
+ *  ======== getSqe ========
+ *  The next submission entry, once there is room for its completion.
+ */
+static struct io_uring_sqe *getSqe(Writer *w)
+{
+    struct io_uring_sqe *sqe;
+    unsigned tail = *w->sqTail;
+    unsigned index = tail & *w->sqMask;
+
+    while (w->inFlight >= w->sqEntries) {
+        reap(w, 1);
+    }
+
+    sqe = &w->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    w->sqArray[index] = index;
+
+    return (sqe);
+}
+
+/*
+ *  ======== submitSqe ========
+ *  Submit the entry getSqe() handed out.  One the kernel doesn't take is
+ *  taken back, so no reap() waits for its completion, and its buffer is
+ *  free again.
+ */
+static void submitSqe(Writer *w)
+{
+    unsigned tail = *w->sqTail;
+    struct io_uring_sqe *sqe = &w->sqes[tail & *w->sqMask];
+
+    __atomic_store_n(w->sqTail, tail + 1, __ATOMIC_RELEASE);
+    w->inFlight++;
+
+    if (uringEnter(w, 1, 0) < 0) {
+        fail(w, errno);
+
+        if (__atomic_load_n(w->sqHead, __ATOMIC_ACQUIRE) == tail) {
+            __atomic_store_n(w->sqTail, tail, __ATOMIC_RELEASE);
+            w->inFlight--;
+            if (sqe->user_data != SYNCDATA) {
+                w->free[w->numFree++] = (int)sqe->user_data;
+            }
+        }
+    }
+}
+
+/*
+ *  ======== submitWrite ========
+ *  Queue what is left to write of buffer i.
+ */
+static void submitWrite(Writer *w, int i)
+{
+    Slot *slot = &w->slots[i];
+    struct io_uring_sqe *sqe = getSqe(w);
+
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = w->fd;
+    sqe->addr = (unsigned long)(w->mem + (size_t)i * w->bufSize + slot->done);
+    sqe->len = slot->size - slot->done;
+    sqe->off = slot->offset + slot->done;
+    sqe->user_data = i;
+
+    submitSqe(w);
+}
+
+/*
+ *  ======== submitSync ========
+ *  Queue an fdatasync that starts once all writes before it are done.
+ */
+static void submitSync(Writer *w)
+{
+    struct io_uring_sqe *sqe = getSqe(w);
+
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->fd = w->fd;
+    sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+    sqe->flags = IOSQE_IO_DRAIN;
+    sqe->user_data = SYNCDATA;
+
+    submitSqe(w);
+}
+
+/*
+ *  ======== uringProbe ========
+ *  Whether the ring takes IORING_OP_WRITE.  Kernels before 5.6 have
+ *  io_uring without it, and without the probe, which fails then.
+ */
+static int uringProbe(Writer *w)
+{
+    struct io_uring_probe *probe;
+    size_t size = sizeof(*probe) +
+        (IORING_OP_WRITE + 1) * sizeof(struct io_uring_probe_op);
+    int ok;
+
+    if ((probe = calloc(1, size)) == NULL) {
+        return (0);
+    }
+
+    ok = (syscall(__NR_io_uring_register, w->uring, IORING_REGISTER_PROBE,
+        probe, IORING_OP_WRITE + 1) == 0) &&
+        (probe->last_op >= IORING_OP_WRITE) &&
+        (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+
+    free(probe);
+
+    return (ok);
+}
+
+/*
+ *  ======== uringCreate ========
+ *  Set up a ring with room for a write and a sync per buffer; returns
+ *  -1 if the kernel won't or can't write with it, the writer thread is
+ *  used then.
+ */
+static int uringCreate(Writer *w)
+{
+    struct io_uring_params p;
+    char *sq;
+    char *cq;
+
+    memset(&p, 0, sizeof(p));
+
+    if ((w->uring = syscall(__NR_io_uring_setup, 2 * w->depth, &p)) < 0) {
+        return (-1);
+    }
+
+    if (!uringProbe(w)) {
+        close(w->uring);
+        w->uring = -1;
+        return (-1);
+    }
+
+    w->sqEntries = p.sq_entries;
+    w->sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    w->cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    w->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (w->cqRingSize > w->sqRingSize) {
+            w->sqRingSize = w->cqRingSize;
+        }
+        w->cqRingSize = 0;
+    }
+
+    w->sqRing = mmap(NULL, w->sqRingSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, w->uring, IORING_OFF_SQ_RING);
+    w->cqRing = (w->cqRingSize == 0) ? w->sqRing : mmap(NULL, w->cqRingSize,
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, w->uring,
+        IORING_OFF_CQ_RING);
+    w->sqes = mmap(NULL, w->sqesSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, w->uring, IORING_OFF_SQES);
+
+    if ((w->sqRing == MAP_FAILED) || (w->cqRing == MAP_FAILED) ||
+        (w->sqes == MAP_FAILED)) {
+
+        if (w->sqes != MAP_FAILED) {
+            munmap(w->sqes, w->sqesSize);
+        }
+        if ((w->cqRingSize != 0) && (w->cqRing != MAP_FAILED)) {
+            munmap(w->cqRing, w->cqRingSize);
+        }
+        if (w->sqRing != MAP_FAILED) {
+            munmap(w->sqRing, w->sqRingSize);
+        }
+        close(w->uring);
+        w->uring = -1;
+
+        return (-1);
+    }
+
+    sq = (char *)w->sqRing;
+    cq = (char *)w->cqRing;
+
+    w->sqHead = (unsigned *)(sq + p.sq_off.head);
+    w->sqTail = (unsigned *)(sq + p.sq_off.tail);
+    w->sqMask = (unsigned *)(sq + p.sq_off.ring_mask);
+    w->sqArray = (unsigned *)(sq + p.sq_off.array);
+    w->cqHead = (unsigned *)(cq + p.cq_off.head);
+    w->cqTail = (unsigned *)(cq + p.cq_off.tail);
+    w->cqMask = (unsigned *)(cq + p.cq_off.ring_mask);
+    w->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    w->inFlight = 0;
+
+    return (0);
+}
+
+/*
+ *  ======== uringDelete ========
+ */
+static void uringDelete(Writer *w)
+{
+    while (w->inFlight > 0) {
+        reap(w, 1);
+    }
+
+    munmap(w->sqes, w->sqesSize);
+    if (w->cqRingSize != 0) {
+        munmap(w->cqRing, w->cqRingSize);
+    }
+    munmap(w->sqRing, w->sqRingSize);
+    close(w->uring);
+}
+#endif
+
+/*
+ *  ======== drain ========
+ *  Wait until every buffer but the held ones the caller has is back.
+ */
+static void drain(Writer *w, int held)
+{
+#ifdef HAVE_IO_URING
+    if (w->uring >= 0) {
+        while (w->inFlight > 0) {
+            reap(w, 1);
+        }
+        return;
+    }
+#endif
+
+    pthread_mutex_lock(&w->lock);
+    while (w->numFree < w->depth - held) {
+        pthread_cond_wait(&w->done, &w->lock);
+    }
+    pthread_mutex_unlock(&w->lock);
+}
+
+/*
+ *  ======== Writer_create ========
+ */
+Writer *Writer_create(const char *path, const Writer_Attrs *attrs)
+{
+    Writer *w;
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    int i;
+
+    if ((attrs->depth < 1) || (attrs->bufSize < 1)) {
+        errno = EINVAL;
+        return (NULL);
+    }
+
+    if ((w = calloc(1, sizeof(*w))) == NULL) {
+        return (NULL);
+    }
+
+    w->depth = attrs->depth;
+    w->bufSize = (attrs->bufSize + WRITER_ALIGN - 1) & ~(WRITER_ALIGN - 1);
+    w->syncEvery = attrs->syncEvery;
+    w->doneFxn = attrs->done;
+    w->doneArg = attrs->arg;
+    w->uring = -1;
+
+    /* not every file system takes O_DIRECT */
+    w->fd = -1;
+    if (attrs->direct) {
+        w->fd = open(path, flags | O_DIRECT, 0644);
+        w->direct = (w->fd >= 0);
+    }
+    if ((w->fd < 0) && ((w->fd = open(path, flags, 0644)) < 0)) {
+        free(w);
+        return (NULL);
+    }
+
+    w->slots = calloc(w->depth, sizeof(Slot));
+    w->free = calloc(w->depth, sizeof(int));
+    w->queue = calloc(w->depth, sizeof(int));
+    if ((w->slots == NULL) || (w->free == NULL) || (w->queue == NULL) ||
+        (posix_memalign((void **)&w->mem, WRITER_ALIGN,
+        (size_t)w->depth * w->bufSize) != 0)) {
+        goto fail;
+    }
+
+    for (i = 0; i < w->depth; i++) {
+        w->free[i] = w->depth - 1 - i;
+    }
+    w->numFree = w->depth;
+
+#ifdef HAVE_IO_URING
+    if (uringCreate(w) == 0) {
+        return (w);
+    }
+#endif
+
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->work, NULL);
+    pthread_cond_init(&w->done, NULL);
+
+    if ((errno = pthread_create(&w->thread, NULL, writerThread, w)) != 0) {
+        pthread_cond_destroy(&w->done);
+        pthread_cond_destroy(&w->work);
+        pthread_mutex_destroy(&w->lock);
+        goto fail;
+    }
+
+    return (w);
+
+fail:
+    i = errno;
+    close(w->fd);
+    free(w->mem);
+    free(w->queue);
+    free(w->free);
+    free(w->slots);
+    free(w);
+    errno = i;
+
+    return (NULL);
+}
+
+/*
+ *  ======== Writer_delete ========
+ */
+int Writer_delete(Writer *w)
+{
+    int error;
+
+#ifdef HAVE_IO_URING
+    if (w->uring >= 0) {
+        uringDelete(w);
+    }
+    else
+#endif
+    {
+        pthread_mutex_lock(&w->lock);
+        w->quit = 1;
+        pthread_cond_signal(&w->work);
+        pthread_mutex_unlock(&w->lock);
+
+        pthread_join(w->thread, NULL);
+
+        pthread_cond_destroy(&w->done);
+        pthread_cond_destroy(&w->work);
+        pthread_mutex_destroy(&w->lock);
+    }
+
+    if ((w->syncEvery >= 0) && (fdatasync(w->fd) != 0)) {
+        fail(w, errno);
+    }
+
+    if (close(w->fd) != 0) {
+        fail(w, errno);
+    }
+
+    error = w->error;
+
+    free(w->mem);
+    free(w->queue);
+    free(w->free);
+    free(w->slots);
+    free(w);
+
+    if (error != 0) {
+        errno = error;
+        return (-1);
+    }
+
+    return (0);
+}
+
+/*
+ *  ======== Writer_get ========
+ */
+void *Writer_get(Writer *w)
+{
+    int i;
+
+#ifdef HAVE_IO_URING
+    if (w->uring >= 0) {
+        reap(w, 0);
+        if (w->numFree == 0) {
+            w->waits++;
+            while (w->numFree == 0) {
+                reap(w, 1);
+            }
+        }
+
+        i = w->free[--w->numFree];
+
+        return (w->mem + (size_t)i * w->bufSize);
+    }
+#endif
+
+    pthread_mutex_lock(&w->lock);
+
+    if (w->numFree == 0) {
+        w->waits++;
+        while (w->numFree == 0) {
+            pthread_cond_wait(&w->done, &w->lock);
+        }
+    }
+    i = w->free[--w->numFree];
+
+    pthread_mutex_unlock(&w->lock);
+
+    return (w->mem + (size_t)i * w->bufSize);
+}
+
+/*
+ *  ======== Writer_put ========
+ */
+int Writer_put(Writer *w, void *buf, int size)
+{
+    int i = Writer_index(w, buf);
+    Slot *slot = &w->slots[i];
+    int error;
+
+    size = (size < w->bufSize) ? size : w->bufSize;
+
+    /* O_DIRECT only takes whole units, from here on use the page cache */
+    if (w->direct && (((size | w->offset) & (WRITER_ALIGN - 1)) != 0)) {
+        drain(w, 1);
+        if (fcntl(w->fd, F_SETFL, fcntl(w->fd, F_GETFL) & ~O_DIRECT) == 0) {
+            w->direct = 0;
+        }
+    }
+
+    slot->offset = w->offset;
+    slot->size = size;
+    slot->done = 0;
+    w->offset += size;
+
+#ifdef HAVE_IO_URING
+    if (w->uring >= 0) {
+        submitWrite(w, i);
+        if ((w->syncEvery > 0) && (++w->sinceSync >= w->syncEvery)) {
+            w->sinceSync = 0;
+            submitSync(w);
+        }
+
+        error = w->error;
+    }
+    else
+#endif
+    {
+        pthread_mutex_lock(&w->lock);
+        w->queue[(w->qHead + w->qCount) % w->depth] = i;
+        w->qCount++;
+        pthread_cond_signal(&w->work);
+        error = w->error;
+        pthread_mutex_unlock(&w->lock);
+    }
+
+    if (error != 0) {
+        errno = error;
+        return (-1);
+    }
+
+    return (0);
+}
+
+/*
+ *  ======== Writer_index ========
+ */
+int Writer_index(Writer *w, void *buf)
+{
+    return ((int)(((char *)buf - w->mem) / w->bufSize));
+}
+
+/*
+ *  ======== Writer_method ========
+ */
+const char *Writer_method(Writer *w)
+{
+    return (w->uring >= 0 ? "io_uring" : "thread");
+}
+
+/*
+ *  ======== Writer_direct ========
+ */
+int Writer_direct(Writer *w)
+{
+    return (w->direct);
+}
+
+/*
+ *  ======== Writer_stats ========
+ */
+void Writer_stats(Writer *w, unsigned long *writes,
+    unsigned long long *bytes, unsigned long *waits)
+{
+    drain(w, 0);
+
+    *writes = w->writes;
+    *bytes = w->bytes;
+    *waits = w->waits;
+}
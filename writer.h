@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2010, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+/*
+ *  ======== writer.h ========
+ *  Asynchronous output writer used by the app.
+ *
+ *  A writer owns a pool of depth buffers of bufSize bytes, aligned for
+ *  O_DIRECT.  Writer_get() hands out a free buffer, and Writer_put()
+ *  queues the buffer to be appended to the file.  The buffer returns to
+ *  the pool once the write completes, so the thread producing frames
+ *  only waits for the disk when all depth buffers are in flight.
+ *
+ *  Writes go through io_uring where the kernel headers and the running
+ *  kernel have it, and otherwise through a writer thread of the
+ *  writer's own.  The file is opened with O_DIRECT if attrs->direct is
+ *  set and the file system supports it.  The writer falls back to the
+ *  page cache from the first write that isn't a multiple of
+ *  WRITER_ALIGN, such as a variable size delta record.
+ *
+ *  Only one thread may call Writer_get() and Writer_put() on a writer.
+ *  attrs->done is called as each write completes, from Writer_get(),
+ *  Writer_put() or Writer_delete() with io_uring, or on the writer
+ *  thread, before the buffer can be handed out again.
+ */
+#ifndef WRITER_
+#define WRITER_
+
+#define WRITER_ALIGN    4096    /* buffer, size and offset unit of O_DIRECT */
+
+typedef struct Writer Writer;
+
+typedef struct Writer_Attrs {
+    int depth;          /* buffers, and so writes in flight at most */
+    int bufSize;        /* bytes of each buffer */
+    int direct;         /* try O_DIRECT */
+    int syncEvery;      /* fdatasync every that many writes; 0: only at */
+                        /* Writer_delete(), < 0: never */
+    void (*done)(void *arg, void *buf);     /* a write of buf completed, */
+    void *arg;          /* called on the writer thread, or NULL */
+} Writer_Attrs;
+
+/* create path, or truncate it; NULL on failure with errno set */
+extern Writer *Writer_create(const char *path, const Writer_Attrs *attrs);
+
+/*
+ * wait for all writes, sync as attrs->syncEvery says and close; returns
+ * 0, or -1 with errno set if any write or sync failed
+ */
+extern int Writer_delete(Writer *w);
+
+/* a free buffer, waiting for a write to complete if there is none */
+extern void *Writer_get(Writer *w);
+
+/*
+ * append size bytes of buf, which came from Writer_get(); returns -1 with
+ * errno set once a write failed, the buffer is taken back either way
+ */
+extern int Writer_put(Writer *w, void *buf, int size);
+
+/* which of the depth buffers buf is, 0 to depth - 1 */
+extern int Writer_index(Writer *w, void *buf);
+
+/* "io_uring" or "thread", and whether O_DIRECT is still in use */
+extern const char *Writer_method(Writer *w);
+extern int Writer_direct(Writer *w);
+
+/*
+ * writes and bytes completed, and Writer_get() calls that had to wait;
+ * waits for the writes queued so far, so call it with no buffer held
+ */
+extern void Writer_stats(Writer *w, unsigned long *writes,
+    unsigned long long *bytes, unsigned long *waits);
+
+#endif